@@ -7,7 +7,10 @@
 #include "fonts/fonts.h"
 #include "sdl_compat.h"
 
+// Select a font from the font table. All fonts share one atlas texture that is created on first
+// use and kept until inline_font_close(), so switching fonts costs no texture upload.
 extern void inline_font_initialize(const struct inline_font *font);
+// Destroy the font atlas, before the renderer is destroyed
 extern void inline_font_close(void);
 
 extern void inline_font_set_renderer(SDL_Renderer *renderer);
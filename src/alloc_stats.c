@@ -0,0 +1,121 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "alloc_stats.h"
+#include "sdl_compat.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ALLOC_THREAD_LOCAL __declspec(thread)
+#else
+#define ALLOC_THREAD_LOCAL _Thread_local
+#endif
+
+static const char *tag_names[ALLOC_TAG_COUNT] = {"other",       "queue", "midi decode",
+                                                 "render",      "log overlay", "audio"};
+
+static SDL_malloc_func original_malloc;
+static SDL_calloc_func original_calloc;
+static SDL_realloc_func original_realloc;
+static SDL_free_func original_free;
+static int installed = 0;
+
+typedef struct {
+  uint64_t calls;
+  uint64_t bytes;
+} alloc_counter_s;
+
+// Counters of all threads for the summary, guarded by a spinlock as SDL has no 64-bit atomics
+static alloc_counter_s counters[ALLOC_TAG_COUNT];
+static SDL_SpinLock counter_lock = 0;
+
+// Counters of the calling thread, checks on one thread are not affected by the audio and device
+// threads allocating at the same time
+static ALLOC_THREAD_LOCAL alloc_counter_s thread_counters[ALLOC_TAG_COUNT];
+static ALLOC_THREAD_LOCAL alloc_tag_t current_tag = ALLOC_TAG_OTHER;
+
+static void count(const size_t size) {
+  thread_counters[current_tag].calls++;
+  thread_counters[current_tag].bytes += size;
+  SDL_LockSpinlock(&counter_lock);
+  counters[current_tag].calls++;
+  counters[current_tag].bytes += size;
+  SDL_UnlockSpinlock(&counter_lock);
+}
+
+static void *SDLCALL counting_malloc(const size_t size) {
+  count(size);
+  return original_malloc(size);
+}
+
+static void *SDLCALL counting_calloc(const size_t nmemb, const size_t size) {
+  count(nmemb != 0 && size > SIZE_MAX / nmemb ? SIZE_MAX : nmemb * size);
+  return original_calloc(nmemb, size);
+}
+
+static void *SDLCALL counting_realloc(void *mem, const size_t size) {
+  count(size);
+  return original_realloc(mem, size);
+}
+
+static void SDLCALL counting_free(void *mem) { original_free(mem); }
+
+// The counting functions forward to the original ones, so memory allocated before installing
+// them is still freed correctly
+int alloc_stats_install(void) {
+  if (installed) {
+    return 1;
+  }
+  SDL_GetOriginalMemoryFunctions(&original_malloc, &original_calloc, &original_realloc,
+                                 &original_free);
+  SDL_SetMemoryFunctions(counting_malloc, counting_calloc, counting_realloc, counting_free);
+  installed = 1;
+  return 1;
+}
+
+int alloc_stats_is_installed(void) { return installed; }
+
+alloc_tag_t alloc_stats_push_tag(const alloc_tag_t tag) {
+  const alloc_tag_t previous = current_tag;
+  current_tag = tag;
+  return previous;
+}
+
+void alloc_stats_pop_tag(const alloc_tag_t previous) { current_tag = previous; }
+
+const char *alloc_stats_tag_name(const alloc_tag_t tag) { return tag_names[tag]; }
+
+uint64_t alloc_stats_thread_count(const alloc_tag_t tag) { return thread_counters[tag].calls; }
+
+uint64_t alloc_stats_thread_total(void) {
+  uint64_t total = 0;
+  for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+    total += thread_counters[i].calls;
+  }
+  return total;
+}
+
+void alloc_stats_reset(void) {
+  SDL_zeroa(thread_counters);
+  SDL_LockSpinlock(&counter_lock);
+  SDL_zeroa(counters);
+  SDL_UnlockSpinlock(&counter_lock);
+}
+
+void alloc_stats_log_summary(void) {
+  if (!installed) {
+    return;
+  }
+  alloc_counter_s snapshot[ALLOC_TAG_COUNT];
+  SDL_LockSpinlock(&counter_lock);
+  SDL_memcpy(snapshot, counters, sizeof(snapshot));
+  SDL_zeroa(counters);
+  SDL_UnlockSpinlock(&counter_lock);
+
+  for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+    if (snapshot[i].calls > 0) {
+      SDL_LogDebug(SDL_LOG_CATEGORY_SYSTEM, "Allocations %-12s %6llu calls %9llu bytes",
+                   tag_names[i], (unsigned long long)snapshot[i].calls,
+                   (unsigned long long)snapshot[i].bytes);
+    }
+  }
+}
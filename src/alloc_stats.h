@@ -0,0 +1,49 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Counting allocators installed with SDL_SetMemoryFunctions in debug builds and replay runs.
+// Every allocation is counted against the call site class active on the calling thread, which
+// makes allocations on the per-packet and per-frame paths visible.
+
+#ifndef ALLOC_STATS_H_
+#define ALLOC_STATS_H_
+
+#include <stdint.h>
+
+typedef enum {
+  ALLOC_TAG_OTHER,
+  ALLOC_TAG_QUEUE,       // message queue push and pop
+  ALLOC_TAG_MIDI_DECODE, // SysEx decoding in the MIDI callback
+  ALLOC_TAG_RENDER,      // render_screen and the command processing feeding it
+  ALLOC_TAG_LOG_OVERLAY, // log overlay rendering
+  ALLOC_TAG_AUDIO,       // audio callbacks
+  ALLOC_TAG_COUNT
+} alloc_tag_t;
+
+// Replace the SDL memory functions with counting ones, as early as possible so start-up
+// allocations are counted too. Returns 1 if the counting allocators are active.
+int alloc_stats_install(void);
+
+int alloc_stats_is_installed(void);
+
+// Make a tag the active one on the calling thread, returning the previous tag
+alloc_tag_t alloc_stats_push_tag(alloc_tag_t tag);
+
+// Restore the tag returned by alloc_stats_push_tag()
+void alloc_stats_pop_tag(alloc_tag_t previous);
+
+const char *alloc_stats_tag_name(alloc_tag_t tag);
+
+// Allocations counted for a tag on the calling thread since the last reset
+uint64_t alloc_stats_thread_count(alloc_tag_t tag);
+
+// Allocations counted for every tag on the calling thread since the last reset
+uint64_t alloc_stats_thread_total(void);
+
+// Reset the counters of all threads for the summary and the calling thread's own counters
+void alloc_stats_reset(void);
+
+// Log the allocations of every tag since the last call and reset the counters
+void alloc_stats_log_summary(void);
+
+#endif // ALLOC_STATS_H_
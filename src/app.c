@@ -7,13 +7,26 @@
 #include <stdlib.h>
 
 #include "SDL2_inprint.h"
+#include "alloc_stats.h"
 #include "backends/audio.h"
+#include "backends/audio_channels.h"
 #include "backends/m8.h"
 #include "common.h"
 #include "config.h"
+#include "flight_recorder.h"
 #include "gamepads.h"
+#include "latency_test.h"
 #include "log_overlay.h"
+#include "log_ring.h"
+#include "metrics_export.h"
+#include "mux.h"
 #include "render.h"
+#include "replay.h"
+#include "screenshot.h"
+#include "shm_export.h"
+#include "terminal.h"
+#include "trace.h"
+#include "vnc_server.h"
 
 static void do_wait_for_device(struct app_context *ctx) {
   static Uint64 ticks_poll_device = 0;
@@ -68,6 +81,13 @@ static void do_wait_for_device(struct app_context *ctx) {
 
 config_params_s app_parse_args(int argc, char *argv[], char **preferred_device,
                                char **config_filename) {
+  const char *metrics_socket = NULL;
+  const char *metrics_file = NULL;
+  int latency_samples = 0;
+  int latency_echo_ms = -1;
+  int headless = 0;
+  int terminal = 0;
+
   for (int i = 1; i < argc; i++) {
     if (SDL_strcmp(argv[i], "--list") == 0) {
       exit(m8_list_devices());
@@ -80,9 +100,65 @@ config_params_s app_parse_args(int argc, char *argv[], char **preferred_device,
       *config_filename = argv[i + 1];
       SDL_Log("Using config file: %s", *config_filename);
       i++;
+    } else if (SDL_strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_open(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--daemon") == 0 && i + 1 < argc) {
+      mux_configure_daemon(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+      mux_configure_client(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--headless") == 0) {
+      headless = 1;
+    } else if (SDL_strcmp(argv[i], "--terminal") == 0) {
+      headless = 1;
+      terminal = 1;
+    } else if (SDL_strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc) {
+      screenshot_configure(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--shm-export") == 0 && i + 1 < argc) {
+      shm_export_configure(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--vnc") == 0 && i + 1 < argc) {
+      vnc_server_start(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--log-file") == 0 && i + 1 < argc) {
+      log_ring_open_file(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--metrics-socket") == 0 && i + 1 < argc) {
+      metrics_socket = argv[i + 1];
+      i++;
+    } else if (SDL_strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc) {
+      metrics_file = argv[i + 1];
+      i++;
+    } else if (SDL_strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_configure(argv[i + 1]);
+      i++;
+    } else if (SDL_strcmp(argv[i], "--latency-test") == 0) {
+      latency_samples = 100;
+      // Optional sample count
+      if (i + 1 < argc && SDL_isdigit(argv[i + 1][0])) {
+        latency_samples = SDL_atoi(argv[i + 1]);
+        i++;
+      }
+    } else if (SDL_strcmp(argv[i], "--latency-echo") == 0 && i + 1 < argc) {
+      latency_echo_ms = SDL_atoi(argv[i + 1]);
+      if (latency_samples == 0) {
+        latency_samples = 100;
+      }
+      i++;
     }
   }
 
+  if (latency_samples > 0) {
+    latency_test_configure(latency_samples, latency_echo_ms);
+  }
+
+  if (metrics_socket != NULL || metrics_file != NULL) {
+    metrics_export_start(metrics_socket, metrics_file);
+  }
+
   config_params_s conf = config_initialize(*config_filename);
 
   if (TARGET_OS_IOS == 1) {
@@ -90,6 +166,8 @@ config_params_s app_parse_args(int argc, char *argv[], char **preferred_device,
     conf.init_fullscreen = 1;
   }
   config_read(&conf);
+  conf.headless = headless;
+  conf.terminal = terminal;
 
   return conf;
 }
@@ -97,6 +175,11 @@ config_params_s app_parse_args(int argc, char *argv[], char **preferred_device,
 struct app_context *app_init(int argc, char *argv[]) {
   char *config_filename = NULL;
 
+#ifndef NDEBUG
+  // Count allocations by call site class in debug builds
+  alloc_stats_install();
+#endif
+
   // Initialize in-app log capture/overlay
   log_overlay_init();
 
@@ -115,7 +198,13 @@ struct app_context *app_init(int argc, char *argv[]) {
   }
 
   ctx->app_state = INITIALIZE;
+  trace_thread_name("main");
   ctx->conf = app_parse_args(argc, argv, &ctx->preferred_device, &config_filename);
+  flight_recorder_init();
+  audio_channels_configure(ctx->conf.audio_monitor_pair, ctx->conf.audio_record_stems);
+#ifdef USE_LIBUSB
+  audio_usb_configure(ctx->conf.audio_usb_transfers, ctx->conf.audio_usb_packets);
+#endif
 
   if (!renderer_initialize(&ctx->conf)) {
     SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "Failed to initialize renderer.");
@@ -123,7 +212,11 @@ struct app_context *app_init(int argc, char *argv[]) {
     return NULL;
   }
 
-  ctx->device_connected = m8_initialize(1, ctx->preferred_device);
+  // The replay, the stand-in device of the latency test and the daemon of a viewer replace the
+  // M8 for the whole run
+  ctx->device_connected = replay_is_enabled() || latency_test_is_echo() || mux_is_client()
+                              ? 0
+                              : m8_initialize(1, ctx->preferred_device);
 
   if (gamepads_initialize() < 0) {
     SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "Failed to initialize game controllers.");
@@ -132,7 +225,34 @@ struct app_context *app_init(int argc, char *argv[]) {
     return NULL;
   }
 
-  if (ctx->device_connected && m8_enable_display(1)) {
+  if (!shm_export_start()) {
+    gamepads_close();
+    renderer_close();
+    SDL_free(ctx);
+    return NULL;
+  }
+
+  if (!mux_start()) {
+    shm_export_stop();
+    gamepads_close();
+    renderer_close();
+    SDL_free(ctx);
+    return NULL;
+  }
+
+  if (replay_is_enabled() || mux_is_client()) {
+    ctx->app_state = RUN;
+  } else if (latency_test_is_echo()) {
+    if (!latency_test_start_echo()) {
+      mux_close();
+      shm_export_stop();
+      gamepads_close();
+      renderer_close();
+      SDL_free(ctx);
+      return NULL;
+    }
+    ctx->app_state = RUN;
+  } else if (ctx->device_connected && m8_enable_display(1)) {
     if (ctx->conf.audio_enabled) {
       audio_initialize(ctx->conf.audio_device_name, ctx->conf.audio_buffer_size);
     }
@@ -154,6 +274,13 @@ SDL_AppResult app_iterate(struct app_context *ctx) {
 
   SDL_AppResult app_result = SDL_APP_CONTINUE;
 
+  // Collect the log records of all threads for the overlay, the console and the log file
+  log_ring_pump();
+  screenshot_poll();
+  mux_daemon_poll(ctx->device_connected);
+  vnc_server_poll();
+  terminal_poll();
+
   switch (ctx->app_state) {
   case INITIALIZE:
     break;
@@ -163,15 +290,29 @@ SDL_AppResult app_iterate(struct app_context *ctx) {
     break;
 
   case RUN: {
-    const int result = m8_process_data(&ctx->conf);
+    if (replay_is_enabled()) {
+      return replay_run(&ctx->conf) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_RENDER);
+    const uint64_t trace_start = trace_begin();
+    const int result = latency_test_is_echo() ? latency_test_process_echo()
+                       : mux_is_client()      ? mux_client_process()
+                                              : m8_process_data(&ctx->conf);
+    trace_end("m8_process_data", trace_start);
     if (result == DEVICE_DISCONNECTED) {
       ctx->device_connected = 0;
       ctx->app_state = WAIT_FOR_DEVICE;
       audio_close();
     } else if (result == DEVICE_FATAL_ERROR) {
+      alloc_stats_pop_tag(previous_tag);
       return SDL_APP_FAILURE;
     }
     render_screen(&ctx->conf);
+    alloc_stats_pop_tag(previous_tag);
+    flight_recorder_poll();
+    if (latency_test_is_running() && !latency_test_tick()) {
+      ctx->app_state = QUIT;
+    }
     break;
   }
 
@@ -192,14 +333,22 @@ void app_quit(struct app_context *app) {
       audio_close();
     }
     gamepads_close();
+    screenshot_close();
+    shm_export_stop();
+    vnc_server_stop();
     renderer_close();
     inline_font_close();
+    mux_close();
     if (app->device_connected) {
       m8_close();
     }
+    latency_test_close();
+    trace_close();
+    metrics_export_stop();
     SDL_free(app);
 
     SDL_Log("Shutting down.");
+    log_ring_close();
     SDL_Quit();
   }
 }
@@ -0,0 +1,484 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Peak/RMS meters and a spectrum analyzer for the audio routed through m8c.
+// The audio thread copies frames into a lock-free tap, a worker thread snapshots the tap,
+// runs the analysis and publishes the levels through a sequence lock. Rendering only reads
+// the published levels and builds one vertex batch.
+
+#include "audio_meter.h"
+
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define AUDIO_METER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_METER_NEON
+#endif
+
+#define SAMPLE_RATE 44100.0f
+#define TAP_FRAMES 4096 // power of two
+#define FFT_BITS 10
+#define FFT_SIZE (1 << FFT_BITS)
+#define ANALYSIS_INTERVAL_MS 15
+#define BAND_MIN_HZ 40.0f
+#define BAND_MAX_HZ 20000.0f
+#define DB_RANGE 72.0f          // levels below -72 dBFS are drawn as empty
+#define PEAK_DECAY_PER_SEC 0.6f // in display units (0..1) per second
+#define BAND_DECAY_PER_SEC 1.2f
+#define RMS_SMOOTHING 0.35f
+
+typedef struct {
+  float peak[2];
+  float rms[2];
+  float bands[AUDIO_METER_BANDS];
+} meter_levels_s;
+
+static int meter_visible = 0;
+static SDL_AtomicInt meter_active;
+static SDL_Thread *meter_thread = NULL;
+
+// Audio thread -> worker: single producer ring of S16 stereo frames
+static uint32_t tap[TAP_FRAMES];
+static SDL_AtomicInt tap_write;
+
+// Worker -> renderer: sequence locked levels, odd sequence = write in progress
+static meter_levels_s levels_shared;
+static SDL_AtomicInt levels_seq;
+static meter_levels_s levels_render;
+
+// Worker state
+static float fft_re[FFT_SIZE];
+static float fft_im[FFT_SIZE];
+static float twiddle_re[FFT_SIZE];
+static float twiddle_im[FFT_SIZE];
+static float window[FFT_SIZE];
+static uint16_t bit_reverse[FFT_SIZE];
+static uint16_t band_first_bin[AUDIO_METER_BANDS];
+static uint16_t band_last_bin[AUDIO_METER_BANDS];
+static int tables_ready = 0;
+
+void audio_meter_push(const uint8_t *frames, uint32_t frame_count) {
+  if (!SDL_GetAtomicInt(&meter_active) || frame_count == 0) {
+    return;
+  }
+
+  uint32_t pos = (uint32_t)SDL_GetAtomicInt(&tap_write);
+  if (frame_count > TAP_FRAMES) {
+    frames += (size_t)(frame_count - TAP_FRAMES) * 4;
+    pos += frame_count - TAP_FRAMES;
+    frame_count = TAP_FRAMES;
+  }
+
+  const uint32_t first = pos & (TAP_FRAMES - 1);
+  const uint32_t head = frame_count < TAP_FRAMES - first ? frame_count : TAP_FRAMES - first;
+  memcpy(tap + first, frames, (size_t)head * 4);
+  memcpy(tap, frames + (size_t)head * 4, (size_t)(frame_count - head) * 4);
+
+  SDL_SetAtomicInt(&tap_write, (int)(pos + frame_count));
+}
+
+// Copies the newest `frames` frames of the tap. Fails if the producer overwrote them meanwhile.
+static int tap_snapshot(uint32_t *dst, const uint32_t frames, uint32_t *end_pos) {
+  for (int attempt = 0; attempt < 3; attempt++) {
+    const uint32_t end = (uint32_t)SDL_GetAtomicInt(&tap_write);
+    const uint32_t first = (end - frames) & (TAP_FRAMES - 1);
+    const uint32_t head = frames < TAP_FRAMES - first ? frames : TAP_FRAMES - first;
+    memcpy(dst, tap + first, (size_t)head * 4);
+    memcpy(dst + head, tap, (size_t)(frames - head) * 4);
+
+    const uint32_t after = (uint32_t)SDL_GetAtomicInt(&tap_write);
+    if (after - end <= TAP_FRAMES - frames) {
+      *end_pos = end;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void init_tables(void) {
+  const float pi = 3.14159265358979f;
+
+  for (uint32_t i = 0; i < FFT_SIZE; i++) {
+    uint32_t reversed = 0;
+    for (int b = 0; b < FFT_BITS; b++) {
+      reversed |= ((i >> b) & 1) << (FFT_BITS - 1 - b);
+    }
+    bit_reverse[i] = (uint16_t)reversed;
+    window[i] = 0.5f - 0.5f * SDL_cosf(2.0f * pi * (float)i / (float)(FFT_SIZE - 1));
+  }
+
+  // Twiddles of the stage with half size h are stored contiguously at offset h - 1
+  for (uint32_t h = 1; h < FFT_SIZE; h <<= 1) {
+    for (uint32_t j = 0; j < h; j++) {
+      twiddle_re[h - 1 + j] = SDL_cosf(-pi * (float)j / (float)h);
+      twiddle_im[h - 1 + j] = SDL_sinf(-pi * (float)j / (float)h);
+    }
+  }
+
+  // Logarithmically spaced bands, each covering at least one bin
+  const float bin_hz = SAMPLE_RATE / FFT_SIZE;
+  for (int b = 0; b < AUDIO_METER_BANDS; b++) {
+    const float lo = BAND_MIN_HZ * SDL_powf(BAND_MAX_HZ / BAND_MIN_HZ, (float)b / AUDIO_METER_BANDS);
+    const float hi =
+        BAND_MIN_HZ * SDL_powf(BAND_MAX_HZ / BAND_MIN_HZ, (float)(b + 1) / AUDIO_METER_BANDS);
+    int first = (int)SDL_floorf(lo / bin_hz + 0.5f);
+    int last = (int)SDL_floorf(hi / bin_hz + 0.5f) - 1;
+    if (first < 1) {
+      first = 1;
+    }
+    if (last < first) {
+      last = first;
+    }
+    if (last > FFT_SIZE / 2 - 1) {
+      last = FFT_SIZE / 2 - 1;
+    }
+    band_first_bin[b] = (uint16_t)first;
+    band_last_bin[b] = (uint16_t)last;
+  }
+
+  tables_ready = 1;
+}
+
+// Radix-2 butterflies of one group, four at a time where the group is wide enough
+static void butterflies(float *ar, float *ai, float *br, float *bi, const float *wr,
+                        const float *wi, const uint32_t half) {
+  uint32_t j = 0;
+#if defined(AUDIO_METER_SSE)
+  for (; j + 4 <= half; j += 4) {
+    const __m128 w_re = _mm_loadu_ps(wr + j);
+    const __m128 w_im = _mm_loadu_ps(wi + j);
+    const __m128 b_re = _mm_loadu_ps(br + j);
+    const __m128 b_im = _mm_loadu_ps(bi + j);
+    const __m128 a_re = _mm_loadu_ps(ar + j);
+    const __m128 a_im = _mm_loadu_ps(ai + j);
+    const __m128 t_re = _mm_sub_ps(_mm_mul_ps(b_re, w_re), _mm_mul_ps(b_im, w_im));
+    const __m128 t_im = _mm_add_ps(_mm_mul_ps(b_re, w_im), _mm_mul_ps(b_im, w_re));
+    _mm_storeu_ps(br + j, _mm_sub_ps(a_re, t_re));
+    _mm_storeu_ps(bi + j, _mm_sub_ps(a_im, t_im));
+    _mm_storeu_ps(ar + j, _mm_add_ps(a_re, t_re));
+    _mm_storeu_ps(ai + j, _mm_add_ps(a_im, t_im));
+  }
+#elif defined(AUDIO_METER_NEON)
+  for (; j + 4 <= half; j += 4) {
+    const float32x4_t w_re = vld1q_f32(wr + j);
+    const float32x4_t w_im = vld1q_f32(wi + j);
+    const float32x4_t b_re = vld1q_f32(br + j);
+    const float32x4_t b_im = vld1q_f32(bi + j);
+    const float32x4_t a_re = vld1q_f32(ar + j);
+    const float32x4_t a_im = vld1q_f32(ai + j);
+    const float32x4_t t_re = vmlsq_f32(vmulq_f32(b_re, w_re), b_im, w_im);
+    const float32x4_t t_im = vmlaq_f32(vmulq_f32(b_re, w_im), b_im, w_re);
+    vst1q_f32(br + j, vsubq_f32(a_re, t_re));
+    vst1q_f32(bi + j, vsubq_f32(a_im, t_im));
+    vst1q_f32(ar + j, vaddq_f32(a_re, t_re));
+    vst1q_f32(ai + j, vaddq_f32(a_im, t_im));
+  }
+#endif
+  for (; j < half; j++) {
+    const float t_re = br[j] * wr[j] - bi[j] * wi[j];
+    const float t_im = br[j] * wi[j] + bi[j] * wr[j];
+    br[j] = ar[j] - t_re;
+    bi[j] = ai[j] - t_im;
+    ar[j] += t_re;
+    ai[j] += t_im;
+  }
+}
+
+static void fft(float *re, float *im) {
+  for (uint32_t i = 0; i < FFT_SIZE; i++) {
+    const uint32_t r = bit_reverse[i];
+    if (i < r) {
+      const float tr = re[i];
+      const float ti = im[i];
+      re[i] = re[r];
+      im[i] = im[r];
+      re[r] = tr;
+      im[r] = ti;
+    }
+  }
+
+  for (uint32_t half = 1; half < FFT_SIZE; half <<= 1) {
+    const float *wr = twiddle_re + half - 1;
+    const float *wi = twiddle_im + half - 1;
+    for (uint32_t start = 0; start < FFT_SIZE; start += half * 2) {
+      butterflies(re + start, im + start, re + start + half, im + start + half, wr, wi, half);
+    }
+  }
+}
+
+// Maps a linear amplitude (1.0 = full scale) to the 0..1 display range
+static float to_display(const float amplitude) {
+  if (amplitude <= 0.0f) {
+    return 0.0f;
+  }
+  const float db = 20.0f * SDL_log10f(amplitude);
+  const float value = (db + DB_RANGE) / DB_RANGE;
+  return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+static void analyze(const uint32_t *frames, const uint32_t new_frames, meter_levels_s *levels,
+                    const float dt) {
+  // Peak and RMS over the frames that arrived since the previous pass
+  float peak[2] = {0.0f, 0.0f};
+  float sum[2] = {0.0f, 0.0f};
+  for (uint32_t i = FFT_SIZE - new_frames; i < FFT_SIZE; i++) {
+    int16_t s[2];
+    memcpy(s, &frames[i], sizeof(s));
+    for (int c = 0; c < 2; c++) {
+      const float v = (float)s[c] / 32768.0f;
+      const float a = v < 0.0f ? -v : v;
+      if (a > peak[c]) {
+        peak[c] = a;
+      }
+      sum[c] += v * v;
+    }
+  }
+
+  for (int c = 0; c < 2; c++) {
+    const float peak_display = to_display(peak[c]);
+    const float held = levels->peak[c] - PEAK_DECAY_PER_SEC * dt;
+    levels->peak[c] = peak_display > held ? peak_display : (held > 0.0f ? held : 0.0f);
+
+    const float rms = new_frames > 0 ? to_display(SDL_sqrtf(sum[c] / (float)new_frames)) : 0.0f;
+    levels->rms[c] += (rms - levels->rms[c]) * RMS_SMOOTHING;
+  }
+
+  // Spectrum of the mono mix
+  for (uint32_t i = 0; i < FFT_SIZE; i++) {
+    int16_t s[2];
+    memcpy(s, &frames[i], sizeof(s));
+    fft_re[i] = ((float)s[0] + (float)s[1]) * (0.5f / 32768.0f) * window[i];
+    fft_im[i] = 0.0f;
+  }
+  fft(fft_re, fft_im);
+
+  // Amplitude of a full scale sine: N/2 bins scaled by the Hann window gain of 0.5
+  const float scale = 4.0f / FFT_SIZE;
+  for (int b = 0; b < AUDIO_METER_BANDS; b++) {
+    float max_power = 0.0f;
+    for (uint32_t k = band_first_bin[b]; k <= band_last_bin[b]; k++) {
+      const float power = fft_re[k] * fft_re[k] + fft_im[k] * fft_im[k];
+      if (power > max_power) {
+        max_power = power;
+      }
+    }
+    const float value = to_display(SDL_sqrtf(max_power) * scale);
+    const float held = levels->bands[b] - BAND_DECAY_PER_SEC * dt;
+    levels->bands[b] = value > held ? value : (held > 0.0f ? held : 0.0f);
+  }
+}
+
+static void decay(meter_levels_s *levels, const float dt) {
+  for (int c = 0; c < 2; c++) {
+    levels->peak[c] = SDL_max(0.0f, levels->peak[c] - PEAK_DECAY_PER_SEC * dt);
+    levels->rms[c] -= levels->rms[c] * RMS_SMOOTHING;
+  }
+  for (int b = 0; b < AUDIO_METER_BANDS; b++) {
+    levels->bands[b] = SDL_max(0.0f, levels->bands[b] - BAND_DECAY_PER_SEC * dt);
+  }
+}
+
+static void publish(const meter_levels_s *levels) {
+  SDL_AddAtomicInt(&levels_seq, 1);
+  levels_shared = *levels;
+  SDL_AddAtomicInt(&levels_seq, 1);
+}
+
+static int SDLCALL meter_worker(void *data) {
+  (void)data;
+  static uint32_t snapshot[FFT_SIZE];
+  meter_levels_s levels;
+  SDL_zero(levels);
+  uint32_t last_end = (uint32_t)SDL_GetAtomicInt(&tap_write);
+  const float dt = ANALYSIS_INTERVAL_MS / 1000.0f;
+
+  while (SDL_GetAtomicInt(&meter_active)) {
+    SDL_Delay(ANALYSIS_INTERVAL_MS);
+
+    uint32_t end;
+    if (tap_snapshot(snapshot, FFT_SIZE, &end) && end != last_end) {
+      uint32_t new_frames = end - last_end;
+      if (new_frames > FFT_SIZE) {
+        new_frames = FFT_SIZE;
+      }
+      last_end = end;
+      analyze(snapshot, new_frames, &levels, dt);
+    } else {
+      decay(&levels, dt);
+    }
+    publish(&levels);
+  }
+  return 0;
+}
+
+static void meter_stop(void) {
+  SDL_SetAtomicInt(&meter_active, 0);
+  if (meter_thread != NULL) {
+    SDL_WaitThread(meter_thread, NULL);
+    meter_thread = NULL;
+  }
+}
+
+void audio_meter_toggle(void) {
+  meter_visible = !meter_visible;
+  if (!meter_visible) {
+    meter_stop();
+    return;
+  }
+
+  if (!tables_ready) {
+    init_tables();
+  }
+  SDL_zero(levels_shared);
+  SDL_zero(levels_render);
+  SDL_SetAtomicInt(&meter_active, 1);
+  meter_thread = SDL_CreateThread(meter_worker, "m8c-meters", NULL);
+  if (meter_thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to start audio meter thread: %s",
+                 SDL_GetError());
+    SDL_SetAtomicInt(&meter_active, 0);
+    meter_visible = 0;
+  }
+}
+
+int audio_meter_is_visible(void) { return meter_visible; }
+
+void audio_meter_destroy(void) {
+  meter_stop();
+  meter_visible = 0;
+}
+
+// Vertex batch: background, two meters with a peak marker each, and the spectrum bars
+#define MAX_QUADS (1 + 4 + AUDIO_METER_BANDS)
+static SDL_Vertex vertices[MAX_QUADS * 4];
+static int indices[MAX_QUADS * 6];
+static int quad_count;
+
+static void add_quad(const float x, const float y, const float w, const float h,
+                     const SDL_Vertex *top, const SDL_Vertex *bottom) {
+  SDL_Vertex *v = &vertices[quad_count * 4];
+  int *i = &indices[quad_count * 6];
+  const int base = quad_count * 4;
+
+  v[0] = *top;
+  v[0].position = (SDL_FPoint){x, y};
+  v[1] = *top;
+  v[1].position = (SDL_FPoint){x + w, y};
+  v[2] = *bottom;
+  v[2].position = (SDL_FPoint){x + w, y + h};
+  v[3] = *bottom;
+  v[3].position = (SDL_FPoint){x, y + h};
+
+  i[0] = base;
+  i[1] = base + 1;
+  i[2] = base + 2;
+  i[3] = base;
+  i[4] = base + 2;
+  i[5] = base + 3;
+  quad_count++;
+}
+
+static SDL_Vertex level_color(const float level) {
+  SDL_Vertex v;
+  SDL_zero(v);
+  if (level > 0.92f) {
+    v.color = COMPAT_VERTEX_COLOR(255, 60, 60, 255);
+  } else if (level > 0.75f) {
+    v.color = COMPAT_VERTEX_COLOR(255, 210, 60, 255);
+  } else {
+    v.color = COMPAT_VERTEX_COLOR(60, 230, 120, 255);
+  }
+  return v;
+}
+
+static void read_levels(void) {
+  for (int attempt = 0; attempt < 3; attempt++) {
+    const int seq = SDL_GetAtomicInt(&levels_seq);
+    if (seq & 1) {
+      continue;
+    }
+    const meter_levels_s copy = levels_shared;
+    if (SDL_GetAtomicInt(&levels_seq) == seq) {
+      levels_render = copy;
+      return;
+    }
+  }
+  // Keep the previous frame's levels if the worker kept publishing
+}
+
+void audio_meter_render(SDL_Renderer *renderer, const int logical_texture_width,
+                        const int logical_texture_height) {
+  if (!meter_visible) {
+    return;
+  }
+
+  read_levels();
+
+  // Layout in logical pixels, scaled to the size of the current target
+  float sx = 1.0f;
+  float sy = 1.0f;
+  SDL_Texture *target = SDL_GetRenderTarget(renderer);
+  if (target != NULL) {
+    float target_w, target_h;
+    SDL_GetTextureSize(target, &target_w, &target_h);
+    sx = target_w / (float)logical_texture_width;
+    sy = target_h / (float)logical_texture_height;
+  }
+
+  const float panel_x = 4.0f * sx;
+  const float panel_y = (float)logical_texture_height * 0.55f * sy;
+  const float panel_w = ((float)logical_texture_width - 8.0f) * sx;
+  const float panel_h = ((float)logical_texture_height * 0.45f - 4.0f) * sy;
+  const float pad_x = 4.0f * sx;
+  const float pad_y = 4.0f * sy;
+  const float bar_h = panel_h - pad_y * 2.0f;
+  const float bottom = panel_y + panel_h - pad_y;
+  const float meter_w = 6.0f * sx;
+  const float meter_gap = 2.0f * sx;
+
+  quad_count = 0;
+
+  SDL_Vertex background;
+  SDL_zero(background);
+  background.color = COMPAT_VERTEX_COLOR(0, 0, 0, 200);
+  add_quad(panel_x, panel_y, panel_w, panel_h, &background, &background);
+
+  SDL_Vertex peak_marker;
+  SDL_zero(peak_marker);
+  peak_marker.color = COMPAT_VERTEX_COLOR(255, 255, 255, 255);
+
+  for (int c = 0; c < 2; c++) {
+    const float x = panel_x + pad_x + (float)c * (meter_w + meter_gap);
+    const float rms_h = levels_render.rms[c] * bar_h;
+    const SDL_Vertex rms_color = level_color(levels_render.rms[c]);
+    add_quad(x, bottom - rms_h, meter_w, rms_h, &rms_color, &rms_color);
+    const float peak_y = bottom - levels_render.peak[c] * bar_h;
+    add_quad(x, peak_y, meter_w, sy, &peak_marker, &peak_marker);
+  }
+
+  const float spectrum_x = panel_x + pad_x + 2.0f * (meter_w + meter_gap) + pad_x;
+  const float spectrum_w = panel_x + panel_w - pad_x - spectrum_x;
+  const float band_w = spectrum_w / AUDIO_METER_BANDS;
+  const float bar_w = band_w > 2.0f * sx ? band_w - sx : band_w;
+
+  SDL_Vertex band_bottom;
+  SDL_zero(band_bottom);
+  band_bottom.color = COMPAT_VERTEX_COLOR(40, 110, 200, 255);
+
+  for (int b = 0; b < AUDIO_METER_BANDS; b++) {
+    const float level = levels_render.bands[b];
+    if (level <= 0.0f) {
+      continue;
+    }
+    const float h = level * bar_h;
+    const SDL_Vertex band_top = level_color(level);
+    add_quad(spectrum_x + (float)b * band_w, bottom - h, bar_w, h, &band_top, &band_bottom);
+  }
+
+  if (!SDL_RenderGeometry(renderer, NULL, vertices, quad_count * 4, indices, quad_count * 6)) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't render audio meters: %s", SDL_GetError());
+  }
+}
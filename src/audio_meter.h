@@ -0,0 +1,29 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#ifndef AUDIO_METER_H_
+#define AUDIO_METER_H_
+
+#include "sdl_compat.h"
+#include <stdint.h>
+
+#define AUDIO_METER_BANDS 64
+
+// Toggle overlay visibility. The analysis thread only runs while the overlay is visible.
+void audio_meter_toggle(void);
+
+// Return non-zero if the overlay is currently visible
+int audio_meter_is_visible(void);
+
+// Feed S16 stereo frames to the analyzer. Called from the audio thread, lock-free and a no-op
+// while the overlay is hidden.
+void audio_meter_push(const uint8_t *frames, uint32_t frame_count);
+
+// Stop the analysis thread and hide the overlay
+void audio_meter_destroy(void);
+
+// Draw the meters and spectrum on the current render target with a single geometry batch
+void audio_meter_render(SDL_Renderer *renderer, int logical_texture_width,
+                        int logical_texture_height);
+
+#endif // AUDIO_METER_H_
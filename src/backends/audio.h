@@ -8,6 +8,11 @@ void audio_toggle(const char *output_device_name, unsigned int audio_buffer_size
 void audio_process(void);
 void audio_close(void);
 
+#ifdef USE_LIBUSB
+// Isochronous transfer depth and packets per transfer, 0 = automatic. Applied on the next init.
+void audio_usb_configure(unsigned int transfers, unsigned int packets);
+#endif
+
 #ifdef USE_SDL2
 // SDL2 requires periodic pumping of audio data from main loop
 void audio_pump(void);
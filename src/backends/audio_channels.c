@@ -0,0 +1,430 @@
+// Copyright 2021 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Splits interleaved multichannel M8 audio into per channel pair streams.
+// Every stereo pair is a 32-bit word in the interleaved frame, so de-interleaving is a
+// transpose of 32-bit words. The monitored pair is routed to the audio output and, when stem
+// recording is enabled, every pair is queued for a writer thread that produces one WAV per pair.
+
+#include "audio_channels.h"
+#include "../audio_meter.h"
+#include "../sdl_compat.h"
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_CHANNELS_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_CHANNELS_NEON
+#endif
+
+// Frames de-interleaved per pass, keeps the scratch buffers small and cache resident
+#define CHUNK_FRAMES 256
+// Bytes of one stereo S16 frame
+#define PAIR_FRAME_SIZE 4
+// Per pair buffering between the audio thread and the stem writer, ~1.5 seconds. A power of two
+// so the byte counters stay valid when they wrap.
+#define STEM_RING_SIZE (256 * 1024)
+#define STEM_WRITE_INTERVAL_MS 50
+#define WAV_HEADER_SIZE 44
+
+// Single producer (audio thread), single consumer (writer thread) ring per pair
+typedef struct {
+  uint8_t *ring;
+  SDL_AtomicInt written; // bytes, only advanced by the audio thread
+  SDL_AtomicInt read;    // bytes, only advanced by the writer thread
+  SDL_IOStream *file;
+  uint32_t data_bytes;
+  uint32_t dropped_bytes;
+} stem_s;
+
+static unsigned int channel_count = 0;
+static unsigned int pair_count = 0;
+static unsigned int requested_monitor_pair = 0;
+static unsigned int requested_record_stems = 0;
+static unsigned int monitor_pair = 0;
+
+static uint32_t pair_scratch[AUDIO_CHANNELS_MAX_PAIRS][CHUNK_FRAMES];
+static uint32_t *pair_pointers[AUDIO_CHANNELS_MAX_PAIRS];
+
+static stem_s stems[AUDIO_CHANNELS_MAX_PAIRS];
+static SDL_Thread *stem_thread = NULL;
+static SDL_AtomicInt stem_writer_stop;
+static int recording = 0;
+
+void audio_channels_deinterleave(const void *src, const uint32_t frames, const unsigned int pairs,
+                                 uint32_t *const *dst) {
+  const uint8_t *in = src;
+  uint32_t f = 0;
+
+  if (pairs == 1) {
+    memcpy(dst[0], in, (size_t)frames * PAIR_FRAME_SIZE);
+    return;
+  }
+
+#if defined(AUDIO_CHANNELS_SSE2)
+  if (pairs == 2) {
+    for (; f + 2 <= frames; f += 2) {
+      // a0 b0 a1 b1 -> a0 a1 b0 b1
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + (size_t)f * 8));
+      v = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storel_epi64((__m128i *)(dst[0] + f), v);
+      _mm_storel_epi64((__m128i *)(dst[1] + f), _mm_unpackhi_epi64(v, v));
+    }
+  } else if (pairs >= 4) {
+    const size_t stride = (size_t)pairs * PAIR_FRAME_SIZE;
+    for (; f + 4 <= frames; f += 4) {
+      const uint8_t *frame = in + (size_t)f * stride;
+      unsigned int p = 0;
+      // 4x4 transpose of 32-bit words: four frames of four pairs at a time
+      for (; p + 4 <= pairs; p += 4) {
+        const uint8_t *col = frame + (size_t)p * PAIR_FRAME_SIZE;
+        const __m128i r0 = _mm_loadu_si128((const __m128i *)col);
+        const __m128i r1 = _mm_loadu_si128((const __m128i *)(col + stride));
+        const __m128i r2 = _mm_loadu_si128((const __m128i *)(col + stride * 2));
+        const __m128i r3 = _mm_loadu_si128((const __m128i *)(col + stride * 3));
+        const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        _mm_storeu_si128((__m128i *)(dst[p] + f), _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)(dst[p + 1] + f), _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)(dst[p + 2] + f), _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128((__m128i *)(dst[p + 3] + f), _mm_unpackhi_epi64(t2, t3));
+      }
+      for (; p < pairs; p++) {
+        for (unsigned int k = 0; k < 4; k++) {
+          memcpy(&dst[p][f + k], frame + k * stride + (size_t)p * PAIR_FRAME_SIZE, PAIR_FRAME_SIZE);
+        }
+      }
+    }
+  }
+#elif defined(AUDIO_CHANNELS_NEON)
+  const uint32_t *words = (const uint32_t *)src;
+  if (pairs == 2) {
+    for (; f + 4 <= frames; f += 4) {
+      const uint32x4x2_t v = vld2q_u32(words + (size_t)f * 2);
+      vst1q_u32(dst[0] + f, v.val[0]);
+      vst1q_u32(dst[1] + f, v.val[1]);
+    }
+  } else if (pairs == 3) {
+    for (; f + 4 <= frames; f += 4) {
+      const uint32x4x3_t v = vld3q_u32(words + (size_t)f * 3);
+      vst1q_u32(dst[0] + f, v.val[0]);
+      vst1q_u32(dst[1] + f, v.val[1]);
+      vst1q_u32(dst[2] + f, v.val[2]);
+    }
+  } else if (pairs == 4) {
+    for (; f + 4 <= frames; f += 4) {
+      const uint32x4x4_t v = vld4q_u32(words + (size_t)f * 4);
+      vst1q_u32(dst[0] + f, v.val[0]);
+      vst1q_u32(dst[1] + f, v.val[1]);
+      vst1q_u32(dst[2] + f, v.val[2]);
+      vst1q_u32(dst[3] + f, v.val[3]);
+    }
+  } else {
+    for (; f + 4 <= frames; f += 4) {
+      const uint32_t *frame = words + (size_t)f * pairs;
+      unsigned int p = 0;
+      for (; p + 4 <= pairs; p += 4) {
+        const uint32x4x2_t a = vtrnq_u32(vld1q_u32(frame + p), vld1q_u32(frame + pairs + p));
+        const uint32x4x2_t b =
+            vtrnq_u32(vld1q_u32(frame + pairs * 2 + p), vld1q_u32(frame + pairs * 3 + p));
+        vst1q_u32(dst[p] + f, vcombine_u32(vget_low_u32(a.val[0]), vget_low_u32(b.val[0])));
+        vst1q_u32(dst[p + 1] + f, vcombine_u32(vget_low_u32(a.val[1]), vget_low_u32(b.val[1])));
+        vst1q_u32(dst[p + 2] + f, vcombine_u32(vget_high_u32(a.val[0]), vget_high_u32(b.val[0])));
+        vst1q_u32(dst[p + 3] + f, vcombine_u32(vget_high_u32(a.val[1]), vget_high_u32(b.val[1])));
+      }
+      for (; p < pairs; p++) {
+        for (unsigned int k = 0; k < 4; k++) {
+          dst[p][f + k] = frame[k * pairs + p];
+        }
+      }
+    }
+  }
+#endif
+
+  // Scalar path for the remaining frames, or everything on targets without SIMD
+  for (; f < frames; f++) {
+    const uint8_t *frame = in + (size_t)f * pairs * PAIR_FRAME_SIZE;
+    for (unsigned int p = 0; p < pairs; p++) {
+      memcpy(&dst[p][f], frame + (size_t)p * PAIR_FRAME_SIZE, PAIR_FRAME_SIZE);
+    }
+  }
+}
+
+static void put_le16(uint8_t *dst, const uint16_t value) {
+  dst[0] = value & 0xFF;
+  dst[1] = value >> 8;
+}
+
+static void put_le32(uint8_t *dst, const uint32_t value) {
+  dst[0] = value & 0xFF;
+  dst[1] = (value >> 8) & 0xFF;
+  dst[2] = (value >> 16) & 0xFF;
+  dst[3] = value >> 24;
+}
+
+static int write_wav_header(SDL_IOStream *io, const uint32_t data_bytes) {
+  uint8_t header[WAV_HEADER_SIZE];
+  memcpy(header, "RIFF", 4);
+  put_le32(header + 4, 36 + data_bytes);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  put_le32(header + 16, 16);                                              // fmt chunk size
+  put_le16(header + 20, 1);                                               // PCM
+  put_le16(header + 22, 2);                                               // channels
+  put_le32(header + 24, AUDIO_CHANNELS_SAMPLE_RATE);                      // sample rate
+  put_le32(header + 28, AUDIO_CHANNELS_SAMPLE_RATE * PAIR_FRAME_SIZE);   // byte rate
+  put_le16(header + 32, PAIR_FRAME_SIZE);                                 // block align
+  put_le16(header + 34, 16);                                              // bits per sample
+  memcpy(header + 36, "data", 4);
+  put_le32(header + 40, data_bytes);
+  return SDL_WriteIO(io, header, sizeof(header)) == sizeof(header);
+}
+
+// Moves queued audio from the pair rings to their files. Runs on the writer thread.
+static void stems_drain(void) {
+  for (unsigned int p = 0; p < pair_count; p++) {
+    stem_s *stem = &stems[p];
+    if (stem->file == NULL) {
+      continue;
+    }
+    for (;;) {
+      const uint32_t read = (uint32_t)SDL_GetAtomicInt(&stem->read);
+      const uint32_t available = (uint32_t)SDL_GetAtomicInt(&stem->written) - read;
+      if (available == 0) {
+        break;
+      }
+      // Written straight from the ring, up to its end at a time
+      const uint32_t offset = read % STEM_RING_SIZE;
+      const uint32_t length = SDL_min(available, STEM_RING_SIZE - offset);
+      if (SDL_WriteIO(stem->file, stem->ring + offset, length) != length) {
+        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Error writing stem %u: %s", p, SDL_GetError());
+        SDL_CloseIO(stem->file);
+        stem->file = NULL;
+        break;
+      }
+      SDL_SetAtomicInt(&stem->read, (int)(read + length));
+      stem->data_bytes += length;
+    }
+  }
+}
+
+static int SDLCALL stem_writer_thread(void *data) {
+  (void)data;
+  while (!SDL_GetAtomicInt(&stem_writer_stop)) {
+    SDL_Delay(STEM_WRITE_INTERVAL_MS);
+    stems_drain();
+  }
+  stems_drain();
+  return 0;
+}
+
+// Queues the de-interleaved chunk of every pair. Runs on the audio thread and never blocks: a
+// chunk that doesn't fit is dropped whole, keeping the files frame aligned.
+static void stems_push(const uint32_t frames) {
+  const uint32_t bytes = frames * PAIR_FRAME_SIZE;
+  for (unsigned int p = 0; p < pair_count; p++) {
+    stem_s *stem = &stems[p];
+    const uint32_t written = (uint32_t)SDL_GetAtomicInt(&stem->written);
+    if (written - (uint32_t)SDL_GetAtomicInt(&stem->read) > STEM_RING_SIZE - bytes) {
+      stem->dropped_bytes += bytes;
+      continue;
+    }
+    const uint32_t offset = written % STEM_RING_SIZE;
+    const uint32_t first = SDL_min(bytes, STEM_RING_SIZE - offset);
+    SDL_memcpy(stem->ring + offset, pair_scratch[p], first);
+    SDL_memcpy(stem->ring, (const uint8_t *)pair_scratch[p] + first, bytes - first);
+    SDL_SetAtomicInt(&stem->written, (int)(written + bytes));
+  }
+}
+
+static void stems_close(void) {
+  if (!recording) {
+    return;
+  }
+
+  SDL_SetAtomicInt(&stem_writer_stop, 1);
+  if (stem_thread != NULL) {
+    SDL_WaitThread(stem_thread, NULL);
+    stem_thread = NULL;
+  }
+
+  for (unsigned int p = 0; p < AUDIO_CHANNELS_MAX_PAIRS; p++) {
+    stem_s *stem = &stems[p];
+    if (stem->file != NULL) {
+      // Patch the sizes now that the length of the data chunk is known
+      if (SDL_SeekIO(stem->file, 0, SDL_IO_SEEK_SET) < 0 ||
+          !write_wav_header(stem->file, stem->data_bytes)) {
+        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Error finalizing stem %u: %s", p, SDL_GetError());
+      }
+      SDL_CloseIO(stem->file);
+    }
+    if (stem->dropped_bytes > 0) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO, "Stem %u dropped %u bytes, writer could not keep up", p,
+                  stem->dropped_bytes);
+    }
+    SDL_free(stem->ring);
+    SDL_zero(*stem);
+  }
+
+  recording = 0;
+  SDL_Log("Stem recording stopped");
+}
+
+static int stems_open(void) {
+  char *pref_path = SDL_GetPrefPath("", "m8c");
+  if (pref_path == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Cannot resolve stem directory: %s", SDL_GetError());
+    return 0;
+  }
+
+  char timestamp[32];
+  const time_t now = time(NULL);
+  strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+  recording = 1;
+
+  for (unsigned int p = 0; p < pair_count; p++) {
+    char path[1024];
+    SDL_snprintf(path, sizeof(path), "%sm8c-stems-%s-pair%02u.wav", pref_path, timestamp, p);
+
+    stems[p].ring = SDL_malloc(STEM_RING_SIZE);
+    if (stems[p].ring == NULL) {
+      SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Cannot allocate stem buffer: %s", SDL_GetError());
+      SDL_free(pref_path);
+      stems_close();
+      return 0;
+    }
+    stems[p].file = SDL_IOFromFile(path, "wb");
+    if (stems[p].file == NULL || !write_wav_header(stems[p].file, 0)) {
+      SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Cannot open stem file %s: %s", path, SDL_GetError());
+      SDL_free(pref_path);
+      stems_close();
+      return 0;
+    }
+    SDL_LogInfo(SDL_LOG_CATEGORY_AUDIO, "Recording channels %u-%u to %s", p * 2 + 1, p * 2 + 2,
+                path);
+  }
+  SDL_free(pref_path);
+
+  SDL_SetAtomicInt(&stem_writer_stop, 0);
+  stem_thread = SDL_CreateThread(stem_writer_thread, "m8c-stems", NULL);
+  if (stem_thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to start stem writer: %s", SDL_GetError());
+    stems_close();
+    return 0;
+  }
+  return 1;
+}
+
+void audio_channels_configure(const unsigned int monitor_pair_index,
+                              const unsigned int record_stems) {
+  requested_monitor_pair = monitor_pair_index;
+  requested_record_stems = record_stems;
+}
+
+int audio_channels_recording_requested(void) { return requested_record_stems != 0; }
+
+int audio_channels_open(const unsigned int channels) {
+  if (channel_count != 0) {
+    audio_channels_close();
+  }
+
+  if (channels < 2 || channels > AUDIO_CHANNELS_MAX || channels % 2 != 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Unsupported audio channel count %u", channels);
+    return 0;
+  }
+
+  channel_count = channels;
+  pair_count = channels / 2;
+  for (unsigned int p = 0; p < AUDIO_CHANNELS_MAX_PAIRS; p++) {
+    pair_pointers[p] = pair_scratch[p];
+  }
+
+  monitor_pair = requested_monitor_pair;
+  if (monitor_pair >= pair_count) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO,
+                "Monitor pair %u not available on a %u channel device, using main mix",
+                monitor_pair, channels);
+    monitor_pair = 0;
+  }
+
+  SDL_LogInfo(SDL_LOG_CATEGORY_AUDIO, "Audio input has %u channels, monitoring channels %u-%u",
+              channels, monitor_pair * 2 + 1, monitor_pair * 2 + 2);
+
+  if (requested_record_stems && !stems_open()) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO, "Continuing without stem recording");
+  }
+  return 1;
+}
+
+void audio_channels_close(void) {
+  stems_close();
+  channel_count = 0;
+  pair_count = 0;
+}
+
+unsigned int audio_channels_get_count(void) { return channel_count; }
+
+unsigned int audio_channels_frame_size(void) { return channel_count * 2; }
+
+// De-interleaves the block chunk by chunk, handing the monitored pair to either the ring or
+// the linear output buffer.
+static uint32_t split(const uint8_t *data, const uint32_t length, RingBuffer *monitor_ring,
+                      uint8_t *linear_out) {
+  if (channel_count == 0) {
+    return 0;
+  }
+
+  const uint32_t frame_size = channel_count * 2;
+  uint32_t frames_left = length / frame_size;
+  uint32_t written = 0;
+
+  while (frames_left > 0) {
+    const uint32_t frames = frames_left < CHUNK_FRAMES ? frames_left : CHUNK_FRAMES;
+    const uint32_t bytes = frames * PAIR_FRAME_SIZE;
+    const uint8_t *monitored;
+
+    if (pair_count == 1 && !recording) {
+      // Plain stereo stream, nothing to split
+      monitored = data;
+    } else {
+      audio_channels_deinterleave(data, frames, pair_count, pair_pointers);
+      monitored = (const uint8_t *)pair_scratch[monitor_pair];
+      if (recording) {
+        stems_push(frames);
+      }
+    }
+
+    audio_meter_push(monitored, frames);
+
+    if (monitor_ring != NULL) {
+      const uint32_t pushed = ring_buffer_push(monitor_ring, monitored, bytes);
+      if (pushed == (uint32_t)-1) {
+        SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Buffer overflow!");
+      } else {
+        written += pushed;
+      }
+    } else if (linear_out != NULL) {
+      memcpy(linear_out + written, monitored, bytes);
+      written += bytes;
+    }
+
+    data += (size_t)frames * frame_size;
+    frames_left -= frames;
+  }
+
+  return written;
+}
+
+uint32_t audio_channels_process(const uint8_t *data, const uint32_t length,
+                                RingBuffer *monitor_ring) {
+  return split(data, length, monitor_ring, NULL);
+}
+
+uint32_t audio_channels_process_linear(const uint8_t *data, const uint32_t length, uint8_t *out) {
+  return split(data, length, NULL, out);
+}
@@ -0,0 +1,78 @@
+// Copyright 2021 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Splits interleaved multichannel M8 audio into per channel pair streams.
+// The stereo M8 exposes a single pair (the main mix), the multichannel model exposes several.
+
+#ifndef AUDIO_CHANNELS_H
+#define AUDIO_CHANNELS_H
+
+#include "ringbuffer.h"
+#include <stdint.h>
+
+#define AUDIO_CHANNELS_MAX 32
+#define AUDIO_CHANNELS_MAX_PAIRS (AUDIO_CHANNELS_MAX / 2)
+#define AUDIO_CHANNELS_SAMPLE_RATE 44100
+
+/**
+ * Sets the channel routing options used by the next audio_channels_open call.
+ *
+ * @param monitor_pair Index of the channel pair routed to the audio output, 0 = main mix.
+ * @param record_stems If non-zero, every channel pair is written to its own WAV file.
+ */
+void audio_channels_configure(unsigned int monitor_pair, unsigned int record_stems);
+
+// Returns non-zero if stem recording has been requested with audio_channels_configure.
+int audio_channels_recording_requested(void);
+
+/**
+ * Prepares the splitter for a device delivering interleaved S16 frames.
+ *
+ * @param channels Number of interleaved channels in the device stream (2 for the stereo M8).
+ * Must be an even number, as the stream is split into stereo pairs.
+ * @return 1 on success, 0 on failure.
+ */
+int audio_channels_open(unsigned int channels);
+
+// Stops stem recording, finalizes the WAV files and releases all buffers.
+void audio_channels_close(void);
+
+// Number of interleaved channels in the device stream, or 0 when the splitter is not open.
+unsigned int audio_channels_get_count(void);
+
+// Size of a single interleaved device frame in bytes.
+unsigned int audio_channels_frame_size(void);
+
+/**
+ * De-interleaves a block of device frames. The monitored pair is pushed into monitor_ring
+ * (if not NULL), and all pairs are queued for stem recording when it is enabled.
+ * Partial frames at the end of the block are ignored.
+ *
+ * @param data Interleaved S16 device frames.
+ * @param length Length of data in bytes.
+ * @param monitor_ring Ring buffer receiving the monitored stereo pair.
+ * @return Number of bytes pushed to monitor_ring.
+ */
+uint32_t audio_channels_process(const uint8_t *data, uint32_t length, RingBuffer *monitor_ring);
+
+/**
+ * Same as audio_channels_process, but writes the monitored pair into a linear buffer.
+ *
+ * @param out Destination for the monitored stereo pair, at least frames * 4 bytes.
+ * @return Number of bytes written to out.
+ */
+uint32_t audio_channels_process_linear(const uint8_t *data, uint32_t length, uint8_t *out);
+
+/**
+ * SIMD de-interleaving kernel: copies each stereo pair of `frames` interleaved frames
+ * into its own contiguous destination buffer.
+ *
+ * @param src Interleaved S16 frames with pairs * 2 channels each, no alignment required.
+ * @param frames Number of frames in src.
+ * @param pairs Number of stereo pairs per frame.
+ * @param dst Array of `pairs` destination buffers, each holding at least `frames` stereo samples.
+ */
+void audio_channels_deinterleave(const void *src, uint32_t frames, unsigned int pairs,
+                                 uint32_t *const *dst);
+
+#endif // AUDIO_CHANNELS_H
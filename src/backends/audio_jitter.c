@@ -0,0 +1,174 @@
+// Copyright 2021 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "audio_jitter.h"
+#include "../metrics.h"
+#include "../sdl_compat.h"
+
+#define FRAME_SIZE 4                  // S16 stereo
+#define SAMPLE_RATE 44100
+#define PLC_PERIOD_FRAMES 256         // ~6 ms of history repeated while concealing
+#define PLC_FADE_FRAMES 882           // concealment fades to silence over ~20 ms
+#define PLC_MAX_FRAMES 2205           // after ~50 ms without data, rebuild the prebuffer
+#define XFADE_FRAMES 64               // ~1.5 ms crossfade between concealed and real audio
+#define PREBUFFER_MIN (2 * 1024)
+#define PREBUFFER_MAX AUDIO_JITTER_PREBUFFER_MAX
+#define PREBUFFER_INITIAL (4 * 1024)
+#define PREBUFFER_STEP (2 * 1024)
+#define UNDERRUNS_BEFORE_GROWTH 3     // underruns within the window that grow the prebuffer
+#define UNDERRUN_WINDOW_FRAMES (SAMPLE_RATE * 10)
+#define SHRINK_INTERVAL_FRAMES (SAMPLE_RATE * 30) // underrun free playback needed to shrink
+
+typedef enum { JITTER_PREBUFFERING, JITTER_PLAYING, JITTER_CONCEALING } jitter_state_t;
+
+static struct {
+  jitter_state_t state;
+  uint32_t prebuffer_target;
+  int16_t history[PLC_PERIOD_FRAMES * 2]; // last played real frames, circular
+  uint32_t history_pos;
+  uint32_t conceal_pos;  // frames concealed in the current dropout
+  uint32_t resume_from;  // concealment position the crossfade to real audio starts from
+  uint32_t xfade_pos;    // frames into that crossfade, XFADE_FRAMES when done
+  uint32_t window_frames;
+  uint32_t window_underruns;
+  uint32_t frames_since_underrun;
+} jitter;
+
+// Read by the USB event thread while calibrating the transfer depth
+static SDL_AtomicInt underruns;
+
+void audio_jitter_reset(void) {
+  SDL_zero(jitter);
+  jitter.state = JITTER_PREBUFFERING;
+  jitter.prebuffer_target = PREBUFFER_INITIAL;
+  jitter.conceal_pos = PLC_FADE_FRAMES; // nothing to conceal yet, start from silence
+  jitter.xfade_pos = XFADE_FRAMES;
+  SDL_SetAtomicInt(&underruns, 0);
+}
+
+uint32_t audio_jitter_get_underruns(void) { return (uint32_t)SDL_GetAtomicInt(&underruns); }
+
+// Concealment signal n frames into a dropout: the last period is repeated from its start,
+// faded in from the last played sample and faded out to silence.
+static int32_t conceal_sample(const uint32_t n, const int channel) {
+  if (n >= PLC_FADE_FRAMES) {
+    return 0;
+  }
+  int32_t sample = jitter.history[((jitter.history_pos + n) % PLC_PERIOD_FRAMES) * 2 + channel];
+  if (n < XFADE_FRAMES) {
+    const int32_t last =
+        jitter.history[((jitter.history_pos + PLC_PERIOD_FRAMES - 1) % PLC_PERIOD_FRAMES) * 2 +
+                       channel];
+    sample = last + (sample - last) * (int32_t)n / XFADE_FRAMES;
+  }
+  return sample * (int32_t)(PLC_FADE_FRAMES - n) / PLC_FADE_FRAMES;
+}
+
+static void conceal(int16_t *samples, const uint32_t frames) {
+  for (uint32_t f = 0; f < frames; f++) {
+    samples[f * 2] = (int16_t)conceal_sample(jitter.conceal_pos, 0);
+    samples[f * 2 + 1] = (int16_t)conceal_sample(jitter.conceal_pos, 1);
+    if (jitter.conceal_pos < PLC_MAX_FRAMES) {
+      jitter.conceal_pos++;
+    }
+  }
+}
+
+// Crossfades the start of the real audio from the concealment signal and remembers the
+// played frames for the next dropout.
+static void play(int16_t *samples, const uint32_t frames) {
+  for (uint32_t f = 0; f < frames && jitter.xfade_pos < XFADE_FRAMES; f++) {
+    const uint32_t k = jitter.xfade_pos++;
+    for (int c = 0; c < 2; c++) {
+      const int32_t from = conceal_sample(jitter.resume_from + k, c);
+      samples[f * 2 + c] =
+          (int16_t)((from * (int32_t)(XFADE_FRAMES - k) + samples[f * 2 + c] * (int32_t)k) /
+                    XFADE_FRAMES);
+    }
+  }
+
+  const uint32_t first = frames > PLC_PERIOD_FRAMES ? frames - PLC_PERIOD_FRAMES : 0;
+  for (uint32_t f = first; f < frames; f++) {
+    jitter.history[jitter.history_pos * 2] = samples[f * 2];
+    jitter.history[jitter.history_pos * 2 + 1] = samples[f * 2 + 1];
+    jitter.history_pos = (jitter.history_pos + 1) % PLC_PERIOD_FRAMES;
+  }
+}
+
+static void register_underrun(void) {
+  SDL_AddAtomicInt(&underruns, 1);
+  jitter.window_underruns++;
+  metrics_count_audio_underrun();
+  jitter.frames_since_underrun = 0;
+  if (jitter.window_underruns >= UNDERRUNS_BEFORE_GROWTH &&
+      jitter.prebuffer_target < PREBUFFER_MAX) {
+    jitter.prebuffer_target += PREBUFFER_STEP;
+    jitter.window_underruns = 0;
+    SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Repeated underruns, prebuffer increased to %u bytes",
+                 jitter.prebuffer_target);
+  }
+}
+
+static void update_adaptation(const uint32_t frames) {
+  jitter.window_frames += frames;
+  if (jitter.window_frames >= UNDERRUN_WINDOW_FRAMES) {
+    jitter.window_frames = 0;
+    jitter.window_underruns = 0;
+  }
+
+  jitter.frames_since_underrun += frames;
+  if (jitter.frames_since_underrun >= SHRINK_INTERVAL_FRAMES) {
+    jitter.frames_since_underrun = 0;
+    if (jitter.prebuffer_target > PREBUFFER_MIN) {
+      jitter.prebuffer_target -= PREBUFFER_STEP;
+      SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Stable playback, prebuffer decreased to %u bytes",
+                   jitter.prebuffer_target);
+    }
+  }
+}
+
+void audio_jitter_read(RingBuffer *ring, uint8_t *out, const uint32_t length) {
+  int16_t *samples = (int16_t *)out;
+  const uint32_t frames = length / FRAME_SIZE;
+
+  update_adaptation(frames);
+  metrics_set_audio_fill(ring->size);
+
+  uint32_t available = ring->size / FRAME_SIZE;
+
+  if (jitter.state != JITTER_PLAYING) {
+    // Rebuild some cushion before resuming: a full prebuffer after a long dropout, half of it
+    // while still concealing. Always wait for at least one full output period.
+    uint32_t threshold = jitter.state == JITTER_PREBUFFERING ? jitter.prebuffer_target
+                                                             : jitter.prebuffer_target / 2;
+    if (threshold < length) {
+      threshold = length;
+    }
+    if (available * FRAME_SIZE < threshold) {
+      conceal(samples, frames);
+      if (jitter.state == JITTER_CONCEALING && jitter.conceal_pos >= PLC_MAX_FRAMES) {
+        jitter.state = JITTER_PREBUFFERING;
+        SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Audio dropout, waiting for %u bytes",
+                     jitter.prebuffer_target);
+      }
+      return;
+    }
+    jitter.state = JITTER_PLAYING;
+    jitter.resume_from = jitter.conceal_pos;
+    jitter.xfade_pos = 0;
+  }
+
+  const uint32_t real = available < frames ? available : frames;
+  if (real > 0) {
+    ring_buffer_pop(ring, out, real * FRAME_SIZE);
+    play(samples, real);
+  }
+
+  if (real < frames) {
+    jitter.state = JITTER_CONCEALING;
+    jitter.conceal_pos = 0;
+    register_underrun();
+    SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Underrun: %u/%u frames, concealing", real, frames);
+    conceal(samples + real * 2, frames - real);
+  }
+}
@@ -0,0 +1,32 @@
+// Copyright 2021 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Jitter buffer for the USB audio path. Hides short underruns by repeating and fading out the
+// last played period, crossfades back to the real stream and adapts the prebuffer size to the
+// underrun rate.
+
+#ifndef AUDIO_JITTER_H
+#define AUDIO_JITTER_H
+
+#include "ringbuffer.h"
+#include <stdint.h>
+
+// Upper bound of the adaptive prebuffer in bytes, the ring feeding the jitter buffer must hold it
+#define AUDIO_JITTER_PREBUFFER_MAX (32 * 1024)
+
+// Resets the playback state, the next read starts with a prebuffer.
+void audio_jitter_reset(void);
+
+/**
+ * Fills an output buffer with S16 stereo frames from the ring, concealing missing data.
+ *
+ * @param ring Ring buffer holding the incoming S16 stereo frames.
+ * @param out Output buffer.
+ * @param length Length of the output buffer in bytes.
+ */
+void audio_jitter_read(RingBuffer *ring, uint8_t *out, uint32_t length);
+
+// Total number of underruns since the last reset.
+uint32_t audio_jitter_get_underruns(void);
+
+#endif // AUDIO_JITTER_H
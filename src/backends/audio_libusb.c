@@ -1,26 +1,77 @@
 #ifdef USE_LIBUSB
 
+#include "../alloc_stats.h"
 #include "../sdl_compat.h"
+#include "../trace.h"
+#include "audio_channels.h"
+#include "audio_jitter.h"
 #include "m8.h"
 #include "ringbuffer.h"
+#include "usb_events.h"
 #include <errno.h>
 #include <libusb.h>
 
 #define EP_ISO_IN 0x85
 #define IFACE_NUM 4
 
-#define NUM_TRANSFERS 64
+#define MAX_TRANSFERS 64
+#define MIN_TRANSFERS 4
+#define MAX_PACKETS 16
+#define DEFAULT_PACKETS 2
 #define PACKET_SIZE 180
-#define NUM_PACKETS 2
+#define PACKET_DURATION_NS 1000000 // one isochronous packet per 1 ms USB frame
+
+// Transfer depth auto-calibration: the completion interval is measured over a window, the depth
+// is reduced to cover the worst gap with a margin and then verified for underruns over another
+// window, growing again if needed
+#define CALIBRATION_WINDOW_NS (3 * SDL_NS_PER_SECOND)
+#define CALIBRATION_MARGIN 2
+
+// USB audio class descriptor constants
+#define USB_DT_CS_INTERFACE 0x24
+#define UAC_AS_GENERAL 0x01
+#define UAC_FORMAT_TYPE 0x02
+#define UAC1_FORMAT_TYPE_I_LENGTH 8
+#define UAC2_AS_GENERAL_LENGTH 16
 
 extern libusb_device_handle *devh;
+extern libusb_context *ctx;
+
+// Audio uses its own libusb context and handle on the same device, so isochronous completions
+// are serviced by a dedicated real-time thread instead of the serial event thread. When the
+// device cannot be reopened (e.g. a wrapped Android file descriptor), the serial handle and its
+// event thread are shared.
+static libusb_context *audio_ctx = NULL;
+static libusb_device_handle *audio_devh = NULL;
+static usb_event_thread_s audio_events;
+static usb_callback_stats_s audio_stats;
+static SDL_AtomicInt transfers_in_flight;
+static SDL_AtomicInt closing; // completed transfers are retired instead of resubmitted
 
 int audio_initialized = 0;
 RingBuffer *audio_buffer = NULL;
-static uint8_t *audio_callback_buffer = NULL;
-static size_t audio_callback_buffer_size = 0;
-static int audio_prebuffer_filled = 0;
-#define PREBUFFER_SIZE (8 * 1024)  // Wait for 8KB before starting playback
+static unsigned int packet_size = PACKET_SIZE;
+
+// Requested transfer depth and packets per transfer, 0 = automatic
+static unsigned int conf_transfers = 0;
+static unsigned int conf_packets = 0;
+static unsigned int num_transfers = MAX_TRANSFERS;
+static unsigned int num_packets = DEFAULT_PACKETS;
+
+// Guards the transfers and their parked flags, walked by both the callbacks and audio_close
+static SDL_Mutex *transfer_mutex = NULL;
+
+// Calibration state, only touched from the thread handling the audio transfer callbacks
+static unsigned int active_transfers = MAX_TRANSFERS; // transfers above this are parked
+static uint8_t parked[MAX_TRANSFERS];
+static struct {
+  int active;
+  int verifying;
+  uint64_t window_end_ns;
+  uint64_t last_ns;
+  uint64_t max_gap_ns;
+  uint32_t underruns;
+} calibration;
 
 #ifdef USE_SDL2
 // ============================================================================
@@ -37,34 +88,12 @@ static void SDLCALL audio_callback_sdl2(void *userdata, Uint8 *stream, int len)
     return;
   }
 
-  uint32_t available_bytes = audio_buffer->size;
-
-  // Check if we have enough data for initial buffering
-  if (!audio_prebuffer_filled && available_bytes < PREBUFFER_SIZE) {
-    SDL_memset(stream, 0, len);
-    return;
-  }
-
-  // Mark prebuffer as filled once we have enough data
-  if (!audio_prebuffer_filled) {
-    audio_prebuffer_filled = 1;
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Audio prebuffer filled, starting playback");
-  }
-
-  if (available_bytes >= (uint32_t)len) {
-    // We have enough data
-    ring_buffer_pop(audio_buffer, stream, len);
-  } else if (available_bytes > 0) {
-    // Partial data - read what we can and pad with silence
-    uint32_t read_len = ring_buffer_pop(audio_buffer, stream, available_bytes);
-    SDL_memset(stream + read_len, 0, len - read_len);
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Partial buffer: %d/%d bytes", available_bytes, len);
-  } else {
-    // No data - output silence and reset prebuffer
-    SDL_memset(stream, 0, len);
-    audio_prebuffer_filled = 0;
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Buffer underflow! Resetting prebuffer");
-  }
+  trace_thread_name("audio");
+  const uint64_t trace_start = trace_begin();
+  const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_AUDIO);
+  audio_jitter_read(audio_buffer, stream, len);
+  alloc_stats_pop_tag(previous_tag);
+  trace_end("audio_callback", trace_start);
 }
 
 #else
@@ -74,72 +103,163 @@ static void SDLCALL audio_callback_sdl2(void *userdata, Uint8 *stream, int len)
 
 SDL_AudioStream *sdl_audio_stream = NULL;
 
+// Larger requests are served in several chunks, so the callback never allocates
+#define AUDIO_CALLBACK_CHUNK 16384
+static uint8_t audio_callback_buffer[AUDIO_CALLBACK_CHUNK];
+
 static void audio_callback(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount) {
   (void)userdata;
   (void)additional_amount;
 
-  // Reallocate callback buffer if needed
-  if (audio_callback_buffer_size < (size_t)total_amount) {
-    audio_callback_buffer = SDL_realloc(audio_callback_buffer, total_amount);
-    if (audio_callback_buffer == NULL) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate audio buffer");
-      return;
+  trace_thread_name("audio");
+  const uint64_t trace_start = trace_begin();
+  const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_AUDIO);
+  while (total_amount > 0) {
+    const int chunk = SDL_min(total_amount, AUDIO_CALLBACK_CHUNK);
+    audio_jitter_read(audio_buffer, audio_callback_buffer, chunk);
+    if (!SDL_PutAudioStreamData(stream, audio_callback_buffer, chunk)) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to put audio stream data: %s",
+                   SDL_GetError());
+      break;
     }
-    audio_callback_buffer_size = (size_t)total_amount;
+    total_amount -= chunk;
   }
+  alloc_stats_pop_tag(previous_tag);
+  trace_end("audio_callback", trace_start);
+}
 
-  // Try to get audio data from ring buffer
-  uint32_t available_bytes = audio_buffer->size;
+#endif // USE_SDL2
 
-  // Check if we have enough data for initial buffering
-  if (!audio_prebuffer_filled && available_bytes < PREBUFFER_SIZE) {
-    SDL_memset(audio_callback_buffer, 0, total_amount);
-    if(!SDL_PutAudioStreamData(stream, audio_callback_buffer, total_amount)) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to put audio stream data: %s", SDL_GetError());
-    }
-    return;
-  }
+// ============================================================================
+// Common libusb transfer handling
+// ============================================================================
 
-  // Mark prebuffer as filled once we have enough data
-  if (!audio_prebuffer_filled) {
-    audio_prebuffer_filled = 1;
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Audio prebuffer filled, starting playback");
-  }
+static struct libusb_transfer *xfr[MAX_TRANSFERS];
 
-  if (available_bytes >= (uint32_t)total_amount) {
-    uint32_t read_len = ring_buffer_pop(audio_buffer, audio_callback_buffer, total_amount);
-    if (read_len > 0) {
-      if(!SDL_PutAudioStreamData(stream, audio_callback_buffer, read_len)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to put audio stream data: %s", SDL_GetError());
-      }
+void audio_usb_configure(const unsigned int transfers, const unsigned int packets) {
+  conf_transfers = transfers > MAX_TRANSFERS ? MAX_TRANSFERS : transfers;
+  conf_packets = packets > MAX_PACKETS ? MAX_PACKETS : packets;
+}
+
+// Releases a transfer that is not resubmitted anymore
+static void retire_transfer(struct libusb_transfer *transfer) {
+  xfr[(intptr_t)transfer->user_data] = NULL;
+  SDL_free(transfer->buffer);
+  libusb_free_transfer(transfer);
+  SDL_AddAtomicInt(&transfers_in_flight, -1);
+}
+
+// Keeps a completed transfer out of the queue, it can be resubmitted if the depth grows again
+static void park_transfer(const struct libusb_transfer *transfer) {
+  parked[(intptr_t)transfer->user_data] = 1;
+  SDL_AddAtomicInt(&transfers_in_flight, -1);
+}
+
+static void free_parked_transfers(void) {
+  for (unsigned int i = 0; i < num_transfers; i++) {
+    if (parked[i] && xfr[i] != NULL) {
+      SDL_free(xfr[i]->buffer);
+      libusb_free_transfer(xfr[i]);
+      xfr[i] = NULL;
     }
-  } else if (available_bytes > 0) {
-    uint32_t read_len = ring_buffer_pop(audio_buffer, audio_callback_buffer, available_bytes);
-    SDL_memset(audio_callback_buffer + read_len, 0, total_amount - read_len);
-    if(!SDL_PutAudioStreamData(stream, audio_callback_buffer, total_amount)) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to put audio stream data: %s", SDL_GetError());
+    parked[i] = 0;
+  }
+}
+
+static void set_transfer_depth(const unsigned int depth) {
+  for (unsigned int i = 0; i < depth; i++) {
+    if (!parked[i] || xfr[i] == NULL) {
+      continue;
     }
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Partial buffer: %d/%d bytes", available_bytes, total_amount);
-  } else {
-    SDL_memset(audio_callback_buffer, 0, total_amount);
-    if(!SDL_PutAudioStreamData(stream, audio_callback_buffer, total_amount)) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to put audio stream data: %s", SDL_GetError());
+    parked[i] = 0;
+    SDL_AddAtomicInt(&transfers_in_flight, 1);
+    const int rc = libusb_submit_transfer(xfr[i]);
+    if (rc < 0) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "error re-submitting URB: %s", libusb_error_name(rc));
+      retire_transfer(xfr[i]);
     }
-    audio_prebuffer_filled = 0;
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Buffer underflow! Resetting prebuffer");
   }
+  active_transfers = depth;
 }
 
-#endif // USE_SDL2
+// Smallest depth whose queued audio outlasts the given completion gap with a margin
+static unsigned int transfers_for_gap(const uint64_t gap_ns) {
+  const uint64_t transfer_ns = (uint64_t)num_packets * PACKET_DURATION_NS;
+  uint64_t depth = (gap_ns * CALIBRATION_MARGIN + transfer_ns - 1) / transfer_ns + 1;
+  if (depth < MIN_TRANSFERS) {
+    depth = MIN_TRANSFERS;
+  }
+  return depth > num_transfers ? num_transfers : (unsigned int)depth;
+}
 
-// ============================================================================
-// Common libusb transfer handling
-// ============================================================================
+static void start_calibration_window(const uint64_t now) {
+  calibration.window_end_ns = now + CALIBRATION_WINDOW_NS;
+  calibration.max_gap_ns = 0;
+  calibration.underruns = audio_jitter_get_underruns();
+}
+
+static void calibrate(const uint64_t now) {
+  if (calibration.last_ns != 0 && now - calibration.last_ns > calibration.max_gap_ns) {
+    calibration.max_gap_ns = now - calibration.last_ns;
+  }
+  calibration.last_ns = now;
+  if (now < calibration.window_end_ns) {
+    return;
+  }
+
+  const uint32_t underruns = audio_jitter_get_underruns() - calibration.underruns;
+  if (!calibration.verifying) {
+    const unsigned int depth = transfers_for_gap(calibration.max_gap_ns);
+    SDL_Log("USB audio: max completion gap %.1f ms, trying %u transfers of %u packets",
+            (double)calibration.max_gap_ns / 1e6, depth, num_packets);
+    set_transfer_depth(depth);
+    calibration.verifying = 1;
+  } else if (underruns > 0 && active_transfers < num_transfers) {
+    unsigned int depth = active_transfers + active_transfers / 2;
+    depth = depth > num_transfers ? num_transfers : depth;
+    SDL_Log("USB audio: %u underruns with %u transfers, growing to %u", underruns,
+            active_transfers, depth);
+    set_transfer_depth(depth);
+  } else {
+    SDL_Log("USB audio: calibrated to %u transfers of %u packets (%u ms queued)",
+            active_transfers, num_packets, active_transfers * num_packets);
+    free_parked_transfers();
+    calibration.active = 0;
+    return;
+  }
+  start_calibration_window(now);
+}
+
+// Resubmits, parks or retires a completed transfer
+static void requeue_transfer(struct libusb_transfer *xfr) {
+  if (SDL_GetAtomicInt(&closing)) {
+    retire_transfer(xfr);
+    return;
+  }
+  if ((intptr_t)xfr->user_data >= (intptr_t)active_transfers) {
+    park_transfer(xfr);
+    return;
+  }
+  const int submit_result = libusb_submit_transfer(xfr);
+  if (submit_result < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "error re-submitting URB: %s", libusb_error_name(submit_result));
+    retire_transfer(xfr);
+  }
+}
 
 static void cb_xfr(struct libusb_transfer *xfr) {
   unsigned int i;
   static int error_count = 0;
 
+  if (xfr->status == LIBUSB_TRANSFER_CANCELLED || xfr->status == LIBUSB_TRANSFER_NO_DEVICE) {
+    SDL_LockMutex(transfer_mutex);
+    retire_transfer(xfr);
+    SDL_UnlockMutex(transfer_mutex);
+    return;
+  }
+
+  const uint64_t start = usb_callback_stats_begin(&audio_stats);
+
   for (i = 0; i < (unsigned int)xfr->num_iso_packets; i++) {
     struct libusb_iso_packet_descriptor *pack = &xfr->iso_packet_desc[i];
 
@@ -159,10 +279,7 @@ static void cb_xfr(struct libusb_transfer *xfr) {
 #else
       if (sdl_audio_stream != 0 && audio_buffer != NULL) {
 #endif
-        uint32_t actual = ring_buffer_push(audio_buffer, data, pack->actual_length);
-        if (actual == (uint32_t)-1) {
-          SDL_LogDebug(SDL_LOG_CATEGORY_SYSTEM, "Buffer overflow!");
-        }
+        audio_channels_process(data, pack->actual_length, audio_buffer);
       }
     }
   }
@@ -171,40 +288,221 @@ static void cb_xfr(struct libusb_transfer *xfr) {
     error_count = 0;
   }
 
-  int submit_result = libusb_submit_transfer(xfr);
-  if (submit_result < 0) {
-    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "error re-submitting URB: %s", libusb_error_name(submit_result));
-    SDL_free(xfr->buffer);
+  SDL_LockMutex(transfer_mutex);
+  if (calibration.active && !SDL_GetAtomicInt(&closing)) {
+    calibrate(start);
+  }
+  requeue_transfer(xfr);
+  SDL_UnlockMutex(transfer_mutex);
+
+  usb_callback_stats_end(&audio_stats, start);
+}
+
+// Reads the channel count and maximum packet size of the streaming interface from the
+// class specific descriptors. Falls back to the stereo defaults if they cannot be parsed.
+static void read_stream_format(unsigned int *channels, unsigned int *max_packet_size) {
+  struct libusb_config_descriptor *config;
+
+  *channels = 2;
+  *max_packet_size = PACKET_SIZE;
+
+  if (libusb_get_active_config_descriptor(libusb_get_device(audio_devh), &config) != 0) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO, "Cannot read USB configuration, assuming stereo audio");
+    return;
+  }
+
+  for (int i = 0; i < config->bNumInterfaces; i++) {
+    const struct libusb_interface *interface = &config->interface[i];
+    for (int a = 0; a < interface->num_altsetting; a++) {
+      const struct libusb_interface_descriptor *alt = &interface->altsetting[a];
+      if (alt->bInterfaceNumber != IFACE_NUM || alt->bAlternateSetting != 1) {
+        continue;
+      }
+
+      const unsigned char *extra = alt->extra;
+      int remaining = alt->extra_length;
+      while (remaining >= 3 && extra[0] >= 3 && extra[0] <= remaining) {
+        if (extra[1] == USB_DT_CS_INTERFACE) {
+          if (extra[2] == UAC_FORMAT_TYPE && extra[0] >= UAC1_FORMAT_TYPE_I_LENGTH) {
+            // UAC1 Type I format: bFormatType, bNrChannels, ...
+            *channels = extra[4];
+          } else if (extra[2] == UAC_AS_GENERAL && extra[0] == UAC2_AS_GENERAL_LENGTH) {
+            // UAC2 AS general: bNrChannels follows bmFormats
+            *channels = extra[10];
+          }
+        }
+        remaining -= extra[0];
+        extra += extra[0];
+      }
+
+      for (int e = 0; e < alt->bNumEndpoints; e++) {
+        if (alt->endpoint[e].bEndpointAddress == EP_ISO_IN) {
+          *max_packet_size = alt->endpoint[e].wMaxPacketSize & 0x7FF;
+        }
+      }
+    }
+  }
+
+  libusb_free_config_descriptor(config);
+}
+
+// Opens the M8 again in a separate libusb context, found by its bus number and address.
+// Falls back to sharing the serial handle.
+static void open_audio_handle(void) {
+  libusb_device *device = libusb_get_device(devh);
+  const uint8_t bus = libusb_get_bus_number(device);
+  const uint8_t address = libusb_get_device_address(device);
+
+  audio_ctx = NULL;
+  audio_devh = devh;
+
+  libusb_context *new_ctx = NULL;
+  if (libusb_init(&new_ctx) < 0) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO, "Cannot create audio USB context, sharing serial events");
+    return;
+  }
+
+  libusb_device **device_list = NULL;
+  const ssize_t count = libusb_get_device_list(new_ctx, &device_list);
+  for (ssize_t i = 0; i < count; i++) {
+    if (libusb_get_bus_number(device_list[i]) == bus &&
+        libusb_get_device_address(device_list[i]) == address) {
+      libusb_device_handle *handle = NULL;
+      const int rc = libusb_open(device_list[i], &handle);
+      if (rc == 0) {
+        audio_ctx = new_ctx;
+        audio_devh = handle;
+      } else {
+        SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO, "Cannot reopen device for audio: %s",
+                    libusb_error_name(rc));
+      }
+      break;
+    }
+  }
+  if (count > 0) {
+    libusb_free_device_list(device_list, 1);
+  }
+
+  if (audio_ctx == NULL) {
+    SDL_LogInfo(SDL_LOG_CATEGORY_AUDIO, "Audio shares the serial USB event thread");
+    libusb_exit(new_ctx);
   }
 }
 
-static struct libusb_transfer *xfr[NUM_TRANSFERS];
+static void close_audio_handle(void) {
+  usb_event_thread_stop(&audio_events);
+  if (audio_ctx != NULL) {
+    libusb_close(audio_devh);
+    libusb_exit(audio_ctx);
+  }
+  audio_ctx = NULL;
+  audio_devh = NULL;
+}
 
 static int benchmark_in() {
-  int i;
+  unsigned int i;
 
-  for (i = 0; i < NUM_TRANSFERS; i++) {
-    xfr[i] = libusb_alloc_transfer(NUM_PACKETS);
-    if (!xfr[i]) {
+  // The transfers submitted first can complete on the event thread while the rest are set up
+  SDL_LockMutex(transfer_mutex);
+  for (i = 0; i < num_transfers; i++) {
+    xfr[i] = libusb_alloc_transfer(num_packets);
+    Uint8 *buffer = xfr[i] != NULL ? SDL_malloc(packet_size * num_packets) : NULL;
+    if (buffer == NULL) {
       SDL_Log("Could not allocate transfer");
+      if (xfr[i] != NULL) {
+        libusb_free_transfer(xfr[i]);
+        xfr[i] = NULL;
+      }
+      SDL_UnlockMutex(transfer_mutex);
       return -ENOMEM;
     }
 
-    Uint8 *buffer = SDL_malloc(PACKET_SIZE * NUM_PACKETS);
+    libusb_fill_iso_transfer(xfr[i], audio_devh, EP_ISO_IN, buffer, packet_size * num_packets,
+                             num_packets, cb_xfr, (void *)(intptr_t)i, 0);
+    libusb_set_iso_packet_lengths(xfr[i], packet_size);
 
-    libusb_fill_iso_transfer(xfr[i], devh, EP_ISO_IN, buffer, PACKET_SIZE * NUM_PACKETS,
-                             NUM_PACKETS, cb_xfr, NULL, 0);
-    libusb_set_iso_packet_lengths(xfr[i], PACKET_SIZE);
-
-    libusb_submit_transfer(xfr[i]);
+    SDL_AddAtomicInt(&transfers_in_flight, 1);
+    if (libusb_submit_transfer(xfr[i]) < 0) {
+      retire_transfer(xfr[i]);
+    }
   }
+  SDL_UnlockMutex(transfer_mutex);
 
   return 1;
 }
 
-int audio_initialize(const char *output_device_name, unsigned int audio_buffer_size) {
-  (void)audio_buffer_size;
+// Cancels every submitted transfer and frees them all once none is in flight
+static void stop_transfers(void) {
+  int rc;
+
+  // Completions are handled on this thread from here on. With its own context the audio event
+  // thread is stopped, otherwise libusb lets the serial event thread and this one take turns.
+  SDL_SetAtomicInt(&closing, 1);
+  usb_event_thread_stop(&audio_events);
+  libusb_context *events_ctx = audio_ctx != NULL ? audio_ctx : ctx;
+
+  SDL_LockMutex(transfer_mutex);
+  for (unsigned int i = 0; i < num_transfers; i++) {
+    if (xfr[i] == NULL || parked[i]) {
+      continue;
+    }
+    rc = libusb_cancel_transfer(xfr[i]);
+    if (rc < 0) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error cancelling transfer: %s\n",
+                   libusb_error_name(rc));
+    }
+  }
+  SDL_UnlockMutex(transfer_mutex);
+
+  // Every transfer still in flight completes or is cancelled, only then can they be freed
+  while (SDL_GetAtomicInt(&transfers_in_flight) > 0) {
+    struct timeval timeout = {0, 100000};
+    rc = libusb_handle_events_timeout_completed(events_ctx, &timeout, NULL);
+    if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_INTERRUPTED) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error waiting for %d audio transfers: %s",
+                   SDL_GetAtomicInt(&transfers_in_flight), libusb_error_name(rc));
+      break;
+    }
+  }
+  SDL_LockMutex(transfer_mutex);
+  free_parked_transfers();
+  SDL_UnlockMutex(transfer_mutex);
+}
+
+// Undoes audio_initialize from the claimed interface on, also after a partial initialization
+static void release_audio(void) {
+  stop_transfers();
+
+  SDL_Log("Freeing interface %d", IFACE_NUM);
 
+  const int rc = libusb_release_interface(audio_devh, IFACE_NUM);
+  if (rc < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error releasing interface: %s\n", libusb_error_name(rc));
+  }
+  close_audio_handle();
+
+#ifdef USE_SDL2
+  if (audio_device_id != 0) {
+    SDL_Log("Closing audio device");
+    SDL_CloseAudioDevice(audio_device_id);
+    audio_device_id = 0;
+  }
+#else
+  if (sdl_audio_stream != NULL) {
+    SDL_Log("Closing audio device");
+    SDL_DestroyAudioStream(sdl_audio_stream);
+    sdl_audio_stream = 0;
+  }
+#endif
+
+  audio_channels_close();
+  if (audio_buffer != NULL) {
+    ring_buffer_free(audio_buffer);
+    audio_buffer = NULL;
+  }
+}
+
+int audio_initialize(const char *output_device_name, unsigned int audio_buffer_size) {
   SDL_Log("USB audio setup");
 
   if (devh == NULL) {
@@ -212,44 +510,67 @@ int audio_initialize(const char *output_device_name, unsigned int audio_buffer_s
     return -1;
   }
 
+  open_audio_handle();
+
   int rc;
 
-  rc = libusb_kernel_driver_active(devh, IFACE_NUM);
+  rc = libusb_kernel_driver_active(audio_devh, IFACE_NUM);
   if (rc < 0) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error checking kernel driver status: %s", libusb_error_name(rc));
+    close_audio_handle();
     return rc;
   }
   if (rc == 1) {
     SDL_Log("Detaching kernel driver");
-    rc = libusb_detach_kernel_driver(devh, IFACE_NUM);
+    rc = libusb_detach_kernel_driver(audio_devh, IFACE_NUM);
     if (rc < 0) {
       SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Could not detach kernel driver: %s", libusb_error_name(rc));
+      close_audio_handle();
       return rc;
     }
   }
 
-  rc = libusb_claim_interface(devh, IFACE_NUM);
+  rc = libusb_claim_interface(audio_devh, IFACE_NUM);
   if (rc < 0) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error claiming interface: %s\n", libusb_error_name(rc));
+    close_audio_handle();
     return rc;
   }
 
-  rc = libusb_set_interface_alt_setting(devh, IFACE_NUM, 1);
+  rc = libusb_set_interface_alt_setting(audio_devh, IFACE_NUM, 1);
   if (rc < 0) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error setting alt setting: %s\n", libusb_error_name(rc));
-    return rc;
+    goto fail;
+  }
+
+  unsigned int channels;
+  read_stream_format(&channels, &packet_size);
+
+  num_packets = conf_packets > 0 ? conf_packets : DEFAULT_PACKETS;
+  num_transfers = conf_transfers > 0 ? conf_transfers : MAX_TRANSFERS;
+  active_transfers = num_transfers;
+  SDL_SetAtomicInt(&closing, 0);
+  if (transfer_mutex == NULL) {
+    transfer_mutex = SDL_CreateMutex();
   }
+  SDL_zero(parked);
+  SDL_zero(calibration);
+  calibration.active = conf_transfers == 0;
+  SDL_Log("USB audio: %u transfers of %u packets%s", num_transfers, num_packets,
+          calibration.active ? ", calibrating" : "");
 
 #ifdef USE_SDL2
   if (SDL_Init(SDL_INIT_AUDIO) < 0) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Init audio failed %s", SDL_GetError());
-    return -1;
+    rc = -1;
+    goto fail;
   }
 #else
   if (!SDL_WasInit(SDL_INIT_AUDIO)) {
     if (!SDL_InitSubSystem(SDL_INIT_AUDIO)) {
       SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Init audio failed %s", SDL_GetError());
-      return -1;
+      rc = -1;
+      goto fail;
     }
   } else {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Audio was already initialised");
@@ -259,8 +580,17 @@ int audio_initialize(const char *output_device_name, unsigned int audio_buffer_s
   SDL_Log("Current audio driver is %s and device %s", SDL_GetCurrentAudioDriver(),
           output_device_name);
 
-  // Create larger ring buffer for stable audio
-  audio_buffer = ring_buffer_create(256 * 1024);
+  if (!audio_channels_open(channels)) {
+    rc = -1;
+    goto fail;
+  }
+
+  // The ring has to absorb a burst of every queued transfer completing at once on top of the
+  // largest prebuffer and one output period
+  const unsigned int output_frames = audio_buffer_size > 0 ? audio_buffer_size : 4096;
+  const uint32_t burst = num_transfers * num_packets * packet_size * 2 / channels;
+  audio_buffer = ring_buffer_create(2 * (burst + AUDIO_JITTER_PREBUFFER_MAX + output_frames * 4));
+  audio_jitter_reset();
 
 #ifdef USE_SDL2
   // SDL2: Use callback-based audio
@@ -292,8 +622,8 @@ int audio_initialize(const char *output_device_name, unsigned int audio_buffer_s
 
   if (audio_device_id == 0) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Failed to open audio device: %s", SDL_GetError());
-    ring_buffer_free(audio_buffer);
-    return -1;
+    rc = -1;
+    goto fail;
   }
 
   SDL_PauseAudioDevice(audio_device_id, 0);  // Start playback
@@ -314,8 +644,8 @@ int audio_initialize(const char *output_device_name, unsigned int audio_buffer_s
 
   if (sdl_audio_stream == NULL) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Failed to open audio stream: %s", SDL_GetError());
-    ring_buffer_free(audio_buffer);
-    return -1;
+    rc = -1;
+    goto fail;
   }
 
   SDL_ResumeAudioStreamDevice(sdl_audio_stream);
@@ -325,13 +655,22 @@ int audio_initialize(const char *output_device_name, unsigned int audio_buffer_s
   SDL_LogDebug(SDL_LOG_CATEGORY_SYSTEM, "Starting capture");
   if ((rc = benchmark_in()) < 0) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Capture failed to start: %d", rc);
-    return rc;
+    goto fail;
+  }
+
+  usb_callback_stats_init(&audio_stats, "Audio");
+  if (audio_ctx != NULL) {
+    usb_event_thread_start(&audio_events, audio_ctx, "USB audio",
+                           SDL_THREAD_PRIORITY_TIME_CRITICAL);
   }
 
   audio_initialized = 1;
-  audio_prebuffer_filled = 0;
   SDL_Log("Successful init");
   return 1;
+
+fail:
+  release_audio();
+  return rc;
 }
 
 void audio_close() {
@@ -346,52 +685,9 @@ void audio_close() {
 
   SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Closing audio");
 
-  int rc;
-
-  for (int i = 0; i < NUM_TRANSFERS; i++) {
-    rc = libusb_cancel_transfer(xfr[i]);
-    if (rc < 0) {
-      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error cancelling transfer: %s\n",
-                   libusb_error_name(rc));
-    }
-  }
-
-  SDL_Log("Freeing interface %d", IFACE_NUM);
-
-  rc = libusb_release_interface(devh, IFACE_NUM);
-  if (rc < 0) {
-    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error releasing interface: %s\n", libusb_error_name(rc));
-    return;
-  }
-
-#ifdef USE_SDL2
-  if (audio_device_id != 0) {
-    SDL_Log("Closing audio device");
-    SDL_CloseAudioDevice(audio_device_id);
-    audio_device_id = 0;
-  }
-#else
-  if (sdl_audio_stream != NULL) {
-    SDL_Log("Closing audio device");
-    SDL_DestroyAudioStream(sdl_audio_stream);
-    sdl_audio_stream = 0;
-  }
-
-  // Free callback buffer (SDL3 only uses this)
-  if (audio_callback_buffer) {
-    SDL_free(audio_callback_buffer);
-    audio_callback_buffer = NULL;
-    audio_callback_buffer_size = 0;
-  }
-#endif
-
+  release_audio();
   SDL_LogDebug(SDL_LOG_CATEGORY_SYSTEM, "Audio closed");
-
-  ring_buffer_free(audio_buffer);
-  audio_buffer = NULL;
-
   audio_initialized = 0;
-  audio_prebuffer_filled = 0;
 }
 
 void audio_toggle(const char *output_device_name, unsigned int audio_buffer_size) {
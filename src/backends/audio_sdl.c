@@ -3,6 +3,11 @@
 #ifndef USE_LIBUSB
 #include "audio.h"
 #include "../sdl_compat.h"
+#include "audio_channels.h"
+#include "../alloc_stats.h"
+#include "../audio_meter.h"
+#include "../metrics.h"
+#include "../trace.h"
 
 #ifdef USE_SDL2
 // ============================================================================
@@ -24,14 +29,19 @@ static SDL_AudioDeviceID audio_dev_out = 0;
 static SDL_AudioDeviceID audio_dev_in = 0;
 static unsigned int audio_paused = 0;
 static unsigned int audio_initialized = 0;
+static unsigned int split_channels = 0;
 
 static void SDLCALL audio_callback_sdl2(void *userdata, Uint8 *stream, int len) {
   (void)userdata;
 
+  trace_thread_name("audio");
+  const uint64_t trace_start = trace_begin();
+  const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_AUDIO);
   SDL_LockMutex(ring_mutex);
 
   size_t available = ring_buffer_used;
   size_t to_copy = (size_t)len < available ? (size_t)len : available;
+  metrics_set_audio_fill((uint32_t)available);
 
   if (to_copy > 0) {
     size_t first_part = AUDIO_RING_BUFFER_SIZE - ring_read_pos;
@@ -48,10 +58,13 @@ static void SDLCALL audio_callback_sdl2(void *userdata, Uint8 *stream, int len)
 
   // Fill remaining with silence
   if (to_copy < (size_t)len) {
+    metrics_count_audio_underrun();
     memset(stream + to_copy, 0, len - to_copy);
   }
 
   SDL_UnlockMutex(ring_mutex);
+  alloc_stats_pop_tag(previous_tag);
+  trace_end("audio_callback", trace_start);
 }
 
 // Called periodically to capture input audio and push to ring buffer
@@ -60,27 +73,43 @@ static void audio_capture_sdl2(void) {
     return;
 
   Uint8 temp[4096];
+  Uint8 monitor[4096];
   Uint32 available = SDL_GetQueuedAudioSize(audio_dev_in);
 
   while (available > 0) {
     Uint32 to_read = available > sizeof(temp) ? sizeof(temp) : available;
+    if (split_channels) {
+      // Only dequeue whole multichannel frames
+      to_read -= to_read % audio_channels_frame_size();
+      if (to_read == 0)
+        break;
+    }
     Uint32 got = SDL_DequeueAudio(audio_dev_in, temp, to_read);
     if (got == 0)
       break;
 
+    const Uint8 *src = temp;
+    Uint32 src_len = got;
+    if (split_channels) {
+      src_len = audio_channels_process_linear(temp, got, monitor);
+      src = monitor;
+    } else {
+      audio_meter_push(temp, got / 4);
+    }
+
     SDL_LockMutex(ring_mutex);
 
     size_t space = AUDIO_RING_BUFFER_SIZE - ring_buffer_used;
-    size_t to_write = got < space ? got : space;
+    size_t to_write = src_len < space ? src_len : space;
 
     if (to_write > 0) {
       size_t first_part = AUDIO_RING_BUFFER_SIZE - ring_write_pos;
       if (first_part >= to_write) {
-        memcpy(audio_ring_buffer + ring_write_pos, temp, to_write);
+        memcpy(audio_ring_buffer + ring_write_pos, src, to_write);
         ring_write_pos = (ring_write_pos + to_write) % AUDIO_RING_BUFFER_SIZE;
       } else {
-        memcpy(audio_ring_buffer + ring_write_pos, temp, first_part);
-        memcpy(audio_ring_buffer, temp + first_part, to_write - first_part);
+        memcpy(audio_ring_buffer + ring_write_pos, src, first_part);
+        memcpy(audio_ring_buffer, src + first_part, to_write - first_part);
         ring_write_pos = to_write - first_part;
       }
       ring_buffer_used += to_write;
@@ -134,6 +163,18 @@ int audio_initialize(const char *output_device_name, const unsigned int audio_bu
     return 0;
   }
 
+  // The multichannel M8 exposes more than one stereo pair, split them if needed
+  unsigned int channels = 2;
+  SDL_AudioSpec device_spec;
+  if (SDL_GetAudioDeviceSpec(m8_device_index, 1, &device_spec) == 0 && device_spec.channels > 2) {
+    channels = device_spec.channels;
+  }
+  split_channels = (channels > 2 || audio_channels_recording_requested()) &&
+                   audio_channels_open(channels);
+  if (!split_channels) {
+    channels = 2;
+  }
+
   // Find output device
   if (output_device_name != NULL) {
     int num_playback = SDL_GetNumAudioDevices(0);
@@ -151,6 +192,7 @@ int audio_initialize(const char *output_device_name, const unsigned int audio_bu
   audio_ring_buffer = SDL_malloc(AUDIO_RING_BUFFER_SIZE);
   if (!audio_ring_buffer) {
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to allocate ring buffer");
+    audio_channels_close();
     return 0;
   }
   memset(audio_ring_buffer, 0, AUDIO_RING_BUFFER_SIZE);
@@ -159,6 +201,7 @@ int audio_initialize(const char *output_device_name, const unsigned int audio_bu
   if (!ring_mutex) {
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to create mutex");
     SDL_free(audio_ring_buffer);
+    audio_channels_close();
     return 0;
   }
 
@@ -178,6 +221,7 @@ int audio_initialize(const char *output_device_name, const unsigned int audio_bu
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to open output device: %s", SDL_GetError());
     SDL_DestroyMutex(ring_mutex);
     SDL_free(audio_ring_buffer);
+    audio_channels_close();
     return 0;
   }
 
@@ -189,18 +233,21 @@ int audio_initialize(const char *output_device_name, const unsigned int audio_bu
   SDL_zero(want_in);
   want_in.freq = 44100;
   want_in.format = AUDIO_S16LSB;
-  want_in.channels = 2;
+  want_in.channels = channels;
   want_in.samples = audio_buffer_size > 0 ? audio_buffer_size : 1024;
   want_in.callback = NULL; // Use queue-based capture
 
+  // The channel splitter needs the exact 44.1kHz S16 frames, let SDL convert if necessary
   const char *m8_name = SDL_GetAudioDeviceName(m8_device_index, 1);
-  audio_dev_in = SDL_OpenAudioDevice(m8_name, 1, &want_in, &have_in, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+  audio_dev_in = SDL_OpenAudioDevice(m8_name, 1, &want_in, &have_in,
+                                     split_channels ? 0 : SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
 
   if (audio_dev_in == 0) {
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to open M8 input device: %s", SDL_GetError());
     SDL_CloseAudioDevice(audio_dev_out);
     SDL_DestroyMutex(ring_mutex);
     SDL_free(audio_ring_buffer);
+    audio_channels_close();
     return 0;
   }
 
@@ -237,6 +284,9 @@ void audio_close(void) {
   audio_ring_buffer = NULL;
   ring_read_pos = ring_write_pos = ring_buffer_used = 0;
 
+  audio_channels_close();
+  split_channels = 0;
+
   SDL_QuitSubSystem(SDL_INIT_AUDIO);
   audio_initialized = 0;
 }
@@ -254,12 +304,10 @@ SDL_AudioStream *audio_stream_in, *audio_stream_out;
 
 static unsigned int audio_paused = 0;
 static unsigned int audio_initialized = 0;
+static unsigned int split_channels = 0;
 static SDL_AudioSpec audio_spec_in = {SDL_AUDIO_S16LE, 2, 44100};
 
-static void SDLCALL audio_cb_out(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount) {
-  // suppress compiler warnings
-  (void)userdata;
-
+static void feed_output(SDL_AudioStream *stream, int additional_amount, int total_amount) {
   if (additional_amount <= 0) {
     return;
   }
@@ -272,6 +320,7 @@ static void SDLCALL audio_cb_out(void *userdata, SDL_AudioStream *stream, int ad
     audio_close();
     return;
   }
+  metrics_set_audio_fill((uint32_t)bytes_available);
 
   // Decide how much to feed this time.
   int to_write_goal = additional_amount;
@@ -284,6 +333,7 @@ static void SDLCALL audio_cb_out(void *userdata, SDL_AudioStream *stream, int ad
 
   int to_write = to_write_goal;
   Uint8 temp[4096];
+  Uint8 monitor[4096];
 
   while (to_write > 0) {
     int still_avail = SDL_GetAudioStreamAvailable(audio_stream_in);
@@ -293,7 +343,16 @@ static void SDLCALL audio_cb_out(void *userdata, SDL_AudioStream *stream, int ad
 
     int chunk = still_avail;
     if (chunk > (int)sizeof(temp)) chunk = (int)sizeof(temp);
-    if (chunk > to_write) chunk = to_write;
+    if (split_channels) {
+      // to_write counts monitored stereo bytes, read the matching number of whole input frames
+      const int frame_size = (int)audio_channels_frame_size();
+      const int wanted = to_write / 4 * frame_size;
+      if (chunk > wanted) chunk = wanted;
+      chunk -= chunk % frame_size;
+      if (chunk == 0) break;
+    } else if (chunk > to_write) {
+      chunk = to_write;
+    }
 
     const int got = SDL_GetAudioStreamData(audio_stream_in, temp, chunk);
     if (got == -1) {
@@ -307,7 +366,14 @@ static void SDLCALL audio_cb_out(void *userdata, SDL_AudioStream *stream, int ad
       break; // no data currently available
     }
 
-    if (!SDL_PutAudioStreamData(stream, temp, got)) {
+    const Uint8 *out = temp;
+    int out_len = got;
+    if (split_channels) {
+      out_len = (int)audio_channels_process_linear(temp, got, monitor);
+      out = monitor;
+    }
+
+    if (!SDL_PutAudioStreamData(stream, out, out_len)) {
       SDL_LogError(SDL_LOG_CATEGORY_AUDIO,
                    "Error putting audio stream data: %s, destroying audio",
                    SDL_GetError());
@@ -315,10 +381,26 @@ static void SDLCALL audio_cb_out(void *userdata, SDL_AudioStream *stream, int ad
       return;
     }
 
-    to_write -= got;
+    to_write -= out_len;
+  }
+
+  if (to_write_goal - to_write < additional_amount) {
+    metrics_count_audio_underrun();
   }
 }
 
+static void SDLCALL audio_cb_out(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount) {
+  // suppress compiler warnings
+  (void)userdata;
+
+  trace_thread_name("audio");
+  const uint64_t trace_start = trace_begin();
+  const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_AUDIO);
+  feed_output(stream, additional_amount, total_amount);
+  alloc_stats_pop_tag(previous_tag);
+  trace_end("audio_cb_out", trace_start);
+}
+
 void audio_toggle(const char *output_device_name, unsigned int audio_buffer_size) {
   if (!audio_initialized) {
     audio_initialize(output_device_name, audio_buffer_size);
@@ -395,6 +477,15 @@ int audio_initialize(const char *output_device_name, const unsigned int audio_bu
     return 0;
   }
 
+  // The multichannel M8 exposes more than one stereo pair. The input is always read as raw
+  // 44.1kHz S16 frames so the monitored pair can be split off and metered before conversion.
+  unsigned int channels = 2;
+  SDL_AudioSpec device_spec;
+  if (SDL_GetAudioDeviceFormat(m8_device_id, &device_spec, NULL) && device_spec.channels > 2) {
+    channels = device_spec.channels;
+  }
+  split_channels = audio_channels_open(channels);
+
   char audio_buffer_size_str[256];
   SDL_snprintf(audio_buffer_size_str, sizeof(audio_buffer_size_str), "%d", audio_buffer_size);
   if (audio_buffer_size > 0) {
@@ -412,20 +503,35 @@ int audio_initialize(const char *output_device_name, const unsigned int audio_bu
 
   if (!audio_stream_out) {
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Error opening audio output device: %s", SDL_GetError());
+    audio_channels_close();
     return 0;
   }
   SDL_LogInfo(SDL_LOG_CATEGORY_AUDIO,
               "Opening audio output: rate %dhz, buffer size: %d frames", audio_spec_out.freq,
               audio_out_buffer_size_real);
 
-  audio_stream_in = SDL_OpenAudioDeviceStream(m8_device_id, &audio_spec_in, NULL, NULL);
+  if (split_channels) {
+    // Read the raw interleaved frames, the output stream converts the monitored pair
+    const SDL_AudioSpec spec_split = {SDL_AUDIO_S16LE, (int)channels, AUDIO_CHANNELS_SAMPLE_RATE};
+    const SDL_AudioSpec spec_monitor = {SDL_AUDIO_S16LE, 2, AUDIO_CHANNELS_SAMPLE_RATE};
+    audio_stream_in = SDL_OpenAudioDeviceStream(m8_device_id, &spec_split, NULL, NULL);
+    if (audio_stream_in) {
+      SDL_SetAudioStreamFormat(audio_stream_out, &spec_monitor, NULL);
+    }
+  } else {
+    audio_stream_in = SDL_OpenAudioDeviceStream(m8_device_id, &audio_spec_in, NULL, NULL);
+  }
   if (!audio_stream_in) {
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Error opening audio input device: %s", SDL_GetError());
     SDL_DestroyAudioStream(audio_stream_out);
+    audio_channels_close();
+    split_channels = 0;
     return 0;
   }
 
-  SDL_SetAudioStreamFormat(audio_stream_in, &audio_spec_in, &audio_spec_out);
+  if (!split_channels) {
+    SDL_SetAudioStreamFormat(audio_stream_in, &audio_spec_in, &audio_spec_out);
+  }
   SDL_GetAudioDeviceFormat(m8_device_id, &audio_spec_in, &audio_in_buffer_size_real);
   SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Audiospec In: format %d, channels %d, rate %d, buffer size %d frames",
                audio_spec_in.format, audio_spec_in.channels, audio_spec_in.freq, audio_in_buffer_size_real);
@@ -447,6 +553,8 @@ void audio_close(void) {
   SDL_Log("Closing audio devices");
   SDL_DestroyAudioStream(audio_stream_in);
   SDL_DestroyAudioStream(audio_stream_out);
+  audio_channels_close();
+  split_channels = 0;
   SDL_QuitSubSystem(SDL_INIT_AUDIO);
   audio_initialized = 0;
 }
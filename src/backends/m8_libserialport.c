@@ -11,6 +11,11 @@
 #include <string.h>
 
 #include "../command.h"
+#include "../flight_recorder.h"
+#include "../latency.h"
+#include "../log_ring.h"
+#include "../metrics.h"
+#include "../trace.h"
 #include "../config.h"
 #include "m8.h"
 #include "queue.h"
@@ -25,6 +30,7 @@ static uint8_t serial_buffer[SERIAL_READ_SIZE] = {0};
 static uint8_t slip_buffer[SERIAL_READ_SIZE] = {0};
 static slip_handler_s slip;
 message_queue_s queue;
+static uint64_t read_arrival_ns = 0; // when the bytes being decoded were read
 
 SDL_Thread *serial_thread = NULL;
 
@@ -39,7 +45,8 @@ thread_params_s thread_params;
 static int check(enum sp_return result);
 
 static int send_message_to_queue(uint8_t *data, const uint32_t size) {
-  push_message(&queue, data, size);
+  latency_record(LATENCY_STAGE_DECODE, read_arrival_ns, latency_now());
+  push_message_stamped(&queue, data, size, read_arrival_ns);
   return 1;
 }
 
@@ -117,12 +124,17 @@ static int serial_port_connected() {
 }
 
 static void process_received_bytes(const uint8_t *buffer, int bytes_read, slip_handler_s *slip) {
+  read_arrival_ns = latency_now();
+  metrics_count_bytes_read((uint32_t)bytes_read);
+  flight_recorder_bytes(buffer, (size_t)bytes_read);
   const uint8_t *cur = buffer;
   const uint8_t *end = buffer + bytes_read;
   while (cur < end) {
     const int slip_result = slip_read_byte(slip, *cur++);
     if (slip_result != SLIP_NO_ERROR) {
-      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SLIP error %d", slip_result);
+      metrics_count_slip_error(slip_result);
+      flight_recorder_trigger(FLIGHT_REASON_SLIP_ERROR);
+      log_async(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "SLIP error %d", slip_result);
     }
   }
 }
@@ -130,6 +142,7 @@ static void process_received_bytes(const uint8_t *buffer, int bytes_read, slip_h
 static int thread_process_serial_data(void *data) {
   const thread_params_s *thread_params = data;
 
+  trace_thread_name("serial");
   while (!thread_params->should_stop) {
     // attempt to read from serial port
     const int bytes_read = sp_nonblocking_read(m8_port, serial_buffer, SERIAL_READ_SIZE);
@@ -141,7 +154,9 @@ static int thread_process_serial_data(void *data) {
     }
 
     if (bytes_read > 0) {
+      const uint64_t trace_start = trace_begin();
       process_received_bytes(serial_buffer, bytes_read, &slip);
+      trace_end("serial_read", trace_start);
     }
 
     SDL_Delay(SERIAL_READ_DELAY_MS);
@@ -397,14 +412,15 @@ int m8_process_data(const config_params_s *conf) {
   }
 
   if (queue_size(&queue) > 0) {
-    unsigned char *command;
+    const unsigned char *command;
     empty_cycles = 0;
     size_t length = 0;
-    while ((command = pop_message(&queue, &length)) != NULL) {
+    latency_stamps_s stamps;
+    while ((command = pop_message_stamped(&queue, &length, &stamps)) != NULL) {
       if (length > 0) {
         process_command(command, length);
+        latency_message_processed(command[0], &stamps);
       }
-      SDL_free(command);
     }
   } else {
     empty_cycles++;
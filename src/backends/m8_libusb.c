@@ -11,8 +11,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../command.h"
+#include "../flight_recorder.h"
+#include "../latency.h"
+#include "../log_ring.h"
+#include "../metrics.h"
 #include "queue.h"
 #include "slip.h"
+#include "usb_events.h"
 
 static int ep_out_addr = 0x03;
 static int ep_in_addr = 0x83;
@@ -32,17 +37,20 @@ static uint8_t serial_buffer[SERIAL_READ_SIZE] = {0};
 static uint8_t slip_buffer[SERIAL_READ_SIZE] = {0};
 static slip_handler_s slip;
 message_queue_s queue;
-static int do_exit = 0;
+static usb_event_thread_s display_events;
+static usb_callback_stats_s display_stats;
 static int async_transfer_active = 0;
 static struct libusb_transfer *async_transfer = NULL;
 static int shutdown_in_progress = 0;
+static uint64_t read_arrival_ns = 0; // when the transfer being decoded completed
 
 static int is_m8_device(uint16_t pid) {
   return (pid == M8_PID_STEREO || pid == M8_PID_MULTICHANNEL);
 }
 
 static int send_message_to_queue(uint8_t *data, const uint32_t size) {
-  push_message(&queue, data, size);
+  latency_record(LATENCY_STAGE_DECODE, read_arrival_ns, latency_now());
+  push_message_stamped(&queue, data, size, read_arrival_ns);
   return 1;
 }
 
@@ -75,22 +83,6 @@ int m8_list_devices() {
   return 0;
 }
 
-static int usb_loop(void *data) {
-  (void)data;  // Suppress unused parameter warning
-  
-  SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
-  while (!do_exit) {
-    int rc = libusb_handle_events(ctx);
-    if (rc != LIBUSB_SUCCESS) {
-      SDL_Log("Audio loop error: %s\n", libusb_error_name(rc));
-      break;
-    }
-  }
-  return 0;
-}
-
-static SDL_Thread *usb_thread;
-
 static void LIBUSB_CALL xfr_cb_in(struct libusb_transfer *transfer) {
   int *completed = transfer->user_data;
   *completed = 1;
@@ -155,7 +147,7 @@ static int bulk_async_transfer(int endpoint, uint8_t *serial_buf, int count, uns
   return 0;
 }
 
-static void async_callback(struct libusb_transfer *xfr) {
+static void async_callback_process(struct libusb_transfer *xfr) {
   if (shutdown_in_progress) {
     async_transfer_active = 0;
     return;
@@ -167,10 +159,11 @@ static void async_callback(struct libusb_transfer *xfr) {
       async_transfer_active = 0;
       return;
     }
-    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Async transfer failed with status: %s", 
-                 libusb_error_name(xfr->status));
+    log_async(SDL_LOG_CATEGORY_SYSTEM, SDL_LOG_PRIORITY_ERROR,
+              "Async transfer failed with status: %s", libusb_error_name(xfr->status));
     if (!shutdown_in_progress && libusb_submit_transfer(xfr) < 0) {
-      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error re-submitting failed transfer");
+      log_async(SDL_LOG_CATEGORY_SYSTEM, SDL_LOG_PRIORITY_ERROR,
+                "Error re-submitting failed transfer");
       async_transfer_active = 0;
     }
     return;
@@ -178,9 +171,14 @@ static void async_callback(struct libusb_transfer *xfr) {
 
   int bytes_read = xfr->actual_length;
   if (bytes_read < 0) {
-    SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "Error %d reading serial", (int)bytes_read);
+    log_async(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_CRITICAL, "Error %d reading serial",
+              bytes_read);
   } else if (bytes_read > 0) {
-    SDL_LogDebug(SDL_LOG_CATEGORY_SYSTEM, "Received %d bytes from M8", bytes_read);
+    log_async(SDL_LOG_CATEGORY_SYSTEM, SDL_LOG_PRIORITY_DEBUG, "Received %d bytes from M8",
+              bytes_read);
+    read_arrival_ns = latency_now();
+    metrics_count_bytes_read((uint32_t)bytes_read);
+    flight_recorder_bytes(xfr->buffer, (size_t)bytes_read);
     uint8_t *serial_buf = xfr->buffer;
     uint8_t *cur = serial_buf;
     const uint8_t *end = serial_buf + bytes_read;
@@ -189,11 +187,13 @@ static void async_callback(struct libusb_transfer *xfr) {
       // process the incoming bytes into commands and draw them
       int n = slip_read_byte(slip, *(cur++));
       if (n != SLIP_NO_ERROR) {
+        metrics_count_slip_error(n);
+        flight_recorder_trigger(FLIGHT_REASON_SLIP_ERROR);
         if (n == SLIP_ERROR_INVALID_PACKET) {
-          SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Invalid SLIP packet!\n");
+          log_async(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "Invalid SLIP packet!");
 
         } else {
-          SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SLIP error %d\n", n);
+          log_async(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "SLIP error %d", n);
         }
       }
     }
@@ -201,8 +201,8 @@ static void async_callback(struct libusb_transfer *xfr) {
   if (!shutdown_in_progress) {
     int submit_result = libusb_submit_transfer(xfr);
     if (submit_result < 0) {
-      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Error re-submitting URB: %s", 
-                   libusb_error_name(submit_result));
+      log_async(SDL_LOG_CATEGORY_SYSTEM, SDL_LOG_PRIORITY_ERROR, "Error re-submitting URB: %s",
+                libusb_error_name(submit_result));
       async_transfer_active = 0;
     }
   } else {
@@ -210,6 +210,12 @@ static void async_callback(struct libusb_transfer *xfr) {
   }
 }
 
+static void async_callback(struct libusb_transfer *xfr) {
+  const uint64_t start = usb_callback_stats_begin(&display_stats);
+  async_callback_process(xfr);
+  usb_callback_stats_end(&display_stats, start);
+}
+
 int async_read_start(uint8_t *serial_buf, int count, slip_handler_s *slip) {
   if (async_transfer_active) {
     SDL_LogDebug(SDL_LOG_CATEGORY_SYSTEM, "Async transfer already active, skipping");
@@ -272,13 +278,14 @@ int m8_process_data(const config_params_s *conf) {
   (void)conf; // Suppress unused parameter warning
   // Process any queued messages
   if (queue_size(&queue) > 0) {
-    unsigned char *command;
+    const unsigned char *command;
     size_t length = 0;
-    while ((command = pop_message(&queue, &length)) != NULL) {
+    latency_stamps_s stamps;
+    while ((command = pop_message_stamped(&queue, &length, &stamps)) != NULL) {
       if (length > 0) {
         process_command(command, length);
+        latency_message_processed(command[0], &stamps);
       }
-      SDL_free(command);
     }
   }
   return DEVICE_PROCESSING;
@@ -335,7 +342,9 @@ int init_interface() {
 
   init_queue(&queue);
 
-  usb_thread = SDL_CreateThread(&usb_loop, "USB", NULL);
+  // Serial traffic only, the audio backend services its isochronous transfers on its own thread
+  usb_callback_stats_init(&display_stats, "Serial");
+  usb_event_thread_start(&display_events, ctx, "USB", SDL_THREAD_PRIORITY_HIGH);
 
   // Start async transfer for reading data from M8
   if (async_read_start(serial_buffer, SERIAL_READ_SIZE, &slip) < 0) {
@@ -518,6 +527,9 @@ int m8_close() {
 
   int rc;
 
+  // No more transfers from here on, the event thread can go
+  usb_event_thread_stop(&display_events);
+
   if (devh != NULL) {
 
     for (int if_num = 0; if_num < 2; if_num++) {
@@ -528,13 +540,10 @@ int m8_close() {
       }
     }
 
-    do_exit = 1;
-
     libusb_close(devh);
+    devh = NULL;
   }
 
-  SDL_WaitThread(usb_thread, NULL);
-
   libusb_exit(ctx);
 
   destroy_queue(&queue);
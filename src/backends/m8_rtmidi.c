@@ -6,8 +6,14 @@
 #define RTMIDI_DEBUG
 #endif
 
+#include "../alloc_stats.h"
 #include "../command.h"
 #include "../config.h"
+#include "../flight_recorder.h"
+#include "../latency.h"
+#include "../log_ring.h"
+#include "../metrics.h"
+#include "../trace.h"
 #include "m8.h"
 #include "queue.h"
 #include "../sdl_compat.h"
@@ -33,13 +39,13 @@ static bool message_is_m8_sysex(const unsigned char *message) {
   return false;
 }
 
-static void midi_decode(const uint8_t *encoded_data, size_t length, uint8_t **decoded_data,
-                        size_t *decoded_length) {
+// Decodes into a buffer owned by the caller, returns 0 if the message does not fit or is invalid
+static int midi_decode(const uint8_t *encoded_data, size_t length, uint8_t *decoded_data,
+                       const size_t decoded_capacity, size_t *decoded_length) {
+  *decoded_length = 0;
   if (length < m8_sysex_header_size) {
     // Invalid data
-    *decoded_data = NULL;
-    *decoded_length = 0;
-    return;
+    return 0;
   }
 
   // Skip header "F0 00 02 61" and the first MSB byte
@@ -52,17 +58,13 @@ static void midi_decode(const uint8_t *encoded_data, size_t length, uint8_t **de
     length--; // Ignore the EOT byte
   }
 
-  // Allocate memory for decoded output
-  *decoded_data = (uint8_t *)SDL_malloc(expected_output_size);
-  if (*decoded_data == NULL) {
-    *decoded_length = 0;
-    return;
+  if (expected_output_size > decoded_capacity) {
+    return 0;
   }
 
   uint8_t bit_counter = 0;
   uint8_t bit_byte_counter = 0;
-  uint8_t *out = *decoded_data;
-  *decoded_length = 0;
+  uint8_t *out = decoded_data;
 
   while (pos < length) {
     // Extract MSB from the "bit field" position
@@ -85,6 +87,7 @@ static void midi_decode(const uint8_t *encoded_data, size_t length, uint8_t **de
       pos++; // Skip the MSB byte
     }
   }
+  return 1;
 }
 
 static void midi_callback(double delta_time, const unsigned char *message, size_t message_size,
@@ -96,13 +99,22 @@ static void midi_callback(double delta_time, const unsigned char *message, size_
   if (midi_processing_suspended || message_size < 5 || !message_is_m8_sysex(message))
     return;
 
+  const uint64_t arrival_ns = latency_now();
+  metrics_count_bytes_read((uint32_t)message_size);
+  flight_recorder_bytes(message, message_size);
+  trace_thread_name("midi");
+  const uint64_t trace_start = trace_begin();
+
   if (!midi_sysex_received) {
     midi_sysex_received = true;
   }
 
-  unsigned char *decoded_data;
+  // The callback runs on a single RtMidi thread, so one static buffer is enough
+  static uint8_t decoded_data[MAX_MESSAGE_SIZE];
   size_t decoded_length;
-  midi_decode(message, message_size, &decoded_data, &decoded_length);
+  const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_MIDI_DECODE);
+  const int decoded =
+      midi_decode(message, message_size, decoded_data, sizeof(decoded_data), &decoded_length);
 
   // If you need to debug incoming MIDI packets, you can uncomment the lines below:
 
@@ -111,17 +123,20 @@ static void midi_callback(double delta_time, const unsigned char *message, size_
     printf("%02X ", message[i]);
   } */
 
-  if (decoded_data) {
+  if (decoded) {
     /* printf("\nDecoded MIDI Data: ");
     for (size_t i = 0; i < decoded_length; i++) {
       printf("%02X ", decoded_data[i]);
     }
     printf("\n"); */
-    push_message(&queue, decoded_data, decoded_length);
-    SDL_free(decoded_data);
+    latency_record(LATENCY_STAGE_DECODE, arrival_ns, latency_now());
+    push_message_stamped(&queue, decoded_data, decoded_length, arrival_ns);
   } else {
-    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Decoding failed.\n");
+    log_async(SDL_LOG_CATEGORY_SYSTEM, SDL_LOG_PRIORITY_ERROR, "Decoding failed.");
+    flight_recorder_trigger(FLIGHT_REASON_INVALID_PACKET);
   }
+  alloc_stats_pop_tag(previous_tag);
+  trace_end("midi_callback", trace_start);
 }
 
 static void close_and_free_midi_ports(void) {
@@ -330,12 +345,13 @@ int m8_process_data(const config_params_s *conf) {
   static unsigned int empty_cycles = 0;
 
   if (queue_size(&queue) > 0) {
-    unsigned char *command;
+    const unsigned char *command;
     empty_cycles = 0;
     size_t length = 0;
-    while ((command = pop_message(&queue, &length)) != NULL) {
+    latency_stamps_s stamps;
+    while ((command = pop_message_stamped(&queue, &length, &stamps)) != NULL) {
       process_command(command, length);
-      SDL_free(command);
+      latency_message_processed(command[0], &stamps);
     }
   } else {
     empty_cycles++;
@@ -1,12 +1,24 @@
 #include "queue.h"
+#include "../alloc_stats.h"
+#include "../flight_recorder.h"
+#include "../latency.h"
+#include "../log_ring.h"
+#include "../metrics.h"
 #include "../sdl_compat.h"
 #include <stdlib.h>
 #include <string.h>
 
 // Initialize the message queue
 void init_queue(message_queue_s *queue) {
+    // Messages are copied into preallocated storage so pushing and popping never allocate
+    queue->storage = SDL_malloc(QUEUE_STORAGE_SIZE);
+    if (queue->storage == NULL) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_SYSTEM, "Couldn't allocate message queue");
+    }
     queue->front = 0;
     queue->rear = 0;
+    queue->write_offset = 0;
+    queue->retained = 0;
     queue->mutex = SDL_CreateMutex();
     queue->cond = SDL_CreateCondition();
 }
@@ -15,36 +27,101 @@ void init_queue(message_queue_s *queue) {
 void destroy_queue(message_queue_s *queue) {
   SDL_LockMutex(queue->mutex);
 
-  while (queue->front != queue->rear) {
-    SDL_free(queue->messages[queue->front]);
-    queue->front = (queue->front + 1) % MAX_QUEUE_SIZE;
-  }
+  SDL_free(queue->storage);
+  queue->storage = NULL;
+  queue->front = 0;
+  queue->rear = 0;
+  queue->write_offset = 0;
+  queue->retained = 0;
 
   SDL_UnlockMutex(queue->mutex);
   SDL_DestroyMutex(queue->mutex);
   SDL_DestroyCondition(queue->cond);
 }
 
+// Find room for a message after the newest one without overwriting the oldest one, which is the
+// message returned by the last pop while it is still in use. A message that does not fit at the
+// end of the storage starts over from the beginning.
+static int reserve_storage(const message_queue_s *queue, const size_t length, uint32_t *offset) {
+  const int oldest =
+      queue->retained ? (queue->front + MAX_QUEUE_SIZE - 1) % MAX_QUEUE_SIZE : queue->front;
+  if (oldest == queue->rear) {
+    *offset = 0; // nothing stored
+    return 1;
+  }
+  const uint32_t start = queue->offsets[oldest];
+  const uint32_t end = queue->write_offset;
+  if (end >= start) {
+    if (end + length <= QUEUE_STORAGE_SIZE) {
+      *offset = end;
+      return 1;
+    }
+    if (length < start) {
+      *offset = 0;
+      return 1;
+    }
+    return 0;
+  }
+  // Never fill the gap completely, end == start means that everything is free
+  if (end + length < start) {
+    *offset = end;
+    return 1;
+  }
+  return 0;
+}
+
 // Push a message to the queue
 void push_message(message_queue_s *queue, const unsigned char *message, size_t length) {
+    push_message_stamped(queue, message, length, latency_now());
+}
+
+// Push a message to the queue with the time its bytes arrived
+void push_message_stamped(message_queue_s *queue, const unsigned char *message, size_t length,
+                          uint64_t arrival_ns) {
+    const uint64_t now = latency_now();
+    if (length > MAX_MESSAGE_SIZE) {
+        log_async(SDL_LOG_CATEGORY_SYSTEM, SDL_LOG_PRIORITY_ERROR,
+                  "Message of %u bytes is too long for the queue.", (unsigned int)length);
+        metrics_count_queue_drop();
+        return;
+    }
+    const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_QUEUE);
     SDL_LockMutex(queue->mutex);
 
-    if ((queue->rear + 1) % MAX_QUEUE_SIZE == queue->front) {
-        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,"Queue is full, cannot add message.");
+    // One slot is kept free in addition to the usual one, so the message returned by the last
+    // pop is not overwritten before the next pop
+    uint32_t offset = 0;
+    if ((queue->rear + 2) % MAX_QUEUE_SIZE == queue->front || queue->storage == NULL ||
+        !reserve_storage(queue, length, &offset)) {
+        log_async(SDL_LOG_CATEGORY_SYSTEM, SDL_LOG_PRIORITY_ERROR,
+                  "Queue is full, cannot add message.");
+        metrics_count_queue_drop();
+        flight_recorder_trigger(FLIGHT_REASON_QUEUE_OVERFLOW);
     } else {
-        // Allocate space for the message and store it
-        queue->messages[queue->rear] = SDL_malloc(length);
-        SDL_memcpy(queue->messages[queue->rear], message, length);
+        SDL_memcpy(queue->storage + offset, message, length);
+        queue->offsets[queue->rear] = offset;
+        queue->write_offset = offset + (uint32_t)length;
         queue->lengths[queue->rear] = length;
+        queue->arrival_ns[queue->rear] = arrival_ns;
+        queue->pushed_ns[queue->rear] = now;
         queue->rear = (queue->rear + 1) % MAX_QUEUE_SIZE;
+        metrics_set_queue_depth((queue->rear - queue->front + MAX_QUEUE_SIZE) % MAX_QUEUE_SIZE);
         SDL_SignalCondition(queue->cond);  // Signal consumer thread
     }
 
     SDL_UnlockMutex(queue->mutex);
+    alloc_stats_pop_tag(previous_tag);
 }
 
 // Pop a message from the queue
-unsigned char *pop_message(message_queue_s *queue, size_t *length) {
+const unsigned char *pop_message(message_queue_s *queue, size_t *length) {
+  latency_stamps_s stamps;
+  return pop_message_stamped(queue, length, &stamps);
+}
+
+// Pop a message from the queue with its arrival time, recording how long it was queued
+const unsigned char *pop_message_stamped(message_queue_s *queue, size_t *length,
+                                   latency_stamps_s *stamps) {
   SDL_LockMutex(queue->mutex);
 
   // Check if the queue is empty
@@ -55,10 +132,17 @@ unsigned char *pop_message(message_queue_s *queue, size_t *length) {
 
   // Otherwise, retrieve the message and its length
   *length = queue->lengths[queue->front];
-  unsigned char *message = queue->messages[queue->front];
+  stamps->arrival_ns = queue->arrival_ns[queue->front];
+  stamps->pushed_ns = queue->pushed_ns[queue->front];
+  const unsigned char *message = queue->storage + queue->offsets[queue->front];
   queue->front = (queue->front + 1) % MAX_QUEUE_SIZE;
+  queue->retained = 1;
+  metrics_set_queue_depth((queue->rear - queue->front + MAX_QUEUE_SIZE) % MAX_QUEUE_SIZE);
 
   SDL_UnlockMutex(queue->mutex);
+
+  stamps->popped_ns = latency_now();
+  latency_record(LATENCY_STAGE_QUEUE, stamps->pushed_ns, stamps->popped_ns);
   return message;
 }
 
@@ -5,21 +5,32 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
+#include "../latency.h"
 #include "../sdl_compat.h"
+#include <stdint.h>
 
 #define MAX_QUEUE_SIZE 8192
+#define MAX_MESSAGE_SIZE 512 // longest M8 command is the 484 byte oscilloscope waveform
+// Most messages are 5 to 12 byte drawing commands, so the queued messages are stored back to
+// back. 256 KB hold about two seconds of a busy display.
+#define QUEUE_STORAGE_SIZE (256 * 1024)
 
 typedef struct {
-  unsigned char *messages[MAX_QUEUE_SIZE];
+  unsigned char *storage; // QUEUE_STORAGE_SIZE bytes, allocated once
+  uint32_t offsets[MAX_QUEUE_SIZE]; // Where each message starts in the storage
   size_t lengths[MAX_QUEUE_SIZE]; // Store lengths of each message
+  uint64_t arrival_ns[MAX_QUEUE_SIZE]; // When the bytes of each message were received
+  uint64_t pushed_ns[MAX_QUEUE_SIZE];  // When each message entered the queue
   int front;
   int rear;
+  uint32_t write_offset; // Where the next message is stored
+  int retained;          // The message returned by the last pop is still in use
   SDL_Mutex *mutex;
   SDL_Condition *cond;
 } message_queue_s;
 
 /**
- * Initializes the message queue structure.
+ * Initializes the message queue structure and allocates the storage for its messages.
  *
  * @param queue A pointer to the message queue structure to be initialized.
  */
@@ -34,17 +45,31 @@ void destroy_queue(message_queue_s *queue);
 
 /**
  * Retrieves and removes a message from the front of the message queue.
- * If the queue is empty, the function returns NULL.
+ * If the queue is empty, the function returns NULL. The message is owned by the queue and stays
+ * valid until the next pop.
  *
  * @param queue A pointer to the message queue structure from which the message is to be retrieved.
  * @param length A pointer to a variable where the length of the retrieved message will be stored.
  * @return A pointer to the retrieved message, or NULL if the queue is empty.
  */
-unsigned char *pop_message(message_queue_s *queue, size_t *length);
+const unsigned char *pop_message(message_queue_s *queue, size_t *length);
+
+/**
+ * Retrieves and removes a message from the front of the message queue along with its timestamps.
+ * The time spent in the queue is recorded to the latency statistics. The message is owned by the
+ * queue and stays valid until the next pop.
+ *
+ * @param queue A pointer to the message queue structure from which the message is to be retrieved.
+ * @param length A pointer to a variable where the length of the retrieved message will be stored.
+ * @param stamps A pointer to a structure where the timestamps of the message will be stored.
+ * @return A pointer to the retrieved message, or NULL if the queue is empty.
+ */
+const unsigned char *pop_message_stamped(message_queue_s *queue, size_t *length,
+                                   latency_stamps_s *stamps);
 
 /**
  * Adds a new message to the message queue.
- * If the queue is full, the message will not be added.
+ * If the queue is full or the message is longer than MAX_MESSAGE_SIZE, it will not be added.
  *
  * @param queue A pointer to the message queue structure where the message is to be stored.
  * @param message A pointer to the message data to be added to the queue.
@@ -52,6 +77,17 @@ unsigned char *pop_message(message_queue_s *queue, size_t *length);
  */
 void push_message(message_queue_s *queue, const unsigned char *message, size_t length);
 
+/**
+ * Adds a new message to the message queue, keeping the time its bytes were received.
+ *
+ * @param queue A pointer to the message queue structure where the message is to be stored.
+ * @param message A pointer to the message data to be added to the queue.
+ * @param length The length of the message in bytes.
+ * @param arrival_ns Timestamp from latency_now() of when the message bytes were received.
+ */
+void push_message_stamped(message_queue_s *queue, const unsigned char *message, size_t length,
+                          uint64_t arrival_ns);
+
 /**
  * Calculates the current size of the message queue.
  *
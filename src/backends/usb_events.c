@@ -0,0 +1,99 @@
+// Copyright 2021 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#ifdef USE_LIBUSB
+
+#include "usb_events.h"
+#include "../trace.h"
+
+#define STATS_REPORT_INTERVAL_NS (5 * SDL_NS_PER_SECOND)
+#define EVENT_TIMEOUT_US 100000 // wake up regularly to check for the stop request
+
+void usb_callback_stats_init(usb_callback_stats_s *stats, const char *name) {
+  SDL_zero(*stats);
+  stats->name = name;
+  stats->report_at_ns = SDL_GetTicksNS() + STATS_REPORT_INTERVAL_NS;
+}
+
+uint64_t usb_callback_stats_begin(usb_callback_stats_s *stats) {
+  const uint64_t now = SDL_GetTicksNS();
+  if (stats->last_start_ns != 0) {
+    const uint64_t gap = now - stats->last_start_ns;
+    stats->gap_total_ns += gap;
+    if (gap > stats->gap_max_ns) {
+      stats->gap_max_ns = gap;
+    }
+  }
+  stats->last_start_ns = now;
+  return now;
+}
+
+void usb_callback_stats_end(usb_callback_stats_s *stats, const uint64_t start_ns) {
+  const uint64_t now = SDL_GetTicksNS();
+  const uint64_t busy = now - start_ns;
+  trace_end(stats->name, start_ns);
+  stats->count++;
+  stats->busy_total_ns += busy;
+  if (busy > stats->busy_max_ns) {
+    stats->busy_max_ns = busy;
+  }
+
+  if (now < stats->report_at_ns) {
+    return;
+  }
+
+  if (stats->count > 0) {
+    SDL_LogDebug(SDL_LOG_CATEGORY_SYSTEM,
+                 "%s callbacks: %llu, duration avg %.1f us max %.1f us, interval avg %.1f us "
+                 "max %.1f us",
+                 stats->name, (unsigned long long)stats->count,
+                 (double)stats->busy_total_ns / (double)stats->count / 1000.0,
+                 (double)stats->busy_max_ns / 1000.0,
+                 (double)stats->gap_total_ns / (double)stats->count / 1000.0,
+                 (double)stats->gap_max_ns / 1000.0);
+  }
+  const char *name = stats->name;
+  usb_callback_stats_init(stats, name);
+}
+
+static int SDLCALL usb_event_loop(void *data) {
+  usb_event_thread_s *events = data;
+
+  SDL_SetCurrentThreadPriority(events->priority);
+  trace_thread_name(events->name);
+  while (!SDL_GetAtomicInt(&events->stop)) {
+    struct timeval timeout = {0, EVENT_TIMEOUT_US};
+    const int rc = libusb_handle_events_timeout_completed(events->ctx, &timeout, NULL);
+    if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_INTERRUPTED) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "USB event loop error: %s", libusb_error_name(rc));
+      break;
+    }
+  }
+  return 0;
+}
+
+int usb_event_thread_start(usb_event_thread_s *events, libusb_context *ctx, const char *name,
+                           const SDL_ThreadPriority priority) {
+  events->ctx = ctx;
+  events->name = name;
+  events->priority = priority;
+  SDL_SetAtomicInt(&events->stop, 0);
+  events->thread = SDL_CreateThread(usb_event_loop, name, events);
+  if (events->thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Could not start USB event thread %s: %s", name,
+                 SDL_GetError());
+    return 0;
+  }
+  return 1;
+}
+
+void usb_event_thread_stop(usb_event_thread_s *events) {
+  if (events->thread == NULL) {
+    return;
+  }
+  SDL_SetAtomicInt(&events->stop, 1);
+  SDL_WaitThread(events->thread, NULL);
+  events->thread = NULL;
+}
+
+#endif // USE_LIBUSB
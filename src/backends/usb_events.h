@@ -0,0 +1,61 @@
+// Copyright 2021 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// libusb event handling threads and per-thread transfer callback statistics.
+// Audio isochronous and serial bulk traffic are serviced by separate threads so that
+// display bursts cannot delay audio completions.
+
+#ifndef USB_EVENTS_H
+#define USB_EVENTS_H
+#ifdef USE_LIBUSB
+
+#include "../sdl_compat.h"
+#include <libusb.h>
+#include <stdint.h>
+
+typedef struct {
+  const char *name;
+  uint64_t count;
+  uint64_t last_start_ns;
+  uint64_t busy_total_ns;
+  uint64_t busy_max_ns;
+  uint64_t gap_total_ns;
+  uint64_t gap_max_ns;
+  uint64_t report_at_ns;
+} usb_callback_stats_s;
+
+typedef struct {
+  libusb_context *ctx;
+  const char *name;
+  SDL_Thread *thread;
+  SDL_ThreadPriority priority;
+  SDL_AtomicInt stop;
+} usb_event_thread_s;
+
+// Reset the statistics, name is used in the periodic report
+void usb_callback_stats_init(usb_callback_stats_s *stats, const char *name);
+
+// Mark the start of a transfer callback, returns the timestamp to pass to the end call
+uint64_t usb_callback_stats_begin(usb_callback_stats_s *stats);
+
+// Mark the end of a transfer callback and record it to the trace. Logs a summary every few
+// seconds.
+void usb_callback_stats_end(usb_callback_stats_s *stats, uint64_t start_ns);
+
+/**
+ * Start a thread handling the events of a libusb context.
+ *
+ * @param events Thread state, must stay valid until usb_event_thread_stop.
+ * @param ctx The libusb context to service.
+ * @param name Thread name.
+ * @param priority Priority of the event thread.
+ * @return 1 on success, 0 on failure.
+ */
+int usb_event_thread_start(usb_event_thread_s *events, libusb_context *ctx, const char *name,
+                           SDL_ThreadPriority priority);
+
+// Stop the event thread and wait for it to exit
+void usb_event_thread_stop(usb_event_thread_s *events);
+
+#endif // USE_LIBUSB
+#endif // USB_EVENTS_H
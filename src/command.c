@@ -4,6 +4,9 @@
 #include "sdl_compat.h"
 
 #include "command.h"
+#include "flight_recorder.h"
+#include "metrics.h"
+#include "mux.h"
 #include "render.h"
 #include <assert.h>
 
@@ -14,32 +17,12 @@ static uint16_t decodeInt16(const uint8_t *data, const uint8_t start) {
   return data[start] | (((uint16_t)data[start + 1] << 8) & UINT16_MAX);
 }
 
-enum m8_command_bytes {
-  draw_rectangle_command = 0xFE,
-  draw_rectangle_command_pos_datalength = 5,
-  draw_rectangle_command_pos_color_datalength = 8,
-  draw_rectangle_command_pos_size_datalength = 9,
-  draw_rectangle_command_pos_size_color_datalength = 12,
-  draw_character_command = 0xFD,
-  draw_character_command_datalength = 12,
-  draw_oscilloscope_waveform_command = 0xFC,
-  draw_oscilloscope_waveform_command_mindatalength = 1 + 3,
-  draw_oscilloscope_waveform_command_maxdatalength = 1 + 3 + 480,
-  joypad_keypressedstate_command = 0xFB,
-  joypad_keypressedstate_command_datalength = 3,
-  system_info_command = 0xFF,
-  system_info_command_datalength = 6
-};
-
-static void dump_packet(const uint32_t size, const uint8_t *recv_buf) {
-  for (uint32_t a = 0; a < size; a++) {
-    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "0x%02X ", recv_buf[a]);
-  }
-  SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "\n");
-}
-
 int process_command(const uint8_t *recv_buf, uint32_t size) {
 
+  metrics_count_packet(recv_buf[0]);
+  flight_recorder_packet(recv_buf, size);
+  mux_publish(recv_buf, size);
+
   switch (recv_buf[0]) {
 
   case draw_rectangle_command: {
@@ -53,7 +36,7 @@ int process_command(const uint8_t *recv_buf, uint32_t size) {
                    draw_rectangle_command_pos_color_datalength,
                    draw_rectangle_command_pos_size_datalength,
                    draw_rectangle_command_pos_size_color_datalength, size);
-      dump_packet(size, recv_buf);
+      flight_recorder_trigger(FLIGHT_REASON_INVALID_PACKET);
       return 0;
     }
     /* Support variable sized rectangle commands
@@ -103,7 +86,7 @@ int process_command(const uint8_t *recv_buf, uint32_t size) {
       SDL_LogError(SDL_LOG_CATEGORY_ERROR,
                    "Invalid draw character packet: expected length %d, got %d",
                    draw_character_command_datalength, size);
-      dump_packet(size, recv_buf);
+      flight_recorder_trigger(FLIGHT_REASON_INVALID_PACKET);
       return 0;
     }
     struct draw_character_command charcmd = {
@@ -122,7 +105,7 @@ int process_command(const uint8_t *recv_buf, uint32_t size) {
                    "Invalid draw oscilloscope packet: expected length between %d and %d, got %d",
                    draw_oscilloscope_waveform_command_mindatalength,
                    draw_oscilloscope_waveform_command_maxdatalength, size);
-      dump_packet(size, recv_buf);
+      flight_recorder_trigger(FLIGHT_REASON_INVALID_PACKET);
       return 0;
     }
     struct draw_oscilloscope_waveform_command osccmd = {0};
@@ -142,7 +125,7 @@ int process_command(const uint8_t *recv_buf, uint32_t size) {
                    "Invalid joypad keypressed state packet: expected length %d, "
                    "got %d\n",
                    joypad_keypressedstate_command_datalength, size);
-      dump_packet(size, recv_buf);
+      flight_recorder_trigger(FLIGHT_REASON_INVALID_PACKET);
       return 0;
     }
 
@@ -155,7 +138,7 @@ int process_command(const uint8_t *recv_buf, uint32_t size) {
       SDL_LogError(SDL_LOG_CATEGORY_ERROR,
                    "Invalid system info packet: expected length %d, got %d\n",
                    system_info_command_datalength, size);
-      dump_packet(size, recv_buf);
+      flight_recorder_trigger(FLIGHT_REASON_INVALID_PACKET);
       break;
     }
 
@@ -183,7 +166,7 @@ int process_command(const uint8_t *recv_buf, uint32_t size) {
 
   default:
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Invalid packet");
-    dump_packet(size, recv_buf);
+    flight_recorder_trigger(FLIGHT_REASON_INVALID_PACKET);
     return 0;
   }
   return 1;
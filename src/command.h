@@ -6,6 +6,24 @@
 
 #include <stdint.h>
 
+// Command bytes that start every display message from the M8, and the lengths of their messages
+enum m8_command_bytes {
+  draw_rectangle_command = 0xFE,
+  draw_rectangle_command_pos_datalength = 5,
+  draw_rectangle_command_pos_color_datalength = 8,
+  draw_rectangle_command_pos_size_datalength = 9,
+  draw_rectangle_command_pos_size_color_datalength = 12,
+  draw_character_command = 0xFD,
+  draw_character_command_datalength = 12,
+  draw_oscilloscope_waveform_command = 0xFC,
+  draw_oscilloscope_waveform_command_mindatalength = 1 + 3,
+  draw_oscilloscope_waveform_command_maxdatalength = 1 + 3 + 480,
+  joypad_keypressedstate_command = 0xFB,
+  joypad_keypressedstate_command_datalength = 3,
+  system_info_command = 0xFF,
+  system_info_command_datalength = 6
+};
+
 struct position {
   uint16_t x;
   uint16_t y;
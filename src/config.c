@@ -30,10 +30,15 @@ config_params_s config_initialize(char *filename) {
 
   c.init_fullscreen = 0; // default fullscreen state at load
   c.integer_scaling = 0; // use integer scaling for the user interface
+  c.waveform_lines = 0;  // draw the oscilloscope as points
   c.wait_packets = 256;  // amount of empty command queue reads before assuming device disconnected
   c.audio_enabled = 0;   // route M8 audio to default output
   c.audio_buffer_size = 0;    // requested audio buffer size in samples: 0 = let SDL decide
   c.audio_device_name = NULL; // Use this device, leave NULL to use the default output device
+  c.audio_monitor_pair = 0;   // multichannel M8: stereo pair routed to the output, 0 = main mix
+  c.audio_record_stems = 0;   // write every stereo pair of the M8 input to its own WAV file
+  c.audio_usb_transfers = 0;  // libusb: queued isochronous transfers, 0 = calibrate at startup
+  c.audio_usb_packets = 0;    // libusb: packets (1 ms each) per transfer, 0 = default
 
   c.key_up = SDL_SCANCODE_UP;
   c.key_left = SDL_SCANCODE_LEFT;
@@ -56,6 +61,9 @@ config_params_s config_initialize(char *filename) {
   c.key_toggle_audio = SDL_SCANCODE_F12;
   c.key_toggle_settings = SDL_SCANCODE_F1;
   c.key_toggle_log = SDL_SCANCODE_F2;
+  c.key_toggle_meters = SDL_SCANCODE_F3;
+  c.key_toggle_hud = SDL_SCANCODE_F4;
+  c.key_trace_flush = SDL_SCANCODE_F5;
 
   c.gamepad_up = SDL_GAMEPAD_BUTTON_DPAD_UP;
   c.gamepad_left = SDL_GAMEPAD_BUTTON_DPAD_LEFT;
@@ -90,7 +98,7 @@ void write_config(const config_params_s *conf) {
 
   SDL_Log("Writing config file to %s", config_path);
 
-#define INI_LINE_COUNT 50
+#define INI_LINE_COUNT 58
 #define INI_LINE_LENGTH 50
 
   // Entries for the config file
@@ -102,6 +110,8 @@ void write_config(const config_params_s *conf) {
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "wait_packets=%d\n", conf->wait_packets);
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "integer_scaling=%s\n",
            conf->integer_scaling ? "true" : "false");
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "waveform_lines=%s\n",
+           conf->waveform_lines ? "true" : "false");
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "[audio]\n");
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "audio_enabled=%s\n",
            conf->audio_enabled ? "true" : "false");
@@ -109,6 +119,14 @@ void write_config(const config_params_s *conf) {
            conf->audio_buffer_size);
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "audio_device_name=%s\n",
            conf->audio_device_name ? conf->audio_device_name : "Default");
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "audio_monitor_pair=%d\n",
+           conf->audio_monitor_pair);
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "audio_record_stems=%s\n",
+           conf->audio_record_stems ? "true" : "false");
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "audio_usb_transfers=%d\n",
+           conf->audio_usb_transfers);
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "audio_usb_packets=%d\n",
+           conf->audio_usb_packets);
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "[keyboard]\n");
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH,
            ";Ref: https://wiki.libsdl.org/SDL2/SDL_Scancode\n");
@@ -138,6 +156,12 @@ void write_config(const config_params_s *conf) {
            conf->key_toggle_audio);
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "key_toggle_settings=%d\n", conf->key_toggle_settings);
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "key_toggle_log=%d\n", conf->key_toggle_log);
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "key_toggle_meters=%d\n",
+           conf->key_toggle_meters);
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "key_toggle_hud=%d\n",
+           conf->key_toggle_hud);
+  snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "key_trace_flush=%d\n",
+           conf->key_trace_flush);
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "[gamepad]\n");
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "gamepad_up=%d\n", conf->gamepad_up);
   snprintf(ini_values[initPointer++], INI_LINE_LENGTH, "gamepad_left=%d\n", conf->gamepad_left);
@@ -214,6 +238,10 @@ void read_audio_config(const ini_t *ini, config_params_s *conf) {
   const char *param_audio_enabled = ini_get(ini, "audio", "audio_enabled");
   const char *param_audio_buffer_size = ini_get(ini, "audio", "audio_buffer_size");
   const char *param_audio_device_name = ini_get(ini, "audio", "audio_device_name");
+  const char *param_audio_monitor_pair = ini_get(ini, "audio", "audio_monitor_pair");
+  const char *param_audio_record_stems = ini_get(ini, "audio", "audio_record_stems");
+  const char *param_audio_usb_transfers = ini_get(ini, "audio", "audio_usb_transfers");
+  const char *param_audio_usb_packets = ini_get(ini, "audio", "audio_usb_packets");
 
   if (param_audio_enabled != NULL) {
     if (strcmpci(param_audio_enabled, "true") == 0) {
@@ -230,12 +258,33 @@ void read_audio_config(const ini_t *ini, config_params_s *conf) {
   if (param_audio_buffer_size != NULL) {
     conf->audio_buffer_size = SDL_atoi(param_audio_buffer_size);
   }
+
+  if (param_audio_monitor_pair != NULL) {
+    conf->audio_monitor_pair = SDL_atoi(param_audio_monitor_pair);
+  }
+
+  if (param_audio_record_stems != NULL) {
+    if (strcmpci(param_audio_record_stems, "true") == 0) {
+      conf->audio_record_stems = 1;
+    } else {
+      conf->audio_record_stems = 0;
+    }
+  }
+
+  if (param_audio_usb_transfers != NULL) {
+    conf->audio_usb_transfers = SDL_atoi(param_audio_usb_transfers);
+  }
+
+  if (param_audio_usb_packets != NULL) {
+    conf->audio_usb_packets = SDL_atoi(param_audio_usb_packets);
+  }
 }
 
 void read_graphics_config(const ini_t *ini, config_params_s *conf) {
   const char *param_fs = ini_get(ini, "graphics", "fullscreen");
   const char *wait_packets = ini_get(ini, "graphics", "wait_packets");
   const char *integer_scaling = ini_get(ini, "graphics", "integer_scaling");
+  const char *waveform_lines = ini_get(ini, "graphics", "waveform_lines");
 
   if (param_fs != NULL && strcmpci(param_fs, "true") == 0) {
     conf->init_fullscreen = 1;
@@ -251,6 +300,12 @@ void read_graphics_config(const ini_t *ini, config_params_s *conf) {
   } else {
     conf->integer_scaling = 0;
   }
+
+  if (waveform_lines != NULL && strcmpci(waveform_lines, "true") == 0) {
+    conf->waveform_lines = 1;
+  } else {
+    conf->waveform_lines = 0;
+  }
 }
 
 void read_key_config(const ini_t *ini, config_params_s *conf) {
@@ -277,6 +332,9 @@ void read_key_config(const ini_t *ini, config_params_s *conf) {
   const char *key_toggle_audio = ini_get(ini, "keyboard", "key_toggle_audio");
   const char *key_toggle_settings = ini_get(ini, "keyboard", "key_toggle_settings");
   const char *key_toggle_log = ini_get(ini, "keyboard", "key_toggle_log");
+  const char *key_toggle_meters = ini_get(ini, "keyboard", "key_toggle_meters");
+  const char *key_toggle_hud = ini_get(ini, "keyboard", "key_toggle_hud");
+  const char *key_trace_flush = ini_get(ini, "keyboard", "key_trace_flush");
 
   if (key_up)
     conf->key_up = SDL_atoi(key_up);
@@ -320,6 +378,12 @@ void read_key_config(const ini_t *ini, config_params_s *conf) {
     conf->key_toggle_log = SDL_atoi(key_toggle_settings);
   if (key_toggle_log)
     conf->key_toggle_log = SDL_atoi(key_toggle_log);
+  if (key_toggle_meters)
+    conf->key_toggle_meters = SDL_atoi(key_toggle_meters);
+  if (key_toggle_hud)
+    conf->key_toggle_hud = SDL_atoi(key_toggle_hud);
+  if (key_trace_flush)
+    conf->key_trace_flush = SDL_atoi(key_trace_flush);
 }
 
 void read_gamepad_config(const ini_t *ini, config_params_s *conf) {
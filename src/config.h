@@ -8,12 +8,19 @@
 
 typedef struct config_params_s {
   char *filename;
+  unsigned int headless; // set with --headless, not stored in the config file
+  unsigned int terminal; // set with --terminal, implies headless
   unsigned int init_fullscreen;
   unsigned int integer_scaling;
+  unsigned int waveform_lines;
   unsigned int wait_packets;
   unsigned int audio_enabled;
   unsigned int audio_buffer_size;
   char *audio_device_name;
+  unsigned int audio_monitor_pair;
+  unsigned int audio_record_stems;
+  unsigned int audio_usb_transfers;
+  unsigned int audio_usb_packets;
 
   unsigned int key_up;
   unsigned int key_left;
@@ -36,6 +43,9 @@ typedef struct config_params_s {
   unsigned int key_toggle_audio;
   unsigned int key_toggle_settings;
   unsigned int key_toggle_log;
+  unsigned int key_toggle_meters;
+  unsigned int key_toggle_hud;
+  unsigned int key_trace_flush;
 
   int gamepad_up;
   int gamepad_left;
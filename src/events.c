@@ -25,6 +25,14 @@ static SDL_AppResult process_event(struct app_context *ctx, SDL_Event *event) {
     if (event->window.event == SDL_WINDOWEVENT_RESIZED ||
         event->window.event == SDL_WINDOWEVENT_MOVED) {
       renderer_fix_texture_scaling_after_window_resize(&ctx->conf);
+    } else if (event->window.event == SDL_WINDOWEVENT_MINIMIZED ||
+               event->window.event == SDL_WINDOWEVENT_HIDDEN) {
+      renderer_set_window_visible(0);
+    } else if (event->window.event == SDL_WINDOWEVENT_RESTORED ||
+               event->window.event == SDL_WINDOWEVENT_MAXIMIZED ||
+               event->window.event == SDL_WINDOWEVENT_SHOWN ||
+               event->window.event == SDL_WINDOWEVENT_EXPOSED) {
+      renderer_set_window_visible(1);
     }
     break;
 #else
@@ -33,6 +41,17 @@ static SDL_AppResult process_event(struct app_context *ctx, SDL_Event *event) {
   case SDL_EVENT_WINDOW_MOVED:
     renderer_fix_texture_scaling_after_window_resize(&ctx->conf);
     break;
+  case SDL_EVENT_WINDOW_MINIMIZED:
+  case SDL_EVENT_WINDOW_OCCLUDED:
+  case SDL_EVENT_WINDOW_HIDDEN:
+    renderer_set_window_visible(0);
+    break;
+  case SDL_EVENT_WINDOW_RESTORED:
+  case SDL_EVENT_WINDOW_MAXIMIZED:
+  case SDL_EVENT_WINDOW_SHOWN:
+  case SDL_EVENT_WINDOW_EXPOSED:
+    renderer_set_window_visible(1);
+    break;
 #endif
 
   // --- iOS specific events ---
@@ -0,0 +1,259 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "flight_recorder.h"
+#include "backends/queue.h"
+#include "sdl_compat.h"
+#include <time.h>
+
+// Sized for a busy display, about a full screen of characters redrawn eight times a second plus
+// the oscilloscope at 60 Hz: some 8000 packets and 128 KB per second. Heavier traffic shortens
+// the recorded window.
+#define DISPLAY_PACKET_RATE 8000
+#define DISPLAY_BYTE_RATE (128 * 1024)
+#define RECORD_WINDOW_S 5
+#define RECORD_WINDOW_NS (RECORD_WINDOW_S * SDL_NS_PER_SECOND) // only the last seconds are dumped
+#define RECORD_HEADER_SIZE 10   // timestamp and length in front of every record
+#define READ_RECORD_SIZE 1024   // longer device reads take several records
+#define DUMP_INTERVAL_MS 10000  // an error burst produces a single dump
+
+// Reads can be as small as a single packet (MIDI), the packets hold the same bytes decoded
+#define RING_SIZE ((DISPLAY_BYTE_RATE + DISPLAY_PACKET_RATE * RECORD_HEADER_SIZE) * RECORD_WINDOW_S)
+
+// Variable length records stored back to back in a circular buffer, each a 64-bit timestamp
+// and a 16-bit length followed by the data. The oldest records are dropped to make room.
+typedef struct {
+  uint8_t *data;
+  uint32_t head; // where the next record is written
+  uint32_t tail; // where the oldest record starts
+  uint32_t used;
+} record_ring_s;
+
+typedef struct {
+  uint64_t time_ns;
+  uint16_t length;
+  const uint8_t *data; // points into a copy of the record
+  uint8_t copy[READ_RECORD_SIZE];
+} record_s;
+
+static const char *reason_names[] = {"none", "SLIP error", "invalid packet", "queue overflow"};
+
+// Written by the device reading thread, copied under the mutex when dumping
+static uint8_t byte_data[RING_SIZE];
+static record_ring_s byte_ring = {byte_data, 0, 0, 0};
+static SDL_Mutex *byte_mutex = NULL;
+
+// Only touched from the main thread
+static uint8_t packet_data[RING_SIZE];
+static record_ring_s packet_ring = {packet_data, 0, 0, 0};
+
+static SDL_AtomicInt requested_reason;
+static Uint64 last_dump_ticks = 0;
+static unsigned int dump_sequence = 0;
+
+static void ring_write(record_ring_s *ring, const void *source, const uint32_t length) {
+  const uint32_t first = SDL_min(length, RING_SIZE - ring->head);
+  SDL_memcpy(ring->data + ring->head, source, first);
+  SDL_memcpy(ring->data, (const uint8_t *)source + first, length - first);
+  ring->head = (ring->head + length) % RING_SIZE;
+}
+
+static void ring_read(const record_ring_s *ring, const uint32_t offset, void *target,
+                      const uint32_t length) {
+  const uint32_t first = SDL_min(length, RING_SIZE - offset);
+  SDL_memcpy(target, ring->data + offset, first);
+  SDL_memcpy((uint8_t *)target + first, ring->data, length - first);
+}
+
+static uint16_t record_length_at(const record_ring_s *ring, const uint32_t offset) {
+  uint16_t length;
+  ring_read(ring, (offset + sizeof(uint64_t)) % RING_SIZE, &length, sizeof(length));
+  return length;
+}
+
+static void ring_append(record_ring_s *ring, const uint64_t time_ns, const uint8_t *data,
+                        const uint16_t length) {
+  const uint32_t size = RECORD_HEADER_SIZE + length;
+  while (RING_SIZE - ring->used < size) {
+    const uint32_t dropped = RECORD_HEADER_SIZE + record_length_at(ring, ring->tail);
+    ring->tail = (ring->tail + dropped) % RING_SIZE;
+    ring->used -= dropped;
+  }
+  ring_write(ring, &time_ns, sizeof(time_ns));
+  ring_write(ring, &length, sizeof(length));
+  ring_write(ring, data, length);
+  ring->used += size;
+}
+
+// Reads the record at the offset and returns the offset of the next one
+static uint32_t ring_record(const record_ring_s *ring, const uint32_t offset, record_s *record) {
+  ring_read(ring, offset, &record->time_ns, sizeof(record->time_ns));
+  record->length = record_length_at(ring, offset);
+  const uint32_t data_offset = (offset + RECORD_HEADER_SIZE) % RING_SIZE;
+  if (data_offset + record->length <= RING_SIZE) {
+    record->data = ring->data + data_offset;
+  } else {
+    ring_read(ring, data_offset, record->copy, record->length);
+    record->data = record->copy;
+  }
+  return (data_offset + record->length) % RING_SIZE;
+}
+
+void flight_recorder_init(void) {
+  if (byte_mutex == NULL) {
+    // The reading thread is the only writer, the mutex only guards against a concurrent dump
+    byte_mutex = SDL_CreateMutex();
+  }
+}
+
+void flight_recorder_bytes(const uint8_t *data, size_t length) {
+  const uint64_t now = SDL_GetTicksNS();
+  SDL_LockMutex(byte_mutex);
+  while (length > 0) {
+    const size_t chunk = SDL_min(length, (size_t)READ_RECORD_SIZE);
+    ring_append(&byte_ring, now, data, (uint16_t)chunk);
+    data += chunk;
+    length -= chunk;
+  }
+  SDL_UnlockMutex(byte_mutex);
+}
+
+void flight_recorder_packet(const uint8_t *data, uint32_t length) {
+  ring_append(&packet_ring, SDL_GetTicksNS(), data,
+              (uint16_t)SDL_min(length, (uint32_t)MAX_MESSAGE_SIZE));
+}
+
+void flight_recorder_trigger(const flight_reason_t reason) {
+  // Keep the reason of the first error until the dump is written
+  SDL_CompareAndSwapAtomicInt(&requested_reason, FLIGHT_REASON_NONE, reason);
+}
+
+static void write_record(SDL_IOStream *io, const char *kind, const uint64_t time_ns,
+                         const uint64_t dump_ns, const uint8_t *data, const uint32_t length) {
+  char line[32 + READ_RECORD_SIZE * 3];
+  int position = SDL_snprintf(line, sizeof(line), "%+11.6f %-6s %4u:",
+                              -(double)(dump_ns - time_ns) / SDL_NS_PER_SECOND, kind, length);
+  for (uint32_t i = 0; i < length && position < (int)sizeof(line) - 4; i++) {
+    position += SDL_snprintf(line + position, sizeof(line) - position, " %02X", data[i]);
+  }
+  line[position++] = '\n';
+  SDL_WriteIO(io, line, position);
+}
+
+// Raw bytes go to a .bin file that can be fed to --replay, the text file interleaves the raw
+// reads with the decoded packets
+static void write_dump(const flight_reason_t reason) {
+  char *pref_path = SDL_GetPrefPath("", "m8c");
+  if (pref_path == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Cannot resolve flight recorder directory: %s",
+                 SDL_GetError());
+    return;
+  }
+  char timestamp[32];
+  const time_t now = time(NULL);
+  strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&now));
+  dump_sequence++;
+  char bin_path[1024];
+  char text_path[1024];
+  SDL_snprintf(bin_path, sizeof(bin_path), "%sm8c-flight-%s-%u.bin", pref_path, timestamp,
+               dump_sequence);
+  SDL_snprintf(text_path, sizeof(text_path), "%sm8c-flight-%s-%u.txt", pref_path, timestamp,
+               dump_sequence);
+  SDL_free(pref_path);
+
+  // Dumps are rare, the copy of the raw bytes is only allocated while writing one
+  record_ring_s bytes = {SDL_malloc(RING_SIZE), 0, 0, 0};
+  if (bytes.data == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Cannot allocate flight recorder dump");
+    return;
+  }
+  SDL_LockMutex(byte_mutex);
+  SDL_memcpy(bytes.data, byte_ring.data, RING_SIZE);
+  bytes.head = byte_ring.head;
+  bytes.tail = byte_ring.tail;
+  bytes.used = byte_ring.used;
+  SDL_UnlockMutex(byte_mutex);
+  const uint64_t dump_ns = SDL_GetTicksNS();
+  const uint64_t window_start = dump_ns > RECORD_WINDOW_NS ? dump_ns - RECORD_WINDOW_NS : 0;
+
+  SDL_IOStream *bin = SDL_IOFromFile(bin_path, "wb");
+  SDL_IOStream *text = SDL_IOFromFile(text_path, "wb");
+  if (bin == NULL || text == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Cannot write flight recorder dump: %s",
+                 SDL_GetError());
+    if (bin != NULL) {
+      SDL_CloseIO(bin);
+    }
+    if (text != NULL) {
+      SDL_CloseIO(text);
+    }
+    SDL_free(bytes.data);
+    return;
+  }
+
+  char header[128];
+  const int header_length = SDL_snprintf(header, sizeof(header),
+                                         "m8c flight recorder: %s\nseconds    kind   size: data\n",
+                                         reason_names[reason]);
+  SDL_WriteIO(text, header, header_length);
+
+  // Merge both rings in time order
+  record_s byte_record;
+  record_s packet_record;
+  uint32_t byte_offset = bytes.tail;
+  uint32_t packet_offset = packet_ring.tail;
+  uint32_t bytes_left = bytes.used;
+  uint32_t packets_left = packet_ring.used;
+  int have_byte = 0;
+  int have_packet = 0;
+  for (;;) {
+    if (!have_byte && bytes_left > 0) {
+      const uint32_t next = ring_record(&bytes, byte_offset, &byte_record);
+      bytes_left -= RECORD_HEADER_SIZE + byte_record.length;
+      byte_offset = next;
+      have_byte = 1;
+    }
+    if (!have_packet && packets_left > 0) {
+      const uint32_t next = ring_record(&packet_ring, packet_offset, &packet_record);
+      packets_left -= RECORD_HEADER_SIZE + packet_record.length;
+      packet_offset = next;
+      have_packet = 1;
+    }
+    if (!have_byte && !have_packet) {
+      break;
+    }
+
+    if (have_byte && (!have_packet || byte_record.time_ns <= packet_record.time_ns)) {
+      if (byte_record.time_ns >= window_start) {
+        SDL_WriteIO(bin, byte_record.data, byte_record.length);
+        write_record(text, "read", byte_record.time_ns, dump_ns, byte_record.data,
+                     byte_record.length);
+      }
+      have_byte = 0;
+    } else {
+      if (packet_record.time_ns >= window_start) {
+        write_record(text, "packet", packet_record.time_ns, dump_ns, packet_record.data,
+                     packet_record.length);
+      }
+      have_packet = 0;
+    }
+  }
+
+  SDL_CloseIO(bin);
+  SDL_CloseIO(text);
+  SDL_free(bytes.data);
+  SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Protocol %s, flight recorder written to %s",
+              reason_names[reason], text_path);
+}
+
+void flight_recorder_poll(void) {
+  const flight_reason_t reason = (flight_reason_t)SDL_GetAtomicInt(&requested_reason);
+  if (reason == FLIGHT_REASON_NONE) {
+    return;
+  }
+  if (last_dump_ticks == 0 || SDL_GetTicks() - last_dump_ticks >= DUMP_INTERVAL_MS) {
+    last_dump_ticks = SDL_GetTicks();
+    write_dump(reason);
+  }
+  SDL_SetAtomicInt(&requested_reason, FLIGHT_REASON_NONE);
+}
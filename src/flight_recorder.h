@@ -0,0 +1,37 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Protocol flight recorder. The last few seconds of raw inbound bytes and decoded packets are
+// kept in fixed-size rings and written to timestamped, numbered files in the preferences
+// directory when a protocol error occurs: a SLIP decoding error, an invalid packet or a full
+// message queue.
+
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  FLIGHT_REASON_NONE,
+  FLIGHT_REASON_SLIP_ERROR,
+  FLIGHT_REASON_INVALID_PACKET,
+  FLIGHT_REASON_QUEUE_OVERFLOW,
+} flight_reason_t;
+
+// Set up the recorder before the device is opened
+void flight_recorder_init(void);
+
+// Record bytes as they were read from the device. Called from the thread reading the device.
+void flight_recorder_bytes(const uint8_t *data, size_t length);
+
+// Record a decoded packet before it is processed. Main thread only.
+void flight_recorder_packet(const uint8_t *data, uint32_t length);
+
+// Request a dump, safe to call from any thread. The dump is written by flight_recorder_poll().
+void flight_recorder_trigger(flight_reason_t reason);
+
+// Write a requested dump. Called from the main loop.
+void flight_recorder_poll(void);
+
+#endif // FLIGHT_RECORDER_H_
@@ -0,0 +1,33 @@
+// font_glyphs.h
+// Packed 1bpp glyph bitmaps of the embedded fonts. The tables are generated at build time by
+// tools/font_glyphgen.c from the BMP images in font1.h-font5.h, in the order of fonts_get().
+#ifndef FONT_GLYPHS_H
+#define FONT_GLYPHS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Printable ASCII characters from '!' to '~'
+#define FONT_GLYPH_FIRST 33
+#define FONT_GLYPH_COUNT 94
+
+struct font_glyphs {
+  const int glyph_width;  // cell width, the same as the font's glyph_x
+  const int glyph_height; // cell height
+  const int row_bytes;    // bytes per glyph row, the leftmost pixel in the highest bit
+  // FONT_GLYPH_COUNT glyphs of glyph_height rows each, set bits are glyph pixels
+  const uint8_t *const bits;
+};
+
+// Get the glyph table of a font by its fonts_get() index (returns NULL if out of range)
+const struct font_glyphs *font_glyphs_get(size_t index);
+
+// Rows of a glyph, NULL for characters outside the table
+static inline const uint8_t *font_glyph_rows(const struct font_glyphs *glyphs, const int c) {
+  if (c < FONT_GLYPH_FIRST || c >= FONT_GLYPH_FIRST + FONT_GLYPH_COUNT) {
+    return NULL;
+  }
+  return glyphs->bits + (size_t)(c - FONT_GLYPH_FIRST) * glyphs->glyph_height * glyphs->row_bytes;
+}
+
+#endif // FONT_GLYPHS_H
@@ -0,0 +1,501 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "framebuffer.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FRAMEBUFFER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRAMEBUFFER_SSE2
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define FRAMEBUFFER_NEON
+#endif
+
+#define PALETTE_SIZE 256
+#define COLOR_SLOTS 1024 // open addressing table from RGB to palette index, a power of two
+#define OPAQUE 0xFF000000
+#define MERGE_GAP 8 // changed spans closer than this on adjacent rows share a dirty rectangle
+
+static int fb_width = 0;
+static int fb_height = 0;
+static uint8_t *indexed = NULL; // palette indices, used until the palette overflows
+static uint32_t *direct = NULL; // ARGB pixels, used after the palette overflowed
+static int direct_mode = 0;
+
+// Expanded ARGB copy of the frame, the source of texture uploads
+static uint32_t *argb = NULL;
+static uint8_t *row_pending = NULL; // rows drawn to since the last commit
+static int pending_first, pending_last;
+
+// The pixels as of the last commit, drawn rows are compared against these to find what changed
+static uint8_t *shown_indexed = NULL;
+static uint32_t *shown_direct = NULL;
+static int full_change = 1; // the palette or color mode changed, every pixel has to be expanded
+
+// Regions changed by the commits since the last upload
+static SDL_Rect dirty_rects[FRAMEBUFFER_MAX_DIRTY_RECTS];
+static int dirty_count = 0;
+
+static uint32_t palette[PALETTE_SIZE]; // ARGB
+static int palette_count = 0;
+static uint32_t slot_keys[COLOR_SLOTS]; // RGB + 1, 0 for a free slot
+static uint8_t slot_indices[COLOR_SLOTS];
+static uint32_t last_rgb;
+static int last_index = -1;
+
+#if defined(FRAMEBUFFER_NEON)
+// Blue, green and red bytes of the palette as separate tables for vqtbl lookups
+static uint8_t palette_planes[3][PALETTE_SIZE];
+#endif
+
+static void reset_palette(void) {
+  palette_count = 0;
+  SDL_memset(slot_keys, 0, sizeof(slot_keys));
+  last_index = -1;
+}
+
+// Palette index of a color, learning new colors. Returns -1 when the palette is full.
+static int color_index(const uint32_t rgb) {
+  if (last_index >= 0 && rgb == last_rgb) {
+    return last_index;
+  }
+  unsigned int slot = (rgb * 2654435761u) >> 22; // top 10 bits of a multiplicative hash
+  while (slot_keys[slot] != 0) {
+    if (slot_keys[slot] == rgb + 1) {
+      last_rgb = rgb;
+      last_index = slot_indices[slot];
+      return last_index;
+    }
+    slot = (slot + 1) & (COLOR_SLOTS - 1);
+  }
+  if (palette_count == PALETTE_SIZE) {
+    return -1;
+  }
+
+  const int index = palette_count++;
+  palette[index] = OPAQUE | rgb;
+#if defined(FRAMEBUFFER_NEON)
+  palette_planes[0][index] = (uint8_t)rgb;
+  palette_planes[1][index] = (uint8_t)(rgb >> 8);
+  palette_planes[2][index] = (uint8_t)(rgb >> 16);
+#endif
+  slot_keys[slot] = rgb + 1;
+  slot_indices[slot] = (uint8_t)index;
+  last_rgb = rgb;
+  last_index = index;
+  return index;
+}
+
+static void mark_rows(const int first, const int last) {
+  for (int y = first; y <= last; y++) {
+    row_pending[y] = 1;
+  }
+  pending_first = SDL_min(pending_first, first);
+  pending_last = SDL_max(pending_last, last);
+}
+
+// Switch to direct color for the rest of the frame, the palette is full
+static void enter_direct_mode(void) {
+  if (direct == NULL) {
+    direct = SDL_malloc(sizeof(uint32_t) * fb_width * fb_height);
+    shown_direct = SDL_malloc(sizeof(uint32_t) * fb_width * fb_height);
+    if (direct == NULL || shown_direct == NULL) {
+      SDL_free(direct);
+      SDL_free(shown_direct);
+      direct = NULL;
+      shown_direct = NULL;
+      return;
+    }
+  }
+  for (int i = 0; i < fb_width * fb_height; i++) {
+    direct[i] = palette[indexed[i]];
+  }
+  direct_mode = 1;
+  full_change = 1;
+  SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "More than %d colors on screen, using direct color",
+               PALETTE_SIZE);
+}
+
+// Resolve a color for drawing: its palette index, or -1 in direct mode
+static int prepare_color(const uint32_t rgb) {
+  if (direct_mode) {
+    return -1;
+  }
+  const int index = color_index(rgb);
+  if (index < 0) {
+    enter_direct_mode();
+    if (!direct_mode) {
+      return 0; // no memory for direct pixels, draw with the first palette color
+    }
+  }
+  return index;
+}
+
+static void expand_row(const uint8_t *src, uint32_t *dst, const int width) {
+  int x = 0;
+#if defined(FRAMEBUFFER_AVX2)
+  // Gather eight palette entries at a time
+  for (; x + 8 <= width; x += 8) {
+    const __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + x)));
+    const __m256i pixels = _mm256_i32gather_epi32((const int *)palette, idx, 4);
+    _mm256_storeu_si256((__m256i *)(dst + x), pixels);
+  }
+#elif defined(FRAMEBUFFER_NEON)
+  // Each color plane is a 256 byte table, looked up 64 bytes at a time. vqtbx leaves lanes with
+  // an out of range index untouched, so four lookups with a shifted index cover the table.
+  uint8x16x4_t tables[3][4];
+  for (int plane = 0; plane < 3; plane++) {
+    for (int part = 0; part < 4; part++) {
+      const uint8_t *p = palette_planes[plane] + part * 64;
+      tables[plane][part].val[0] = vld1q_u8(p);
+      tables[plane][part].val[1] = vld1q_u8(p + 16);
+      tables[plane][part].val[2] = vld1q_u8(p + 32);
+      tables[plane][part].val[3] = vld1q_u8(p + 48);
+    }
+  }
+  const uint8x16_t offset = vdupq_n_u8(64);
+  for (; x + 16 <= width; x += 16) {
+    const uint8x16_t idx0 = vld1q_u8(src + x);
+    const uint8x16_t idx1 = vsubq_u8(idx0, offset);
+    const uint8x16_t idx2 = vsubq_u8(idx1, offset);
+    const uint8x16_t idx3 = vsubq_u8(idx2, offset);
+    uint8x16x4_t pixels;
+    for (int plane = 0; plane < 3; plane++) {
+      uint8x16_t value = vqtbl4q_u8(tables[plane][0], idx0);
+      value = vqtbx4q_u8(value, tables[plane][1], idx1);
+      value = vqtbx4q_u8(value, tables[plane][2], idx2);
+      pixels.val[plane] = vqtbx4q_u8(value, tables[plane][3], idx3);
+    }
+    pixels.val[3] = vdupq_n_u8(0xFF);
+    // Interleaved B, G, R, A bytes are little-endian ARGB8888 pixels
+    vst4q_u8((uint8_t *)(dst + x), pixels);
+  }
+#endif
+  for (; x < width; x++) {
+    dst[x] = palette[src[x]];
+  }
+}
+
+// Returns 1 if two blocks of DIFF_BLOCK bytes are equal
+#if defined(FRAMEBUFFER_AVX2)
+#define DIFF_BLOCK 32
+static int blocks_equal(const uint8_t *a, const uint8_t *b) {
+  const __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)a),
+                                       _mm256_loadu_si256((const __m256i *)b));
+  return _mm256_movemask_epi8(eq) == -1;
+}
+#elif defined(FRAMEBUFFER_SSE2)
+#define DIFF_BLOCK 16
+static int blocks_equal(const uint8_t *a, const uint8_t *b) {
+  const __m128i eq =
+      _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+  return _mm_movemask_epi8(eq) == 0xFFFF;
+}
+#elif defined(FRAMEBUFFER_NEON)
+#define DIFF_BLOCK 16
+static int blocks_equal(const uint8_t *a, const uint8_t *b) {
+  return vminvq_u8(vceqq_u8(vld1q_u8(a), vld1q_u8(b))) == 0xFF;
+}
+#else
+#define DIFF_BLOCK 8
+static int blocks_equal(const uint8_t *a, const uint8_t *b) { return SDL_memcmp(a, b, 8) == 0; }
+#endif
+
+// Find the first and last differing byte of two rows a block at a time, scanning from both
+// ends. Returns 0 if the rows are equal.
+static int row_diff(const uint8_t *a, const uint8_t *b, const int length, int *first,
+                    int *last) {
+  int start = 0;
+  while (start + DIFF_BLOCK <= length && blocks_equal(a + start, b + start)) {
+    start += DIFF_BLOCK;
+  }
+  while (start < length && a[start] == b[start]) {
+    start++;
+  }
+  if (start == length) {
+    return 0;
+  }
+
+  int end = length;
+  while (end - DIFF_BLOCK > start && blocks_equal(a + end - DIFF_BLOCK, b + end - DIFF_BLOCK)) {
+    end -= DIFF_BLOCK;
+  }
+  while (a[end - 1] == b[end - 1]) {
+    end--;
+  }
+  *first = start;
+  *last = end - 1;
+  return 1;
+}
+
+// Add a changed span of a row to the dirty rectangles. Spans on consecutive rows are merged
+// into the rectangle above them when they overlap it or are close to it.
+static void add_dirty_span(const int y, const int x0, const int x1) {
+  if (dirty_count > 0) {
+    SDL_Rect *r = &dirty_rects[dirty_count - 1];
+    const int near = y >= r->y - 1 && y <= r->y + r->h && x0 <= r->x + r->w + MERGE_GAP &&
+                     x1 >= r->x - MERGE_GAP;
+    if (near || dirty_count == FRAMEBUFFER_MAX_DIRTY_RECTS) {
+      const int left = SDL_min(r->x, x0);
+      const int right = SDL_max(r->x + r->w, x1 + 1);
+      const int top = SDL_min(r->y, y);
+      const int bottom = SDL_max(r->y + r->h, y + 1);
+      *r = (SDL_Rect){left, top, right - left, bottom - top};
+      return;
+    }
+  }
+  dirty_rects[dirty_count++] = (SDL_Rect){x0, y, x1 - x0 + 1, 1};
+}
+
+// Copy a span of a row to the shown pixels and expand it to ARGB
+static void show_span(const int y, const int x0, const int x1) {
+  const int offset = y * fb_width + x0;
+  const int width = x1 - x0 + 1;
+  if (direct_mode) {
+    SDL_memcpy(shown_direct + offset, direct + offset, sizeof(uint32_t) * width);
+    SDL_memcpy(argb + offset, direct + offset, sizeof(uint32_t) * width);
+  } else {
+    SDL_memcpy(shown_indexed + offset, indexed + offset, width);
+    expand_row(indexed + offset, argb + offset, width);
+  }
+}
+
+// Find the pixels that changed on a drawn row. Returns 0 if drawing left the row as it was.
+static int changed_span(const int y, int *x0, int *x1) {
+  const int offset = y * fb_width;
+  if (!direct_mode) {
+    return row_diff(indexed + offset, shown_indexed + offset, fb_width, x0, x1);
+  }
+  int first, last;
+  if (!row_diff((const uint8_t *)(direct + offset), (const uint8_t *)(shown_direct + offset),
+                fb_width * (int)sizeof(uint32_t), &first, &last)) {
+    return 0;
+  }
+  *x0 = first / (int)sizeof(uint32_t);
+  *x1 = last / (int)sizeof(uint32_t);
+  return 1;
+}
+
+void framebuffer_close(void) {
+  SDL_free(indexed);
+  SDL_free(direct);
+  SDL_free(argb);
+  SDL_free(row_pending);
+  SDL_free(shown_indexed);
+  SDL_free(shown_direct);
+  indexed = NULL;
+  direct = NULL;
+  argb = NULL;
+  row_pending = NULL;
+  shown_indexed = NULL;
+  shown_direct = NULL;
+  fb_width = 0;
+  fb_height = 0;
+}
+
+int framebuffer_init(const int width, const int height, const uint32_t rgb) {
+  framebuffer_close();
+  indexed = SDL_malloc((size_t)width * height);
+  shown_indexed = SDL_malloc((size_t)width * height);
+  argb = SDL_malloc(sizeof(uint32_t) * width * height);
+  row_pending = SDL_calloc(height, 1);
+  if (indexed == NULL || shown_indexed == NULL || argb == NULL || row_pending == NULL) {
+    SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't allocate the framebuffer");
+    framebuffer_close();
+    return 0;
+  }
+  fb_width = width;
+  fb_height = height;
+  pending_first = height;
+  pending_last = -1;
+  direct_mode = 0;
+  reset_palette();
+  framebuffer_fill_rect(0, 0, width, height, rgb);
+  return 1;
+}
+
+int framebuffer_width(void) { return fb_width; }
+
+int framebuffer_height(void) { return fb_height; }
+
+void framebuffer_fill_rect(int x, int y, int w, int h, const uint32_t rgb) {
+  if (indexed == NULL) {
+    return;
+  }
+  if (x <= 0 && y <= 0 && x + w >= fb_width && y + h >= fb_height &&
+      (direct_mode || palette_count == 0 || palette_count > PALETTE_SIZE * 3 / 4)) {
+    // The whole screen is one color, start learning the palette over. A palette with room left
+    // is kept so that the indices of unchanged pixels stay comparable with the shown frame.
+    reset_palette();
+    direct_mode = 0;
+    full_change = 1;
+  }
+
+  // Clip to the framebuffer
+  if (x < 0) {
+    w += x;
+    x = 0;
+  }
+  if (y < 0) {
+    h += y;
+    y = 0;
+  }
+  w = SDL_min(w, fb_width - x);
+  h = SDL_min(h, fb_height - y);
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+
+  const int index = prepare_color(rgb);
+  for (int row = y; row < y + h; row++) {
+    if (direct_mode) {
+      uint32_t *p = direct + row * fb_width + x;
+      for (int i = 0; i < w; i++) {
+        p[i] = OPAQUE | rgb;
+      }
+    } else {
+      SDL_memset(indexed + row * fb_width + x, index, w);
+    }
+  }
+  mark_rows(y, y + h - 1);
+}
+
+void framebuffer_plot(const int x, const uint8_t *samples, const int count, const uint32_t rgb,
+                     const int lines) {
+  if (indexed == NULL || count <= 0) {
+    return;
+  }
+  const int index = prepare_color(rgb);
+  int top = fb_height;
+  int bottom = -1;
+  for (int i = 0; i < count; i++) {
+    const int px = x + i;
+    if (px < 0 || px >= fb_width) {
+      continue;
+    }
+    int first = samples[i];
+    int last = samples[i];
+    if (lines && i > 0) {
+      first = SDL_min(first, samples[i - 1]);
+      last = SDL_max(last, samples[i - 1]);
+    }
+    last = SDL_min(last, fb_height - 1);
+    if (first > last) {
+      continue;
+    }
+    for (int py = first; py <= last; py++) {
+      if (direct_mode) {
+        direct[py * fb_width + px] = OPAQUE | rgb;
+      } else {
+        indexed[py * fb_width + px] = (uint8_t)index;
+      }
+    }
+    top = SDL_min(top, first);
+    bottom = SDL_max(bottom, last);
+  }
+  if (top <= bottom) {
+    mark_rows(top, bottom);
+  }
+}
+
+void framebuffer_print(const struct font_glyphs *glyphs, const char *text, int x, const int y,
+                       const int cell_width, const int cell_height, const uint32_t fg_rgb,
+                       const uint32_t bg_rgb) {
+  if (indexed == NULL || glyphs == NULL) {
+    return;
+  }
+  for (; *text != '\0'; text++, x += cell_width + 1) {
+    if (bg_rgb != fg_rgb) {
+      framebuffer_fill_rect(x, y, cell_width, cell_height, bg_rgb);
+    }
+    const uint8_t *rows = font_glyph_rows(glyphs, (unsigned char)*text);
+    if (rows == NULL) {
+      continue; // whitespace and characters the font doesn't have
+    }
+
+    const int index = prepare_color(fg_rgb);
+    const int first = SDL_max(0, y);
+    const int last = SDL_min(fb_height - 1, y + glyphs->glyph_height - 1);
+    for (int py = first; py <= last; py++) {
+      const uint8_t *bits = rows + (py - y) * glyphs->row_bytes;
+      for (int gx = 0; gx < glyphs->glyph_width; gx++) {
+        const int px = x + gx;
+        if (px < 0 || px >= fb_width || !(bits[gx / 8] & (0x80 >> (gx % 8)))) {
+          continue;
+        }
+        if (direct_mode) {
+          direct[py * fb_width + px] = OPAQUE | fg_rgb;
+        } else {
+          indexed[py * fb_width + px] = (uint8_t)index;
+        }
+      }
+    }
+    if (first <= last) {
+      mark_rows(first, last);
+    }
+  }
+}
+
+int framebuffer_commit(void) {
+  if (argb == NULL) {
+    return 0;
+  }
+  if (full_change) {
+    full_change = 0;
+    for (int y = 0; y < fb_height; y++) {
+      row_pending[y] = 0;
+      show_span(y, 0, fb_width - 1);
+    }
+    pending_first = fb_height;
+    pending_last = -1;
+    dirty_rects[0] = (SDL_Rect){0, 0, fb_width, fb_height};
+    dirty_count = 1;
+    return 1;
+  }
+
+  for (int y = pending_first; y <= pending_last; y++) {
+    if (!row_pending[y]) {
+      continue;
+    }
+    row_pending[y] = 0;
+    int x0, x1;
+    if (changed_span(y, &x0, &x1)) {
+      show_span(y, x0, x1);
+      add_dirty_span(y, x0, x1);
+    }
+  }
+  pending_first = fb_height;
+  pending_last = -1;
+  // Changes committed by an earlier call, e.g. for a screenshot, are still waiting for the upload
+  return dirty_count > 0;
+}
+
+void framebuffer_invalidate(void) { full_change = 1; }
+
+const SDL_Rect *framebuffer_dirty_rects(int *count) {
+  *count = dirty_count;
+  return dirty_rects;
+}
+
+void framebuffer_reset_dirty_rects(void) { dirty_count = 0; }
+
+void framebuffer_upload(SDL_Texture *texture) {
+  framebuffer_commit();
+  for (int i = 0; i < dirty_count; i++) {
+    const SDL_Rect *r = &dirty_rects[i];
+    if (!SDL_UpdateTexture(texture, r, argb + r->y * fb_width + r->x,
+                           fb_width * (int)sizeof(uint32_t))) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't upload the framebuffer: %s",
+                   SDL_GetError());
+    }
+  }
+  dirty_count = 0;
+}
+
+const uint32_t *framebuffer_argb(void) {
+  framebuffer_commit();
+  return argb;
+}
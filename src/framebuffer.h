@@ -0,0 +1,64 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// CPU-side framebuffer of the M8 display. The M8 only uses a handful of theme colors, so
+// pixels are stored as 8-bit indices into a palette learned from the draw commands. When a frame
+// needs more than 256 colors the framebuffer falls back to direct ARGB pixels until the next
+// full screen clear. Once per frame the rows touched by drawing are compared with the previous
+// frame, and only the pixels that changed are expanded to ARGB and uploaded to a streaming
+// texture as a few dirty rectangles.
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include "fonts/font_glyphs.h"
+#include "sdl_compat.h"
+#include <stdint.h>
+
+// Upper bound of the dirty rectangles collected between uploads, further changes are merged
+#define FRAMEBUFFER_MAX_DIRTY_RECTS 16
+
+// Allocate a framebuffer of the given size filled with the color, replacing any previous one
+int framebuffer_init(int width, int height, uint32_t rgb);
+
+void framebuffer_close(void);
+
+int framebuffer_width(void);
+int framebuffer_height(void);
+
+// Fill a rectangle, clipped to the framebuffer. A rectangle covering the whole framebuffer
+// resets the palette.
+void framebuffer_fill_rect(int x, int y, int w, int h, uint32_t rgb);
+
+// Plot the oscilloscope: one sample per column from x, each sample the y coordinate of its
+// pixel. With lines set, each sample is joined to the previous one by a vertical run so the
+// points form a line strip.
+void framebuffer_plot(int x, const uint8_t *samples, int count, uint32_t rgb, int lines);
+
+// Draw a string with a glyph table, advancing by the font's glyph_x + 1 per character. The
+// glyph cell is filled with the background color unless it equals the foreground color.
+void framebuffer_print(const struct font_glyphs *glyphs, const char *text, int x, int y,
+                       int cell_width, int cell_height, uint32_t fg_rgb, uint32_t bg_rgb);
+
+// Compare the rows drawn since the last commit with the previous frame and add the changed
+// regions to the dirty rectangles. Returns 1 if there are dirty rectangles.
+int framebuffer_commit(void);
+
+// Expand and upload the whole frame with the next commit, when the texture has to be rebuilt
+void framebuffer_invalidate(void);
+
+// The regions changed since the last upload, in framebuffer coordinates
+const SDL_Rect *framebuffer_dirty_rects(int *count);
+
+// Forget the dirty rectangles when the frame was consumed without an upload
+void framebuffer_reset_dirty_rects(void);
+
+// Commit and copy the dirty rectangles to an ARGB8888 streaming texture of the framebuffer's
+// size
+void framebuffer_upload(SDL_Texture *texture);
+
+// Read the framebuffer as ARGB8888 pixels, the returned buffer stays valid until the next
+// framebuffer call. Pending changes are committed first.
+const uint32_t *framebuffer_argb(void);
+
+#endif // FRAMEBUFFER_H_
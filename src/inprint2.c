@@ -2,49 +2,125 @@
 // https://github.com/driedfruit/SDL_inprint Released into public domain.
 // Modified to support multiple fonts & adding a background to text.
 
+#include "fonts/font_glyphs.h"
 #include "fonts/fonts.h"
 #include "sdl_compat.h"
+#include "trace.h"
 
 #define CHARACTERS_PER_ROW 94
 #define CHARACTERS_PER_COLUMN 1
+#define FONT_ATLAS_MAX_FONTS 8
+#define NO_COLOR 0xFFFFFFFF // never a valid 0x00RRGGBB color
 
 // Offset for seeking from limited character sets
 static const int font_offset = 127 - CHARACTERS_PER_ROW * CHARACTERS_PER_COLUMN;
 
 static SDL_Renderer *selected_renderer = NULL;
-static SDL_Texture *inline_font = NULL;
 static SDL_Texture *selected_font = NULL;
 static const struct inline_font *selected_inline_font;
 static Uint16 selected_font_w, selected_font_h;
-
-void inline_font_initialize(const struct inline_font *font) {
-
-  if (inline_font != NULL) {
-    return;
+static Uint16 selected_font_y; // top of the selected font's glyph strip in the texture
+static Uint32 previous_fgcolor = NO_COLOR;
+
+// All fonts are stacked vertically in one texture built on first use, switching fonts only
+// changes the source rectangle of the glyphs
+static SDL_Texture *font_atlas = NULL;
+static const struct inline_font *atlas_fonts[FONT_ATLAS_MAX_FONTS];
+static Uint16 atlas_y[FONT_ATLAS_MAX_FONTS];
+static size_t atlas_font_count = 0;
+
+static int build_font_atlas(void) {
+  size_t count;
+  const struct inline_font *const *fonts = fonts_all(&count);
+  count = SDL_min(count, (size_t)FONT_ATLAS_MAX_FONTS);
+
+  int atlas_w = 0;
+  int atlas_h = 0;
+  for (size_t i = 0; i < count; i++) {
+    atlas_w = SDL_max(atlas_w, fonts[i]->width);
+    atlas_h += fonts[i]->height;
   }
 
-  selected_inline_font = font;
-  selected_font_w = selected_inline_font->width;
-  selected_font_h = selected_inline_font->height;
-
-  SDL_IOStream *font_bmp =
-      SDL_IOFromConstMem(selected_inline_font->image_data, selected_inline_font->image_size);
-
-  SDL_Surface *surface = SDL_LoadBMP_IO(font_bmp, 1);
-
-  // Black is transparent
-  SDL_SetSurfaceColorKey(surface, true, SDL_MapSurfaceRGB(surface, 0, 0, 0));
+  SDL_Surface *atlas = SDL_CreateSurface(atlas_w, atlas_h, SDL_PIXELFORMAT_ARGB8888);
+  if (atlas == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't create font atlas: %s", SDL_GetError());
+    return 0;
+  }
+  SDL_FillSurfaceRect(atlas, NULL, 0); // transparent where there is no glyph pixel
+
+  // Expand the generated 1bpp glyph tables into white glyph pixels
+  int y = 0;
+  atlas_font_count = 0;
+  for (size_t i = 0; i < count; i++) {
+    const struct font_glyphs *glyphs = font_glyphs_get(i);
+    if (glyphs == NULL) {
+      continue;
+    }
+    for (int glyph = 0; glyph < FONT_GLYPH_COUNT; glyph++) {
+      const uint8_t *rows = font_glyph_rows(glyphs, FONT_GLYPH_FIRST + glyph);
+      for (int row = 0; row < glyphs->glyph_height; row++) {
+        Uint32 *pixels = (Uint32 *)((Uint8 *)atlas->pixels + (size_t)(y + row) * atlas->pitch) +
+                         glyph * glyphs->glyph_width;
+        const uint8_t *bits = rows + row * glyphs->row_bytes;
+        for (int x = 0; x < glyphs->glyph_width; x++) {
+          if (bits[x / 8] & (0x80 >> (x % 8))) {
+            pixels[x] = 0xFFFFFFFF;
+          }
+        }
+      }
+    }
+    atlas_fonts[atlas_font_count] = fonts[i];
+    atlas_y[atlas_font_count] = (Uint16)y;
+    atlas_font_count++;
+    y += fonts[i]->height;
+  }
 
-  inline_font = SDL_CreateTextureFromSurface(selected_renderer, surface);
+  font_atlas = SDL_CreateTextureFromSurface(selected_renderer, atlas);
+  SDL_DestroySurface(atlas);
+  if (font_atlas == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't create font atlas texture: %s",
+                 SDL_GetError());
+    atlas_font_count = 0;
+    return 0;
+  }
+  SDL_SetTextureBlendMode(font_atlas, SDL_BLENDMODE_BLEND);
+  // Glyphs are drawn 1:1, nearest sampling keeps neighbouring fonts from bleeding in
+  SDL_SetTextureScaleMode(font_atlas, SDL_SCALEMODE_NEAREST);
+  previous_fgcolor = NO_COLOR;
+  return 1;
+}
 
-  SDL_DestroySurface(surface);
+void inline_font_initialize(const struct inline_font *font) {
+  if (font == NULL) {
+    return;
+  }
+  if (font_atlas == NULL && !build_font_atlas()) {
+    return;
+  }
 
-  selected_font = inline_font;
+  for (size_t i = 0; i < atlas_font_count; i++) {
+    if (atlas_fonts[i] == font) {
+      if (selected_font != font_atlas) {
+        previous_fgcolor = NO_COLOR; // the color modulation belongs to another texture
+      }
+      selected_inline_font = font;
+      selected_font = font_atlas;
+      selected_font_w = font->width;
+      selected_font_h = font->height;
+      selected_font_y = atlas_y[i];
+      return;
+    }
+  }
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Font is not in the font table");
 }
 
 void inline_font_close(void) {
-  SDL_DestroyTexture(inline_font);
-  inline_font = NULL;
+  if (font_atlas != NULL) {
+    SDL_DestroyTexture(font_atlas);
+    font_atlas = NULL;
+  }
+  atlas_font_count = 0;
+  selected_font = NULL;
 }
 
 void inline_font_set_renderer(SDL_Renderer *renderer) { selected_renderer = renderer; }
@@ -63,6 +139,8 @@ void infont(SDL_Texture *font) {
   selected_font = font;
   selected_font_w = w;
   selected_font_h = h;
+  selected_font_y = 0;
+  previous_fgcolor = NO_COLOR;
 }
 void incolor1(const SDL_Color *color) {
   SDL_SetTextureColorMod(selected_font, color->r, color->g, color->b);
@@ -80,8 +158,8 @@ void inprint(SDL_Renderer *dst, const char *str, Uint32 x, Uint32 y, const Uint3
   SDL_FRect s_rect;
   SDL_FRect d_rect;
   SDL_FRect bg_rect;
-
-  static uint32_t previous_fgcolor;
+  // Overlays print many short strings per frame, recorded as batches
+  const uint64_t trace_start = trace_begin();
 
   d_rect.x = (float)x;
   d_rect.y = (float)y;
@@ -101,10 +179,10 @@ void inprint(SDL_Renderer *dst, const char *str, Uint32 x, Uint32 y, const Uint3
     int row = id / CHARACTERS_PER_ROW;
     int col = id % CHARACTERS_PER_ROW;
     s_rect.x = col * s_rect.w;
-    s_rect.y = row * s_rect.h;
+    s_rect.y = selected_font_y + row * s_rect.h;
 #else
     s_rect.x = (float)id * s_rect.w;
-    s_rect.y = 0;
+    s_rect.y = (float)selected_font_y;
 #endif
     if (id + font_offset == '\n') {
       d_rect.x = (float)x;
@@ -131,6 +209,7 @@ void inprint(SDL_Renderer *dst, const char *str, Uint32 x, Uint32 y, const Uint3
     }
     d_rect.x += (float)selected_inline_font->glyph_x + 1;
   }
+  trace_end_batched("inprint", trace_start, 50);
 }
 
 const struct inline_font *inline_font_get_current(void) {
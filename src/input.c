@@ -2,11 +2,14 @@
 // Created by Jonne Kokkonen on 15.4.2025.
 //
 #include "input.h"
+#include "audio_meter.h"
 #include "backends/audio.h"
-#include "backends/m8.h"
 #include "common.h"
 #include "render.h"
 #include "log_overlay.h"
+#include "mux.h"
+#include "perf_hud.h"
+#include "trace.h"
 #include "sdl_compat.h"
 
 static unsigned char keyjazz_enabled = 0;
@@ -201,14 +204,31 @@ void input_handle_key_down_event(struct app_context *ctx, const SDL_Event *event
     return;
   }
 
+  if (COMPAT_KEY_SCANCODE(event) == ctx->conf.key_toggle_meters) {
+    audio_meter_toggle();
+    return;
+  }
+
+  if (COMPAT_KEY_SCANCODE(event) == ctx->conf.key_toggle_hud) {
+    perf_hud_toggle();
+    return;
+  }
+
+  if (COMPAT_KEY_SCANCODE(event) == ctx->conf.key_trace_flush && trace_is_enabled()) {
+    trace_flush();
+    SDL_Log("Trace flushed");
+    return;
+  }
+
   if (COMPAT_KEY_SCANCODE(event) == ctx->conf.key_toggle_audio && ctx->device_connected) {
     ctx->conf.audio_enabled = !ctx->conf.audio_enabled;
     audio_toggle(ctx->conf.audio_device_name, ctx->conf.audio_buffer_size);
     return;
   }
 
-  if (COMPAT_KEY_SCANCODE(event) == ctx->conf.key_reset && ctx->device_connected && !keyjazz_enabled) {
-    m8_reset_display();
+  if (COMPAT_KEY_SCANCODE(event) == ctx->conf.key_reset &&
+      (ctx->device_connected || mux_is_client()) && !keyjazz_enabled) {
+    mux_reset_display();
     return;
   }
 
@@ -282,7 +302,7 @@ void input_handle_gamepad_button(struct app_context *ctx, const SDL_GamepadButto
 
   // Handle special button combinations
   if (gamepad_state.current_buttons == (key_start | key_select | key_opt | key_edit)) {
-    m8_reset_display();
+    mux_reset_display();
     return;
   }
 
@@ -358,7 +378,7 @@ void input_handle_gamepad_axis(const struct app_context *ctx, const SDL_GamepadA
  * Returns 1 for successful processing and sending of messages, or 0 if the device is not connected.
  */
 int input_process_and_send(const struct app_context *ctx) {
-  if (!ctx->device_connected) {
+  if (!ctx->device_connected && !mux_is_client()) {
     return 0;
   }
   static unsigned char prev_input = 0;
@@ -370,17 +390,17 @@ int input_process_and_send(const struct app_context *ctx) {
   case normal:
     if (input.value != prev_input) {
       prev_input = input.value;
-      m8_send_msg_controller(input.value);
+      mux_send_msg_controller(input.value);
     }
     break;
   case keyjazz:
     if (input.value != 0) {
       if (input.value != prev_input) {
         prev_input = input.value;
-        m8_send_msg_keyjazz(input.value, keyjazz_velocity);
+        mux_send_msg_keyjazz(input.value, keyjazz_velocity);
       }
     } else {
-      m8_send_msg_keyjazz(0xFF, 0);
+      mux_send_msg_keyjazz(0xFF, 0);
     }
     prev_input = input.value;
     break;
@@ -0,0 +1,146 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "keysym.h"
+#include "sdl_compat.h"
+
+static SDL_Keymod key_mod = 0;
+static uint8_t keys_down[SDL_SCANCODE_COUNT];
+
+// Map an X11 keysym to the scancode and keycode of the key that produces it
+static int translate_keysym(const uint32_t keysym, SDL_Scancode *scancode, SDL_Keycode *keycode) {
+  static const struct {
+    uint32_t keysym;
+    SDL_Scancode scancode;
+  } special_keys[] = {
+      {KEYSYM_BACKSPACE, SDL_SCANCODE_BACKSPACE},
+      {KEYSYM_TAB, SDL_SCANCODE_TAB},
+      {KEYSYM_RETURN, SDL_SCANCODE_RETURN},
+      {KEYSYM_ESCAPE, SDL_SCANCODE_ESCAPE},
+      {KEYSYM_DELETE, SDL_SCANCODE_DELETE},
+      {KEYSYM_HOME, SDL_SCANCODE_HOME},
+      {KEYSYM_LEFT, SDL_SCANCODE_LEFT},
+      {KEYSYM_UP, SDL_SCANCODE_UP},
+      {KEYSYM_RIGHT, SDL_SCANCODE_RIGHT},
+      {KEYSYM_DOWN, SDL_SCANCODE_DOWN},
+      {KEYSYM_PAGE_UP, SDL_SCANCODE_PAGEUP},
+      {KEYSYM_PAGE_DOWN, SDL_SCANCODE_PAGEDOWN},
+      {KEYSYM_END, SDL_SCANCODE_END},
+      {KEYSYM_INSERT, SDL_SCANCODE_INSERT},
+      {KEYSYM_SHIFT_L, SDL_SCANCODE_LSHIFT},
+      {KEYSYM_SHIFT_R, SDL_SCANCODE_RSHIFT},
+      {KEYSYM_CONTROL_L, SDL_SCANCODE_LCTRL},
+      {KEYSYM_CONTROL_R, SDL_SCANCODE_RCTRL},
+      {KEYSYM_META_L, SDL_SCANCODE_LGUI},
+      {KEYSYM_META_R, SDL_SCANCODE_RGUI},
+      {KEYSYM_ALT_L, SDL_SCANCODE_LALT},
+      {KEYSYM_ALT_R, SDL_SCANCODE_RALT},
+      {KEYSYM_SUPER_L, SDL_SCANCODE_LGUI},
+      {KEYSYM_SUPER_R, SDL_SCANCODE_RGUI},
+  };
+  // Punctuation on a US layout, shifted characters map to the same key
+  static const char unshifted[] = "-=[]\\;',./`";
+  static const char shifted[] = "_+{}|:\"<>?~";
+  static const SDL_Scancode punctuation[] = {
+      SDL_SCANCODE_MINUS,        SDL_SCANCODE_EQUALS,     SDL_SCANCODE_LEFTBRACKET,
+      SDL_SCANCODE_RIGHTBRACKET, SDL_SCANCODE_BACKSLASH,  SDL_SCANCODE_SEMICOLON,
+      SDL_SCANCODE_APOSTROPHE,   SDL_SCANCODE_COMMA,      SDL_SCANCODE_PERIOD,
+      SDL_SCANCODE_SLASH,        SDL_SCANCODE_GRAVE};
+  static const char shifted_digits[] = ")!@#$%^&*(";
+
+  if (keysym >= KEYSYM_F1 && keysym <= KEYSYM_F12) {
+    *scancode = SDL_SCANCODE_F1 + (keysym - KEYSYM_F1);
+    *keycode = SDL_SCANCODE_TO_KEYCODE(*scancode);
+    return 1;
+  }
+  for (size_t i = 0; i < SDL_arraysize(special_keys); i++) {
+    if (special_keys[i].keysym == keysym) {
+      *scancode = special_keys[i].scancode;
+      *keycode = SDL_SCANCODE_TO_KEYCODE(*scancode);
+      return 1;
+    }
+  }
+  if (keysym > 0x7E || keysym < 0x20) {
+    return 0;
+  }
+
+  const char c = (char)keysym;
+  if (c >= 'a' && c <= 'z') {
+    *scancode = SDL_SCANCODE_A + (c - 'a');
+    *keycode = c;
+  } else if (c >= 'A' && c <= 'Z') {
+    *scancode = SDL_SCANCODE_A + (c - 'A');
+    *keycode = c - 'A' + 'a';
+  } else if (c >= '1' && c <= '9') {
+    *scancode = SDL_SCANCODE_1 + (c - '1');
+    *keycode = c;
+  } else if (c == '0') {
+    *scancode = SDL_SCANCODE_0;
+    *keycode = c;
+  } else if (c == ' ') {
+    *scancode = SDL_SCANCODE_SPACE;
+    *keycode = c;
+  } else {
+    const char *digit = SDL_strchr(shifted_digits, c);
+    if (digit != NULL) {
+      const int index = (int)(digit - shifted_digits);
+      *scancode = index == 0 ? SDL_SCANCODE_0 : SDL_SCANCODE_1 + (index - 1);
+      *keycode = '0' + index;
+      return 1;
+    }
+    const char *key = SDL_strchr(unshifted, c);
+    if (key == NULL) {
+      key = SDL_strchr(shifted, c);
+      if (key == NULL) {
+        return 0;
+      }
+      key = unshifted + (key - shifted);
+    }
+    *scancode = punctuation[key - unshifted];
+    *keycode = *key;
+  }
+  return 1;
+}
+
+void keysym_push_event(const uint32_t keysym, const int down) {
+  SDL_Scancode scancode;
+  SDL_Keycode keycode;
+  if (!translate_keysym(keysym, &scancode, &keycode)) {
+    return;
+  }
+
+  SDL_Keymod mod = 0;
+  switch (scancode) {
+  case SDL_SCANCODE_LSHIFT:
+  case SDL_SCANCODE_RSHIFT:
+    mod = KMOD_SHIFT;
+    break;
+  case SDL_SCANCODE_LCTRL:
+  case SDL_SCANCODE_RCTRL:
+    mod = KMOD_CTRL;
+    break;
+  case SDL_SCANCODE_LALT:
+  case SDL_SCANCODE_RALT:
+    mod = KMOD_ALT;
+    break;
+  case SDL_SCANCODE_LGUI:
+  case SDL_SCANCODE_RGUI:
+    mod = KMOD_GUI;
+    break;
+  default:
+    break;
+  }
+  key_mod = down ? key_mod | mod : key_mod & ~mod;
+
+  // Held keys are repeated with more key down events
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = down ? SDL_EVENT_KEY_DOWN : SDL_EVENT_KEY_UP;
+  COMPAT_KEY_SCANCODE(&event) = scancode;
+  COMPAT_KEY_SYM(&event) = keycode;
+  COMPAT_KEY_MOD(&event) = key_mod;
+  COMPAT_KEY_REPEAT(&event) = down && keys_down[scancode];
+  COMPAT_KEY_SET_DOWN(&event, down);
+  keys_down[scancode] = down;
+  SDL_PushEvent(&event);
+}
@@ -0,0 +1,48 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Keyboard input from outside SDL, the VNC server and the terminal renderer, described with X11
+// keysyms as in the RFB protocol. The keys are pushed into the SDL event queue as key events, so
+// they go through the same handling as local key presses.
+
+#ifndef KEYSYM_H_
+#define KEYSYM_H_
+
+#include <stdint.h>
+
+// X11 keysyms besides printable ASCII, which is its own keysym
+enum {
+  KEYSYM_BACKSPACE = 0xFF08,
+  KEYSYM_TAB = 0xFF09,
+  KEYSYM_RETURN = 0xFF0D,
+  KEYSYM_ESCAPE = 0xFF1B,
+  KEYSYM_HOME = 0xFF50,
+  KEYSYM_LEFT = 0xFF51,
+  KEYSYM_UP = 0xFF52,
+  KEYSYM_RIGHT = 0xFF53,
+  KEYSYM_DOWN = 0xFF54,
+  KEYSYM_PAGE_UP = 0xFF55,
+  KEYSYM_PAGE_DOWN = 0xFF56,
+  KEYSYM_END = 0xFF57,
+  KEYSYM_INSERT = 0xFF63,
+  KEYSYM_F1 = 0xFFBE,
+  KEYSYM_F12 = 0xFFC9,
+  KEYSYM_SHIFT_L = 0xFFE1,
+  KEYSYM_SHIFT_R = 0xFFE2,
+  KEYSYM_CONTROL_L = 0xFFE3,
+  KEYSYM_CONTROL_R = 0xFFE4,
+  KEYSYM_META_L = 0xFFE7,
+  KEYSYM_META_R = 0xFFE8,
+  KEYSYM_ALT_L = 0xFFE9,
+  KEYSYM_ALT_R = 0xFFEA,
+  KEYSYM_SUPER_L = 0xFFEB,
+  KEYSYM_SUPER_R = 0xFFEC,
+  KEYSYM_DELETE = 0xFFFF
+};
+
+// Push a key down or up event for the keysym, keys without an SDL equivalent are ignored.
+// Modifier keys update the modifier state of the following events, and a key that is already
+// down is reported as a repeat.
+void keysym_push_event(uint32_t keysym, int down);
+
+#endif // KEYSYM_H_
@@ -0,0 +1,121 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "latency.h"
+#include "sdl_compat.h"
+
+// Log-linear buckets over microseconds: values below 16 us are exact, above that every power of
+// two is split into 16 sub-buckets, keeping the relative error under 6.25%
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define BUCKET_COUNT ((32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+#define MAX_PENDING 4096
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = {"decode", "queue", "process", "present",
+                                                       "total"};
+
+static SDL_AtomicInt histograms[LATENCY_STAGE_COUNT][BUCKET_COUNT];
+
+// Messages processed since the last present, only touched from the main thread
+static struct {
+  uint64_t arrival_ns;
+  uint64_t processed_ns;
+} pending[MAX_PENDING];
+static unsigned int pending_count = 0;
+
+static const latency_hooks_s *hooks = NULL;
+
+static unsigned int bucket_index(const uint32_t us) {
+  if (us < SUB_BUCKETS) {
+    return us;
+  }
+  const int magnitude = SDL_MostSignificantBitIndex32(us);
+  const uint32_t sub = (us >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return (unsigned int)(magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+// Upper bound of the values counted in a bucket
+static uint32_t bucket_limit(const unsigned int index) {
+  if (index < SUB_BUCKETS) {
+    return index;
+  }
+  const unsigned int magnitude = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  const uint64_t base = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS)
+                        << (magnitude - SUB_BUCKET_BITS);
+  const uint64_t limit = base + ((uint64_t)1 << (magnitude - SUB_BUCKET_BITS)) - 1;
+  return limit > UINT32_MAX ? UINT32_MAX : (uint32_t)limit;
+}
+
+uint64_t latency_now(void) { return SDL_GetTicksNS(); }
+
+void latency_record(const latency_stage_t stage, const uint64_t start_ns, const uint64_t end_ns) {
+  if (start_ns == 0 || end_ns < start_ns) {
+    return;
+  }
+  const uint64_t us = (end_ns - start_ns) / 1000;
+  SDL_AddAtomicInt(&histograms[stage][bucket_index(us > UINT32_MAX ? UINT32_MAX : (uint32_t)us)],
+                   1);
+}
+
+void latency_set_hooks(const latency_hooks_s *new_hooks) { hooks = new_hooks; }
+
+void latency_message_processed(const uint8_t command, const latency_stamps_s *stamps) {
+  const uint64_t now = latency_now();
+  latency_record(LATENCY_STAGE_PROCESS, stamps->popped_ns, now);
+  if (hooks != NULL) {
+    hooks->message_processed(command, stamps, now);
+  }
+  if (pending_count < MAX_PENDING) {
+    pending[pending_count].arrival_ns = stamps->arrival_ns;
+    pending[pending_count].processed_ns = now;
+    pending_count++;
+  }
+}
+
+void latency_frame_presented(void) {
+  const uint64_t now = latency_now();
+  for (unsigned int i = 0; i < pending_count; i++) {
+    latency_record(LATENCY_STAGE_PRESENT, pending[i].processed_ns, now);
+    latency_record(LATENCY_STAGE_TOTAL, pending[i].arrival_ns, now);
+  }
+  pending_count = 0;
+  if (hooks != NULL) {
+    hooks->frame_presented(now);
+  }
+}
+
+void latency_log_summary(void) {
+  static uint32_t counts[BUCKET_COUNT];
+
+  for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+    uint32_t total = 0;
+    for (unsigned int i = 0; i < BUCKET_COUNT; i++) {
+      counts[i] = (uint32_t)SDL_SetAtomicInt(&histograms[stage][i], 0);
+      total += counts[i];
+    }
+    if (total == 0) {
+      continue;
+    }
+
+    const uint32_t rank_p50 = (total + 1) / 2;
+    const uint32_t rank_p99 = total - total / 100;
+    uint32_t p50 = 0, p99 = 0, max = 0, seen = 0;
+    for (unsigned int i = 0; i < BUCKET_COUNT; i++) {
+      if (counts[i] == 0) {
+        continue;
+      }
+      if (seen < rank_p50 && seen + counts[i] >= rank_p50) {
+        p50 = bucket_limit(i);
+      }
+      if (seen < rank_p99 && seen + counts[i] >= rank_p99) {
+        p99 = bucket_limit(i);
+      }
+      seen += counts[i];
+      max = bucket_limit(i);
+    }
+
+    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION,
+                 "latency %-7s n=%u p50 %u us, p99 %u us, max %u us", stage_names[stage], total,
+                 p50, p99, max);
+  }
+}
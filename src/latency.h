@@ -0,0 +1,55 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Per-stage latency histograms for the display pipeline, from the backend receiving the bytes of
+// a packet until the frame showing it is presented. Recording is lock-free and can be done from
+// any thread; a summary is logged periodically at debug level.
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+typedef enum {
+  LATENCY_STAGE_DECODE,  // bytes arrived -> frame decoded (SLIP / SysEx)
+  LATENCY_STAGE_QUEUE,   // pushed to the message queue -> popped by the main thread
+  LATENCY_STAGE_PROCESS, // popped -> process_command done
+  LATENCY_STAGE_PRESENT, // processed -> first SDL_RenderPresent afterwards
+  LATENCY_STAGE_TOTAL,   // bytes arrived -> presented
+  LATENCY_STAGE_COUNT
+} latency_stage_t;
+
+// Timestamps carried with every message through the queue
+typedef struct {
+  uint64_t arrival_ns; // bytes received by the backend
+  uint64_t pushed_ns;  // frame decoded and pushed to the queue
+  uint64_t popped_ns;  // taken from the queue by the main thread
+} latency_stamps_s;
+
+// Current timestamp in nanoseconds, used for all stage timestamps
+uint64_t latency_now(void);
+
+// Record the time spent in a stage
+void latency_record(latency_stage_t stage, uint64_t start_ns, uint64_t end_ns);
+
+// Record a processed message and remember it until the next present. Main thread only.
+void latency_message_processed(uint8_t command, const latency_stamps_s *stamps);
+
+// Close the present and total stages of the messages processed since the last present.
+// Main thread only.
+void latency_frame_presented(void);
+
+// Observers of the main thread events, used by the latency test
+typedef struct {
+  void (*message_processed)(uint8_t command, const latency_stamps_s *stamps,
+                            uint64_t processed_ns);
+  void (*frame_presented)(uint64_t presented_ns);
+} latency_hooks_s;
+
+// Install the hooks, or remove them with NULL. Main thread only.
+void latency_set_hooks(const latency_hooks_s *hooks);
+
+// Log percentiles of every stage recorded since the last call and reset the histograms
+void latency_log_summary(void);
+
+#endif // LATENCY_H_
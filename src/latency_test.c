@@ -0,0 +1,251 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "latency_test.h"
+#include "latency.h"
+#include "backends/m8.h"
+#include "backends/queue.h"
+#include "command.h"
+#include "input.h"
+#include "mux.h"
+#include "sdl_compat.h"
+
+#define WARMUP_MS 1000       // let the display reset settle before the first press
+#define PRESS_INTERVAL_MS 300 // gap between a completed sample and the next press
+#define PRESS_TIMEOUT_MS 1000 // give up on a press that was not answered with a draw
+
+extern message_queue_s queue; // defined by every backend
+
+typedef enum {
+  SEGMENT_WRITE,   // press sent -> write returned
+  SEGMENT_DEVICE,  // write returned -> first bytes of the answer arrived
+  SEGMENT_DECODE,  // bytes arrived -> frame decoded and queued
+  SEGMENT_PROCESS, // queued -> draw command processed
+  SEGMENT_PRESENT, // processed -> frame presented
+  SEGMENT_TOTAL,   // press sent -> frame presented
+  SEGMENT_COUNT
+} segment_t;
+
+static const char *segment_names[SEGMENT_COUNT] = {"write",   "device",  "decode",
+                                                   "process", "present", "total"};
+
+typedef enum { TEST_IDLE, TEST_WAITING, TEST_MATCHED, TEST_PRESENTED } test_state_t;
+
+static int running = 0;
+static int echo_delay_ms = -1;
+static int sample_target = 0;
+static int sample_count = 0;
+static int timeouts = 0;
+static uint32_t *samples[SEGMENT_COUNT]; // microseconds, sample_target entries per segment
+
+static test_state_t state = TEST_IDLE;
+static uint64_t next_press_ns = 0;
+static uint64_t press_ns = 0;
+static uint64_t written_ns = 0;
+static latency_stamps_s match_stamps;
+static uint64_t match_processed_ns = 0;
+static uint64_t match_presented_ns = 0;
+static int press_count = 0;
+
+// Stand-in device, answering every press with a rectangle after echo_delay_ms
+static SDL_Thread *echo_thread = NULL;
+static SDL_AtomicInt echo_stop;
+static SDL_AtomicInt echo_pending;
+static uint64_t echo_due_ns = 0;
+
+static void message_processed(const uint8_t command, const latency_stamps_s *stamps,
+                              const uint64_t processed_ns) {
+  // The first rectangle or character whose bytes arrived after the press was written
+  if (state != TEST_WAITING || stamps->arrival_ns < written_ns) {
+    return;
+  }
+  if (command == draw_rectangle_command || command == draw_character_command) {
+    match_stamps = *stamps;
+    match_processed_ns = processed_ns;
+    state = TEST_MATCHED;
+  }
+}
+
+static void frame_presented(const uint64_t presented_ns) {
+  if (state == TEST_MATCHED) {
+    match_presented_ns = presented_ns;
+    state = TEST_PRESENTED;
+  }
+}
+
+static const latency_hooks_s hooks = {message_processed, frame_presented};
+
+void latency_test_configure(const int samples_requested, const int echo_delay) {
+  sample_target = samples_requested > 0 ? samples_requested : 1;
+  echo_delay_ms = echo_delay;
+  for (int i = 0; i < SEGMENT_COUNT; i++) {
+    samples[i] = SDL_calloc(sample_target, sizeof(uint32_t));
+    if (samples[i] == NULL) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't allocate latency test samples");
+      latency_test_close();
+      return;
+    }
+  }
+  running = 1;
+  latency_set_hooks(&hooks);
+  next_press_ns = latency_now() + (uint64_t)WARMUP_MS * 1000000;
+  if (echo_delay_ms >= 0) {
+    SDL_Log("Latency test: %d samples against a stand-in device with %d ms delay", sample_target,
+            echo_delay_ms);
+  } else {
+    SDL_Log("Latency test: %d samples, keep the M8 sequencer stopped while measuring",
+            sample_target);
+  }
+}
+
+int latency_test_is_running(void) { return running; }
+
+int latency_test_is_echo(void) { return running && echo_delay_ms >= 0; }
+
+static int SDLCALL echo_loop(void *data) {
+  (void)data;
+  uint8_t color = 0;
+
+  while (!SDL_GetAtomicInt(&echo_stop)) {
+    if (SDL_GetAtomicInt(&echo_pending) && latency_now() >= echo_due_ns) {
+      // Rectangle with position, size and color, alternating the color so the frame changes
+      color ^= 0xFF;
+      const uint8_t packet[12] = {draw_rectangle_command, 0, 0, 0, 0, 16, 0, 16, 0, color, color,
+                                  color};
+      push_message_stamped(&queue, packet, sizeof(packet), latency_now());
+      SDL_SetAtomicInt(&echo_pending, 0);
+    } else {
+      SDL_Delay(1);
+    }
+  }
+  return 0;
+}
+
+int latency_test_start_echo(void) {
+  init_queue(&queue);
+  SDL_SetAtomicInt(&echo_pending, 0);
+  SDL_SetAtomicInt(&echo_stop, 0);
+  echo_thread = SDL_CreateThread(echo_loop, "m8c-echo", NULL);
+  if (echo_thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't start stand-in device: %s", SDL_GetError());
+    destroy_queue(&queue);
+    return 0;
+  }
+  return 1;
+}
+
+int latency_test_process_echo(void) {
+  const unsigned char *command;
+  size_t length = 0;
+  latency_stamps_s stamps;
+  while ((command = pop_message_stamped(&queue, &length, &stamps)) != NULL) {
+    if (length > 0) {
+      process_command(command, length);
+      latency_message_processed(command[0], &stamps);
+    }
+  }
+  return DEVICE_PROCESSING;
+}
+
+static void send_input(const uint8_t input) {
+  if (latency_test_is_echo()) {
+    if (input != 0) {
+      echo_due_ns = latency_now() + (uint64_t)echo_delay_ms * 1000000;
+      SDL_SetAtomicInt(&echo_pending, 1);
+    }
+  } else {
+    mux_send_msg_controller(input);
+  }
+}
+
+static void store(const segment_t segment, const uint64_t start_ns, const uint64_t end_ns) {
+  samples[segment][sample_count] =
+      end_ns > start_ns ? (uint32_t)SDL_min((end_ns - start_ns) / 1000, UINT32_MAX) : 0;
+}
+
+static void record_sample(void) {
+  store(SEGMENT_WRITE, press_ns, written_ns);
+  store(SEGMENT_DEVICE, written_ns, match_stamps.arrival_ns);
+  store(SEGMENT_DECODE, match_stamps.arrival_ns, match_stamps.pushed_ns);
+  store(SEGMENT_PROCESS, match_stamps.pushed_ns, match_processed_ns);
+  store(SEGMENT_PRESENT, match_processed_ns, match_presented_ns);
+  store(SEGMENT_TOTAL, press_ns, match_presented_ns);
+  sample_count++;
+}
+
+static int compare_samples(const void *a, const void *b) {
+  const uint32_t x = *(const uint32_t *)a;
+  const uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void log_report(void) {
+  SDL_Log("Latency test: %d samples, %d presses timed out", sample_count, timeouts);
+  if (sample_count == 0) {
+    return;
+  }
+  SDL_Log("%-8s %9s %9s %9s %9s", "segment", "min us", "p50 us", "p95 us", "max us");
+  for (int i = 0; i < SEGMENT_COUNT; i++) {
+    uint32_t *values = samples[i];
+    SDL_qsort(values, sample_count, sizeof(uint32_t), compare_samples);
+    SDL_Log("%-8s %9u %9u %9u %9u", segment_names[i], values[0],
+            values[(sample_count - 1) * 50 / 100], values[(sample_count - 1) * 95 / 100],
+            values[sample_count - 1]);
+  }
+}
+
+int latency_test_tick(void) {
+  const uint64_t now = latency_now();
+
+  switch (state) {
+  case TEST_IDLE:
+    if (now >= next_press_ns) {
+      // Alternate between down and up so the cursor returns to where it started
+      const uint8_t key = press_count++ % 2 == 0 ? key_down : key_up;
+      press_ns = latency_now();
+      send_input(key);
+      written_ns = latency_now();
+      state = TEST_WAITING;
+    }
+    break;
+
+  case TEST_WAITING:
+  case TEST_MATCHED:
+    if (now - press_ns > (uint64_t)PRESS_TIMEOUT_MS * 1000000) {
+      timeouts++;
+      send_input(0);
+      next_press_ns = now + (uint64_t)PRESS_INTERVAL_MS * 1000000;
+      state = TEST_IDLE;
+    }
+    break;
+
+  case TEST_PRESENTED:
+    record_sample();
+    send_input(0);
+    next_press_ns = now + (uint64_t)PRESS_INTERVAL_MS * 1000000;
+    state = TEST_IDLE;
+    break;
+  }
+
+  if (sample_count >= sample_target || timeouts >= sample_target) {
+    log_report();
+    latency_test_close();
+    return 0;
+  }
+  return 1;
+}
+
+void latency_test_close(void) {
+  if (echo_thread != NULL) {
+    SDL_SetAtomicInt(&echo_stop, 1);
+    SDL_WaitThread(echo_thread, NULL);
+    echo_thread = NULL;
+    destroy_queue(&queue);
+  }
+  for (int i = 0; i < SEGMENT_COUNT; i++) {
+    SDL_free(samples[i]);
+    samples[i] = NULL;
+  }
+  latency_set_hooks(NULL);
+  running = 0;
+}
@@ -0,0 +1,39 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Input-to-photon latency test. Sends controller presses to the M8, waits for the first draw
+// command that follows each press and reports how long it took until the frame showing it was
+// presented, split into write, device, decode, process and present segments. Instead of a real
+// M8 a stand-in that echoes a draw after a fixed delay can be used to measure m8c alone.
+
+#ifndef LATENCY_TEST_H_
+#define LATENCY_TEST_H_
+
+#include <stdint.h>
+
+/**
+ * Enable the latency test, called while parsing the command line.
+ *
+ * @param samples Number of presses to measure before the report is logged and m8c exits.
+ * @param echo_delay_ms Delay of the stand-in device in milliseconds, or -1 to use the real M8.
+ */
+void latency_test_configure(int samples, int echo_delay_ms);
+
+int latency_test_is_running(void);
+
+// Whether the stand-in device replaces the M8
+int latency_test_is_echo(void);
+
+// Start the stand-in device. Returns 1 on success, 0 on failure.
+int latency_test_start_echo(void);
+
+// Process the messages of the stand-in device, the counterpart of m8_process_data()
+int latency_test_process_echo(void);
+
+// Drive the test from the main loop. Returns 0 once every sample has been taken.
+int latency_test_tick(void);
+
+// Stop the stand-in device and release the samples
+void latency_test_close(void);
+
+#endif // LATENCY_TEST_H_
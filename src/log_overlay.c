@@ -6,115 +6,186 @@
 #include "sdl_compat.h"
 
 #include "SDL2_inprint.h"
+#include "alloc_stats.h"
 #include "fonts/fonts.h"
+#include "log_ring.h"
 
-#define LOG_BUFFER_MAX_LINES 512
 #define LOG_LINE_MAX_CHARS 256
 
+// Two textures of the same size: new rows are drawn below the rows kept from the front texture
+// into the back one, then they are swapped
 static SDL_Texture *overlay_texture = NULL;
+static SDL_Texture *back_texture = NULL;
 static int overlay_visible = 0;
 static int overlay_needs_redraw = 0;
 
-static char log_lines[LOG_BUFFER_MAX_LINES][LOG_LINE_MAX_CHARS];
-static int log_line_start = 0;
-static int log_line_count = 0;
+static unsigned int rendered_generation = 0;
+static int rows_drawn = 0; // wrapped rows currently on the overlay texture
 
-static SDL_LogOutputFunction prev_log_output_fn = NULL;
-static void *prev_log_output_userdata = NULL;
-static SDL_Mutex *log_mutex = NULL; // Mutex for protecting log buffer
+typedef struct {
+  int width;
+  int line_height;
+  int margin_x;
+  int margin_y;
+  int cols;
+  int max_rows;
+} overlay_layout_s;
 
-static void log_buffer_append_line(const char *line) {
-  if (line[0] == '\0') {
-    return;
+void log_overlay_init(void) { log_ring_init(); }
+
+void log_overlay_toggle(void) {
+  overlay_visible = !overlay_visible;
+  overlay_needs_redraw = 1;
+}
+
+int log_overlay_is_visible(void) { return overlay_visible; }
+
+static void destroy_textures(void) {
+  if (overlay_texture != NULL) {
+    SDL_DestroyTexture(overlay_texture);
+    overlay_texture = NULL;
   }
-  // Protect buffer updates (can be called from non-main threads)
-  if (log_mutex)
-    SDL_LockMutex(log_mutex);
-  const int index = (log_line_start + log_line_count) % LOG_BUFFER_MAX_LINES;
-  SDL_strlcpy(log_lines[index], line, LOG_LINE_MAX_CHARS);
-  if (log_line_count < LOG_BUFFER_MAX_LINES) {
-    log_line_count++;
-  } else {
-    log_line_start = (log_line_start + 1) % LOG_BUFFER_MAX_LINES;
+  if (back_texture != NULL) {
+    SDL_DestroyTexture(back_texture);
+    back_texture = NULL;
   }
+}
+
+void log_overlay_invalidate(void) {
+  destroy_textures();
   overlay_needs_redraw = 1;
-  if (log_mutex)
-    SDL_UnlockMutex(log_mutex);
 }
 
-static void sdl_log_capture(void *userdata, int category, SDL_LogPriority priority,
-                            const char *message) {
-  // Suppress unused variable warnings
-  (void)userdata;
-  (void)category;
-  (void)priority;
-
-#ifdef USE_SDL2
-  // Filter out SDL's internal app metadata messages (shown by sdl2-compat)
-  // These show misleading default values since SDL2 doesn't have SDL_SetAppMetadata
-  if (message) {
-    if (SDL_strncmp(message, "App name:", 9) == 0 ||
-        SDL_strncmp(message, "App version:", 12) == 0 ||
-        SDL_strncmp(message, "App ID:", 7) == 0 ||
-        SDL_strncmp(message, "SDL revision:", 13) == 0) {
-      return; // Suppress these messages
-    }
+void log_overlay_destroy(void) {
+  destroy_textures();
+  overlay_needs_redraw = 1;
+}
+
+static SDL_Texture *create_overlay_texture(SDL_Renderer *renderer, const int width,
+                                           const int height, const SDL_ScaleMode scale_mode) {
+  SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_TARGET, width, height);
+  if (texture == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't create log texture: %s", SDL_GetError());
+    return NULL;
   }
-#endif
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  SDL_SetTextureScaleMode(texture, scale_mode);
+  return texture;
+}
 
-  char formatted[LOG_LINE_MAX_CHARS];
-  SDL_snprintf(formatted, sizeof(formatted), ">%s", message ? message : "");
-  log_buffer_append_line(formatted);
+// Format a history record as an overlay line and return its length
+static size_t format_line(const int index, char *buffer) {
+  buffer[0] = '>';
+  log_ring_history_format(index, buffer + 1, LOG_LINE_MAX_CHARS - 1);
+  return SDL_strlen(buffer);
+}
 
-  if (prev_log_output_fn != NULL) {
-    prev_log_output_fn(prev_log_output_userdata, category, priority, message);
-  }
+// How many wrapped rows a line consumes
+static int line_rows(const size_t length, const int cols) {
+  return SDL_max(1, (int)((length + cols - 1) / cols));
 }
 
-void log_overlay_init(void) {
-  // Create synchronization primitive before hooking log output
-  if (!log_mutex) {
-    log_mutex = SDL_CreateMutex();
-    if (!log_mutex) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create log mutex: %s", SDL_GetError());
-    }
+// Draw a line from a character offset in chunks of `cols` characters, advancing y by one row
+// per chunk
+static void draw_line(SDL_Renderer *renderer, const overlay_layout_s *layout, const char *line,
+                      const size_t length, size_t offset, int *y) {
+  const Uint32 fg = 0xFFFFFF; // draw text in white
+  for (; offset < length; offset += (size_t)layout->cols) {
+    char row[LOG_LINE_MAX_CHARS];
+    const size_t take = SDL_min((size_t)layout->cols, length - offset);
+    SDL_memcpy(row, line + offset, take);
+    row[take] = '\0';
+    inprint(renderer, row, layout->margin_x, *y, fg, fg);
+    *y += layout->line_height;
   }
-  SDL_GetLogOutputFunction(&prev_log_output_fn, &prev_log_output_userdata);
-  SDL_SetLogOutputFunction(sdl_log_capture, NULL);
 }
 
-void log_overlay_toggle(void) {
-  overlay_visible = !overlay_visible;
-  overlay_needs_redraw = 1;
+static void clear_overlay(SDL_Renderer *renderer) {
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 220);
+  SDL_RenderClear(renderer);
 }
 
-int log_overlay_is_visible(void) { return overlay_visible; }
+// Lay out the whole history so that its newest rows fill the overlay
+static void redraw_all(SDL_Renderer *renderer, const overlay_layout_s *layout) {
+  SDL_SetRenderTarget(renderer, overlay_texture);
+  clear_overlay(renderer);
+
+  // Walk backwards over the history to find which line (and intra-line character offset)
+  // should be the first visible row, so that the last max_rows rows are visible
+  char line[LOG_LINE_MAX_CHARS];
+  const int count = log_ring_history_count();
+  int rows_needed = layout->max_rows;
+  int start_idx = count;
+  size_t start_char_offset = 0;
+  for (int n = count - 1; n >= 0 && rows_needed > 0; n--) {
+    const size_t length = format_line(n, line);
+    const int rows_for_line = line_rows(length, layout->cols);
+    start_idx = n;
+    if (rows_for_line >= rows_needed) {
+      // Only draw the last rows_needed rows of this line
+      start_char_offset = (size_t)SDL_max(0, (int)length - rows_needed * layout->cols);
+      rows_needed = 0;
+      break;
+    }
+    rows_needed -= rows_for_line;
+  }
 
-void log_overlay_invalidate(void) {
-  if (overlay_texture != NULL) {
-    SDL_DestroyTexture(overlay_texture);
-    overlay_texture = NULL;
+  int y = layout->margin_y;
+  for (int n = start_idx; n < count; n++) {
+    const size_t length = format_line(n, line);
+    draw_line(renderer, layout, line, length, n == start_idx ? start_char_offset : 0, &y);
   }
-  overlay_needs_redraw = 1;
+  rows_drawn = layout->max_rows - rows_needed;
 }
 
-void log_overlay_destroy(void) {
-  // Restore previous log output function
-  if (prev_log_output_fn) {
-    SDL_SetLogOutputFunction(prev_log_output_fn, prev_log_output_userdata);
-    prev_log_output_fn = NULL;
-    prev_log_output_userdata = NULL;
+// Draw only the records added since the last update, scrolling the rows already drawn up when
+// the overlay is full. Returns 0 when a full redraw is needed instead.
+static int draw_new_lines(SDL_Renderer *renderer, const overlay_layout_s *layout,
+                          const unsigned int new_records) {
+  const int count = log_ring_history_count();
+  if (new_records > (unsigned int)count) {
+    return 0;
   }
-  if (overlay_texture != NULL) {
-    SDL_DestroyTexture(overlay_texture);
-    overlay_texture = NULL;
+  const int first = count - (int)new_records;
+
+  char line[LOG_LINE_MAX_CHARS];
+  int new_rows = 0;
+  for (int n = first; n < count && new_rows < layout->max_rows; n++) {
+    new_rows += line_rows(format_line(n, line), layout->cols);
   }
-  // Destroy synchronization primitive
-  if (log_mutex) {
-    SDL_DestroyMutex(log_mutex);
-    log_mutex = NULL;
+  if (new_rows >= layout->max_rows) {
+    return 0;
   }
-  overlay_needs_redraw = 1;
+
+  const int scroll_rows = SDL_max(0, rows_drawn + new_rows - layout->max_rows);
+  if (scroll_rows > 0) {
+    // Copy the rows that stay visible to the top of the back texture, replacing its pixels
+    const int kept_rows = rows_drawn - scroll_rows;
+    SDL_SetRenderTarget(renderer, back_texture);
+    clear_overlay(renderer);
+    const SDL_FRect src = {0, (float)(layout->margin_y + scroll_rows * layout->line_height),
+                           (float)layout->width, (float)(kept_rows * layout->line_height)};
+    const SDL_FRect dst = {0, (float)layout->margin_y, src.w, src.h};
+    SDL_SetTextureBlendMode(overlay_texture, SDL_BLENDMODE_NONE);
+    SDL_RenderTexture(renderer, overlay_texture, &src, &dst);
+    SDL_SetTextureBlendMode(overlay_texture, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture *swap = overlay_texture;
+    overlay_texture = back_texture;
+    back_texture = swap;
+    rows_drawn = kept_rows;
+  } else {
+    SDL_SetRenderTarget(renderer, overlay_texture);
+  }
+
+  int y = layout->margin_y + rows_drawn * layout->line_height;
+  for (int n = first; n < count; n++) {
+    const size_t length = format_line(n, line);
+    draw_line(renderer, layout, line, length, 0, &y);
+  }
+  rows_drawn += new_rows;
+  return 1;
 }
 
 void log_overlay_render(SDL_Renderer *renderer, int logical_texture_width,
@@ -123,163 +194,63 @@ void log_overlay_render(SDL_Renderer *renderer, int logical_texture_width,
   if (!overlay_visible) {
     return;
   }
-  if (overlay_texture == NULL) {
-    overlay_texture =
-        SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
-                          logical_texture_width, logical_texture_height);
-    if (overlay_texture == NULL) {
-      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't create log texture: %s", SDL_GetError());
+  if (overlay_texture == NULL || back_texture == NULL) {
+    destroy_textures();
+    overlay_texture = create_overlay_texture(renderer, logical_texture_width,
+                                             logical_texture_height, scale_mode);
+    back_texture = create_overlay_texture(renderer, logical_texture_width, logical_texture_height,
+                                          scale_mode);
+    if (overlay_texture == NULL || back_texture == NULL) {
+      destroy_textures();
       return;
     }
-    SDL_SetTextureBlendMode(overlay_texture, SDL_BLENDMODE_BLEND);
-    SDL_SetTextureScaleMode(overlay_texture, scale_mode);
+    overlay_needs_redraw = 1;
   }
 
-  // Only update the overlay texture when its contents changed.
-  if (overlay_needs_redraw) {
-    overlay_needs_redraw = 0;
-
-    // Take a snapshot of the log ring buffer so we can render without holding the mutex.
-    // This prevents data races and avoids deadlocks if rendering logs internally.
-    int local_count = 0;
-    int local_start = 0;
-    if (log_mutex)
-      SDL_LockMutex(log_mutex);
-    local_count = log_line_count;
-    local_start = log_line_start;
-
-    // Snapshot holds copies of each visible line in chronological order.
-    char(*snapshot)[LOG_LINE_MAX_CHARS] = NULL;
-    if (local_count > 0) {
-      snapshot = (char(*)[LOG_LINE_MAX_CHARS])SDL_calloc((size_t)local_count, sizeof(log_lines[0]));
-    }
-    if (snapshot) {
-      for (int i = 0; i < local_count; i++) {
-        const int idx = (local_start + i) % LOG_BUFFER_MAX_LINES;
-        SDL_strlcpy(snapshot[i], log_lines[idx], LOG_LINE_MAX_CHARS);
-      }
+  // Only update the overlay texture when its contents changed. The log history is formatted
+  // here, so messages are only formatted while the overlay is shown.
+  const unsigned int generation = log_ring_generation();
+  if (overlay_needs_redraw || rendered_generation != generation) {
+    const struct inline_font *font_small = fonts_get(0);
+    if (font_small == NULL) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "fonts_get(0) returned NULL");
+      return;
     }
-    if (log_mutex)
-      SDL_UnlockMutex(log_mutex);
-
-    // Bind the overlay texture as the render target and clear it with a translucent background.
+    const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_LOG_OVERLAY);
     SDL_Texture *prev_target = SDL_GetRenderTarget(renderer);
-    if (!SDL_SetRenderTarget(renderer, overlay_texture)) {
-      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to set render target: %s", SDL_GetError());
-    }
-
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 220);
-    SDL_RenderClear(renderer);
 
-    // Switch to a small font for the overlay; remember previous mode to restore later.
-    const int prev_font_mode = font_mode_current;
-    inline_font_close();
-    const struct inline_font *font_small = fonts_get(0);
-    if (font_small) {
-      inline_font_initialize(font_small);
-
-      // Layout calculations:
-      // - glyph_x/y = character cell size in pixels.
-      // - margin_x/y = inner padding around the overlay.
-      // - cols = how many characters fit per line (accounting for a 1px inter-glyph gap).
-      const int line_height = font_small->glyph_y + 1;
-      const int margin_x = 2;
-      const int margin_y = 1;
-      const int usable_width = logical_texture_width - (margin_x * 2);
-      const int cols = SDL_max(1, usable_width / (font_small->glyph_x + 1));
-
-      // Determine how many text rows fit on the screen vertically.
-      const int max_rows = (logical_texture_height - margin_y * 2) / line_height;
-
-      // We want to show the newest content; walk backwards over the snapshot to find
-      // which line (and intra-line character offset) should be the first visible row,
-      // so that the last max_rows rows are visible.
-      int rows_needed = max_rows;
-      int start_idx = 0;            // index in snapshot[] to start drawing from
-      size_t start_char_offset = 0; // per-line character offset (for wrapped lines)
-
-      if (local_count > 0) {
-        for (int n = local_count - 1; n >= 0 && rows_needed > 0; n--) {
-          if (!snapshot) break; // nullptr safety
-          const size_t len = SDL_strlen(snapshot[n]);
-          // How many wrapped rows this line consumes
-          const int rows_for_line = SDL_max(1, (int)((len + cols - 1) / cols));
-          if (rows_for_line >= rows_needed) {
-            // This line provides the first visible portion.
-            // Compute which character to start from so we only draw the last rows_needed rows.
-            const int offset = SDL_max(0, (int)len - rows_needed * cols);
-            start_idx = n;
-            start_char_offset = (size_t)offset;
-            break;
-          }
-          // Not enough rows on this line, include it fully and continue upwards.
-          rows_needed -= rows_for_line;
-          start_idx = n;
-          start_char_offset = 0;
-        }
-      }
-
-      // Render loop:
-      // - Iterate from start_idx to the newest item (end of snapshot).
-      // - For each line, draw it in chunks of `cols` characters (word-wrap by fixed width).
-      // - Stop when we run out of vertical space.
-      if (local_count > 0) {
-        int y = margin_y;
-        size_t offset = start_char_offset;
-
-        for (int cur = start_idx; cur < local_count && y < logical_texture_height; cur++) {
-          if (!snapshot || cur < 0 || cur >= local_count) {
-            break;
-          }
-
-          const char *s = snapshot[cur];
-          const size_t len = SDL_strlen(s);
-
-          for (size_t pos = offset; pos < len && y < logical_texture_height;) {
-            const Uint32 fg = 0xFFFFFF; // draw text in white
-            const size_t remaining = len - pos;
-
-            // Take up to `cols` characters for this visual row
-            size_t take = (size_t)cols < remaining ? (size_t)cols : remaining;
-
-            // Copy the slice into a temporary buffer for printing
-            char buf[LOG_LINE_MAX_CHARS];
-            if (take >= sizeof(buf)) {
-              take = sizeof(buf) - 1;
-            }
-            SDL_memcpy(buf, s + pos, take);
-            buf[take] = '\0';
-
-            // Draw the row and advance one line vertically
-            inprint(renderer, buf, margin_x, y, fg, fg);
-            y += line_height;
-            pos += take;
-          }
-
-          // After the first (possibly partial) slice of this line, subsequent lines start at 0
-          offset = 0;
-        }
-      }
-    } else {
-      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "fonts_get(0) returned NULL");
+    // Layout calculations:
+    // - glyph_x/y = character cell size in pixels.
+    // - margin_x/y = inner padding around the overlay.
+    // - cols = how many characters fit per line (accounting for a 1px inter-glyph gap).
+    overlay_layout_s layout;
+    layout.width = logical_texture_width;
+    layout.line_height = font_small->glyph_y + 1;
+    layout.margin_x = 2;
+    layout.margin_y = 1;
+    layout.cols = SDL_max(1, SDL_min(LOG_LINE_MAX_CHARS - 1,
+                                     (logical_texture_width - layout.margin_x * 2) /
+                                         (font_small->glyph_x + 1)));
+    layout.max_rows = (logical_texture_height - layout.margin_y * 2) / layout.line_height;
+
+    // Switch to the small font, its texture stays resident between redraws
+    inline_font_initialize(font_small);
+    if (overlay_needs_redraw ||
+        !draw_new_lines(renderer, &layout, generation - rendered_generation)) {
+      redraw_all(renderer, &layout);
     }
+    overlay_needs_redraw = 0;
+    rendered_generation = generation;
 
     // Restore previous font mode and previous render target.
-    inline_font_close();
-    inline_font_initialize(fonts_get(prev_font_mode));
+    inline_font_initialize(fonts_get(font_mode_current));
     SDL_SetRenderTarget(renderer, prev_target);
-
-    // Free the snapshot after rendering.
-    if (snapshot) {
-      SDL_free(snapshot);
-    }
+    alloc_stats_pop_tag(previous_tag);
   }
 
   // Composite the overlay texture to the current render target every frame while visible.
-  if (overlay_texture) {
-    if (!SDL_RenderTexture(renderer, overlay_texture, NULL, NULL)) {
-      SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't render log overlay texture: %s",
-                      SDL_GetError());
-    }
+  if (!SDL_RenderTexture(renderer, overlay_texture, NULL, NULL)) {
+    SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't render log overlay texture: %s",
+                    SDL_GetError());
   }
 }
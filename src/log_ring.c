@@ -0,0 +1,657 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "log_ring.h"
+#include <stdarg.h>
+#include <stdint.h>
+
+#define LOG_MAX_THREADS 32       // threads alive at once, others share a ring guarded by a mutex
+#define LOG_RING_RECORDS 256     // per thread, records are dropped when the main loop stalls
+#define LOG_HISTORY_RECORDS 512  // kept for the overlay
+#define LOG_FILE_RECORDS 1024    // waiting for the log file writer
+#define LOG_PAYLOAD_SIZE 232     // arguments or message text, keeps records at 256 bytes
+#define LOG_LINE_LENGTH 512
+#define LOG_FILE_INTERVAL_MS 100
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define LOG_THREAD_LOCAL __declspec(thread)
+#else
+#define LOG_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct {
+  uint64_t time_ns;
+  const char *format; // NULL when the payload holds a message already formatted by SDL
+  uint16_t length;
+  uint8_t category;
+  uint8_t priority;
+  uint8_t payload[LOG_PAYLOAD_SIZE];
+} log_record_s;
+
+// Single consumer ring of records, single producer except for the shared ring
+typedef struct {
+  log_record_s records[LOG_RING_RECORDS];
+  SDL_AtomicInt written;
+  SDL_AtomicInt read;
+} log_ring_s;
+
+// A slot's ring is kept when its thread exits and reused by the next thread once it is drained
+typedef enum { SLOT_FREE, SLOT_OWNED, SLOT_RELEASED } slot_state_t;
+
+typedef enum {
+  LEN_NONE,
+  LEN_HH,
+  LEN_H,
+  LEN_L,
+  LEN_LL,
+  LEN_Z,
+  LEN_J,
+  LEN_T,
+  LEN_LONG_DOUBLE
+} length_t;
+
+typedef struct {
+  int width_star;
+  int precision_star;
+  length_t length;
+  char conversion;
+} conversion_spec_s;
+
+static void *rings[LOG_MAX_THREADS]; // log_ring_s, published with SDL_SetAtomicPointer
+static SDL_AtomicInt slot_states[LOG_MAX_THREADS];
+static SDL_TLSID slot_tls;
+static log_ring_s shared_ring;
+static SDL_Mutex *shared_mutex = NULL;
+static SDL_AtomicInt dropped_records;
+static LOG_THREAD_LOCAL log_ring_s *thread_ring = NULL;
+
+static SDL_LogOutputFunction prev_log_output_fn = NULL;
+static void *prev_log_output_userdata = NULL;
+static int capturing = 0;
+static uint64_t origin_ns = 0;
+
+// Only touched from the main thread
+static log_record_s history[LOG_HISTORY_RECORDS];
+static int history_start = 0;
+static int history_count = 0;
+static unsigned int generation = 0;
+
+// Main thread produces, the writer thread consumes
+static log_record_s file_records[LOG_FILE_RECORDS];
+static SDL_AtomicInt file_written;
+static SDL_AtomicInt file_read;
+static SDL_IOStream *log_file = NULL;
+static SDL_Thread *file_thread = NULL;
+static SDL_AtomicInt file_stop;
+
+static const char *parse_spec(const char *p, conversion_spec_s *spec) {
+  SDL_zerop(spec);
+  while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+    p++;
+  }
+  if (*p == '*') {
+    spec->width_star = 1;
+    p++;
+  }
+  while (*p >= '0' && *p <= '9') {
+    p++;
+  }
+  if (*p == '.') {
+    p++;
+    if (*p == '*') {
+      spec->precision_star = 1;
+      p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+      p++;
+    }
+  }
+  switch (*p) {
+  case 'h':
+    spec->length = p[1] == 'h' ? LEN_HH : LEN_H;
+    p += p[1] == 'h' ? 2 : 1;
+    break;
+  case 'l':
+    spec->length = p[1] == 'l' ? LEN_LL : LEN_L;
+    p += p[1] == 'l' ? 2 : 1;
+    break;
+  case 'z':
+    spec->length = LEN_Z;
+    p++;
+    break;
+  case 'j':
+    spec->length = LEN_J;
+    p++;
+    break;
+  case 't':
+    spec->length = LEN_T;
+    p++;
+    break;
+  case 'L':
+    spec->length = LEN_LONG_DOUBLE;
+    p++;
+    break;
+  default:
+    break;
+  }
+  spec->conversion = *p;
+  return *p != '\0' ? p + 1 : p;
+}
+
+static int is_signed_conversion(const char c) { return c == 'd' || c == 'i' || c == 'c'; }
+
+static int is_unsigned_conversion(const char c) {
+  return c == 'u' || c == 'x' || c == 'X' || c == 'o';
+}
+
+static int is_float_conversion(const char c) {
+  return c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G' || c == 'a' ||
+         c == 'A';
+}
+
+static int store_value(log_record_s *record, const void *value, const size_t size) {
+  if (record->length + size > LOG_PAYLOAD_SIZE) {
+    return 0;
+  }
+  SDL_memcpy(record->payload + record->length, value, size);
+  record->length += (uint16_t)size;
+  return 1;
+}
+
+// Copy the arguments described by the format into the payload, 8 bytes per number and strings
+// with their terminator. Capturing stops when the payload is full.
+static void capture_args(log_record_s *record, const char *format, va_list ap) {
+  for (const char *p = format; *p != '\0';) {
+    if (*p++ != '%') {
+      continue;
+    }
+    if (*p == '%') {
+      p++;
+      continue;
+    }
+    conversion_spec_s spec;
+    p = parse_spec(p, &spec);
+    int64_t number;
+    if (spec.width_star) {
+      number = va_arg(ap, int);
+      if (!store_value(record, &number, sizeof(number))) {
+        return;
+      }
+    }
+    if (spec.precision_star) {
+      number = va_arg(ap, int);
+      if (!store_value(record, &number, sizeof(number))) {
+        return;
+      }
+    }
+
+    if (is_signed_conversion(spec.conversion) || is_unsigned_conversion(spec.conversion)) {
+      switch (spec.length) {
+      case LEN_L:
+        number = (int64_t)va_arg(ap, long);
+        break;
+      case LEN_LL:
+        number = (int64_t)va_arg(ap, long long);
+        break;
+      case LEN_Z:
+        number = (int64_t)va_arg(ap, size_t);
+        break;
+      case LEN_J:
+        number = (int64_t)va_arg(ap, intmax_t);
+        break;
+      case LEN_T:
+        number = (int64_t)va_arg(ap, ptrdiff_t);
+        break;
+      default:
+        number = va_arg(ap, int);
+        break;
+      }
+      if (!store_value(record, &number, sizeof(number))) {
+        return;
+      }
+    } else if (is_float_conversion(spec.conversion)) {
+      const double value =
+          spec.length == LEN_LONG_DOUBLE ? (double)va_arg(ap, long double) : va_arg(ap, double);
+      if (!store_value(record, &value, sizeof(value))) {
+        return;
+      }
+    } else if (spec.conversion == 'p') {
+      const uint64_t value = (uintptr_t)va_arg(ap, void *);
+      if (!store_value(record, &value, sizeof(value))) {
+        return;
+      }
+    } else if (spec.conversion == 's') {
+      const char *string = va_arg(ap, const char *);
+      if (string == NULL) {
+        string = "(null)";
+      }
+      const size_t space = LOG_PAYLOAD_SIZE - record->length;
+      if (space == 0) {
+        return;
+      }
+      const size_t length = SDL_min(SDL_strlen(string), space - 1);
+      SDL_memcpy(record->payload + record->length, string, length);
+      record->payload[record->length + length] = '\0';
+      record->length += (uint16_t)(length + 1);
+    } else {
+      return; // %n and unknown conversions end the capture
+    }
+  }
+}
+
+static int load_value(const log_record_s *record, size_t *offset, void *value, const size_t size) {
+  if (*offset + size > record->length) {
+    return 0;
+  }
+  SDL_memcpy(value, record->payload + *offset, size);
+  *offset += size;
+  return 1;
+}
+
+// Rebuilds the message from the format and the captured arguments, one conversion at a time
+static void format_record(const log_record_s *record, char *buffer, const size_t size) {
+  if (record->format == NULL) {
+    SDL_strlcpy(buffer, (const char *)record->payload, SDL_min(size, (size_t)record->length + 1));
+    return;
+  }
+
+  size_t position = 0;
+  size_t offset = 0;
+  const char *p = record->format;
+  while (*p != '\0' && position + 1 < size) {
+    if (*p != '%') {
+      buffer[position++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      buffer[position++] = '%';
+      p += 2;
+      continue;
+    }
+
+    conversion_spec_s spec;
+    const char *spec_start = p;
+    p = parse_spec(p + 1, &spec);
+
+    // Copy the conversion, replacing * with the captured width and precision and dropping the
+    // long double modifier as the value was stored as a double
+    char conversion[48];
+    size_t length = 0;
+    for (const char *c = spec_start; c < p && length + 12 < sizeof(conversion); c++) {
+      if (*c == '*') {
+        int64_t value;
+        if (!load_value(record, &offset, &value, sizeof(value))) {
+          buffer[position] = '\0';
+          return;
+        }
+        length += (size_t)SDL_snprintf(conversion + length, sizeof(conversion) - length, "%d",
+                                       (int)value);
+      } else if (*c != 'L') {
+        conversion[length++] = *c;
+      }
+    }
+    conversion[length] = '\0';
+
+    int written = 0;
+    char *out = buffer + position;
+    const size_t remaining = size - position;
+    if (is_signed_conversion(spec.conversion) || is_unsigned_conversion(spec.conversion)) {
+      int64_t value;
+      if (!load_value(record, &offset, &value, sizeof(value))) {
+        break;
+      }
+      switch (spec.length) {
+      case LEN_L:
+        written = SDL_snprintf(out, remaining, conversion, (long)value);
+        break;
+      case LEN_LL:
+        written = SDL_snprintf(out, remaining, conversion, (long long)value);
+        break;
+      case LEN_Z:
+        written = SDL_snprintf(out, remaining, conversion, (size_t)value);
+        break;
+      case LEN_J:
+        written = SDL_snprintf(out, remaining, conversion, (intmax_t)value);
+        break;
+      case LEN_T:
+        written = SDL_snprintf(out, remaining, conversion, (ptrdiff_t)value);
+        break;
+      default:
+        written = SDL_snprintf(out, remaining, conversion, (int)value);
+        break;
+      }
+    } else if (is_float_conversion(spec.conversion)) {
+      double value;
+      if (!load_value(record, &offset, &value, sizeof(value))) {
+        break;
+      }
+      written = SDL_snprintf(out, remaining, conversion, value);
+    } else if (spec.conversion == 'p') {
+      uint64_t value;
+      if (!load_value(record, &offset, &value, sizeof(value))) {
+        break;
+      }
+      written = SDL_snprintf(out, remaining, conversion, (void *)(uintptr_t)value);
+    } else if (spec.conversion == 's') {
+      if (offset >= record->length) {
+        break;
+      }
+      const char *string = (const char *)record->payload + offset;
+      offset += SDL_strlen(string) + 1;
+      written = SDL_snprintf(out, remaining, conversion, string);
+    } else {
+      break;
+    }
+    if (written > 0) {
+      position = SDL_min(size - 1, position + (size_t)written);
+    }
+  }
+  buffer[position] = '\0';
+}
+
+// Thread local storage destructor, the pump frees the slot once its records are consumed
+static void SDLCALL release_slot(void *state) { SDL_SetAtomicInt(state, SLOT_RELEASED); }
+
+static log_ring_s *get_thread_ring(void) {
+  if (thread_ring != NULL) {
+    return thread_ring;
+  }
+  thread_ring = &shared_ring; // also covers anything logged while the slot is set up
+  for (int slot = 0; slot < LOG_MAX_THREADS; slot++) {
+    if (!SDL_CompareAndSwapAtomicInt(&slot_states[slot], SLOT_FREE, SLOT_OWNED)) {
+      continue;
+    }
+    log_ring_s *ring = SDL_GetAtomicPointer(&rings[slot]);
+    if (ring == NULL) {
+      ring = SDL_calloc(1, sizeof(log_ring_s));
+      if (ring == NULL) {
+        SDL_SetAtomicInt(&slot_states[slot], SLOT_FREE);
+        break;
+      }
+      SDL_SetAtomicPointer(&rings[slot], ring);
+    }
+    SDL_SetTLS(&slot_tls, &slot_states[slot], release_slot);
+    thread_ring = ring;
+    break;
+  }
+  return thread_ring;
+}
+
+// Reserve the next record of the calling thread's ring, NULL if it is full
+static log_record_s *begin_record(log_ring_s **ring_out) {
+  log_ring_s *ring = get_thread_ring();
+  if (ring == &shared_ring) {
+    SDL_LockMutex(shared_mutex);
+  }
+  const uint32_t written = (uint32_t)SDL_GetAtomicInt(&ring->written);
+  if (written - (uint32_t)SDL_GetAtomicInt(&ring->read) >= LOG_RING_RECORDS) {
+    if (ring == &shared_ring) {
+      SDL_UnlockMutex(shared_mutex);
+    }
+    SDL_AddAtomicInt(&dropped_records, 1);
+    return NULL;
+  }
+  *ring_out = ring;
+  return &ring->records[written % LOG_RING_RECORDS];
+}
+
+static void commit_record(log_ring_s *ring) {
+  SDL_AddAtomicInt(&ring->written, 1);
+  if (ring == &shared_ring) {
+    SDL_UnlockMutex(shared_mutex);
+  }
+}
+
+void log_async(const int category, const SDL_LogPriority priority, const char *format, ...) {
+  if (priority < SDL_GetLogPriority(category)) {
+    return;
+  }
+  log_ring_s *ring;
+  log_record_s *record = begin_record(&ring);
+  if (record == NULL) {
+    return;
+  }
+  record->time_ns = SDL_GetTicksNS();
+  record->format = format;
+  record->length = 0;
+  record->category = (uint8_t)category;
+  record->priority = (uint8_t)priority;
+  va_list ap;
+  va_start(ap, format);
+  capture_args(record, format, ap);
+  va_end(ap);
+  commit_record(ring);
+}
+
+static void post_message(const int category, const SDL_LogPriority priority,
+                         const char *message) {
+  log_ring_s *ring;
+  log_record_s *record = begin_record(&ring);
+  if (record == NULL) {
+    return;
+  }
+  const size_t length = SDL_min(SDL_strlen(message), (size_t)LOG_PAYLOAD_SIZE - 1);
+  record->time_ns = SDL_GetTicksNS();
+  record->format = NULL;
+  record->length = (uint16_t)length;
+  record->category = (uint8_t)category;
+  record->priority = (uint8_t)priority;
+  SDL_memcpy(record->payload, message, length);
+  record->payload[length] = '\0';
+  commit_record(ring);
+}
+
+static void SDLCALL sdl_log_capture(void *userdata, int category, SDL_LogPriority priority,
+                                    const char *message) {
+  (void)userdata;
+  if (message == NULL) {
+    return;
+  }
+
+#ifdef USE_SDL2
+  // Filter out SDL's internal app metadata messages (shown by sdl2-compat)
+  // These show misleading default values since SDL2 doesn't have SDL_SetAppMetadata
+  if (SDL_strncmp(message, "App name:", 9) == 0 || SDL_strncmp(message, "App version:", 12) == 0 ||
+      SDL_strncmp(message, "App ID:", 7) == 0 || SDL_strncmp(message, "SDL revision:", 13) == 0) {
+    return; // Suppress these messages
+  }
+#endif
+
+  post_message(category, priority, message);
+
+  if (prev_log_output_fn != NULL) {
+    prev_log_output_fn(prev_log_output_userdata, category, priority, message);
+  }
+}
+
+static const char *priority_name(const int priority) {
+  switch (priority) {
+  case SDL_LOG_PRIORITY_CRITICAL:
+    return "CRITICAL";
+  case SDL_LOG_PRIORITY_ERROR:
+    return "ERROR";
+  case SDL_LOG_PRIORITY_WARN:
+    return "WARN";
+  case SDL_LOG_PRIORITY_INFO:
+    return "INFO";
+  case SDL_LOG_PRIORITY_DEBUG:
+    return "DEBUG";
+  default:
+    return "VERBOSE";
+  }
+}
+
+static int SDLCALL file_writer(void *data) {
+  (void)data;
+  char message[LOG_LINE_LENGTH];
+  char line[LOG_LINE_LENGTH + 32];
+
+  for (;;) {
+    const int stopping = SDL_GetAtomicInt(&file_stop);
+    const uint32_t written = (uint32_t)SDL_GetAtomicInt(&file_written);
+    uint32_t read = (uint32_t)SDL_GetAtomicInt(&file_read);
+    for (; read != written; read++) {
+      const log_record_s *record = &file_records[read % LOG_FILE_RECORDS];
+      format_record(record, message, sizeof(message));
+      const int length =
+          SDL_snprintf(line, sizeof(line), "[%10.3f] %s: %s\n",
+                       (double)(record->time_ns - origin_ns) / SDL_NS_PER_SECOND,
+                       priority_name(record->priority), message);
+      SDL_WriteIO(log_file, line, SDL_min((size_t)length, sizeof(line) - 1));
+      SDL_SetAtomicInt(&file_read, (int)(read + 1));
+    }
+    SDL_FlushIO(log_file);
+    if (stopping) {
+      break;
+    }
+    SDL_Delay(LOG_FILE_INTERVAL_MS);
+  }
+  return 0;
+}
+
+void log_ring_init(void) {
+  if (capturing) {
+    return;
+  }
+  capturing = 1;
+  origin_ns = SDL_GetTicksNS();
+  if (shared_mutex == NULL) {
+    shared_mutex = SDL_CreateMutex();
+    COMPAT_TLS_CREATE(&slot_tls);
+  }
+  SDL_GetLogOutputFunction(&prev_log_output_fn, &prev_log_output_userdata);
+  SDL_SetLogOutputFunction(sdl_log_capture, NULL);
+}
+
+int log_ring_open_file(const char *path) {
+  log_file = SDL_IOFromFile(path, "ab");
+  if (log_file == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't open log file %s: %s", path, SDL_GetError());
+    return 0;
+  }
+  SDL_SetAtomicInt(&file_stop, 0);
+  file_thread = SDL_CreateThread(file_writer, "m8c-log", NULL);
+  if (file_thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't start log writer: %s", SDL_GetError());
+    SDL_CloseIO(log_file);
+    log_file = NULL;
+    return 0;
+  }
+  SDL_Log("Writing log to %s", path);
+  return 1;
+}
+
+static void add_to_history(const log_record_s *record) {
+  const int index = (history_start + history_count) % LOG_HISTORY_RECORDS;
+  history[index] = *record;
+  if (history_count < LOG_HISTORY_RECORDS) {
+    history_count++;
+  } else {
+    history_start = (history_start + 1) % LOG_HISTORY_RECORDS;
+  }
+  generation++;
+}
+
+static void consume(const log_record_s *record) {
+  add_to_history(record);
+
+  // Messages formatted by SDL already reached the console from the capture callback
+  if (record->format != NULL && prev_log_output_fn != NULL) {
+    char message[LOG_LINE_LENGTH];
+    format_record(record, message, sizeof(message));
+    prev_log_output_fn(prev_log_output_userdata, record->category, record->priority, message);
+  }
+
+  if (file_thread != NULL) {
+    const uint32_t written = (uint32_t)SDL_GetAtomicInt(&file_written);
+    if (written - (uint32_t)SDL_GetAtomicInt(&file_read) < LOG_FILE_RECORDS) {
+      file_records[written % LOG_FILE_RECORDS] = *record;
+      SDL_SetAtomicInt(&file_written, (int)(written + 1));
+    }
+  }
+}
+
+static const log_record_s *peek(log_ring_s *ring) {
+  const uint32_t read = (uint32_t)SDL_GetAtomicInt(&ring->read);
+  if (read == (uint32_t)SDL_GetAtomicInt(&ring->written)) {
+    return NULL;
+  }
+  return &ring->records[read % LOG_RING_RECORDS];
+}
+
+void log_ring_pump(void) {
+  log_ring_s *active[LOG_MAX_THREADS + 1];
+  int count = 0;
+  active[count++] = &shared_ring;
+  for (int slot = 0; slot < LOG_MAX_THREADS; slot++) {
+    log_ring_s *ring = SDL_GetAtomicPointer(&rings[slot]);
+    if (ring != NULL) {
+      active[count++] = ring;
+    }
+  }
+
+  // Merge the rings in time order
+  for (;;) {
+    log_ring_s *oldest_ring = NULL;
+    const log_record_s *oldest = NULL;
+    for (int i = 0; i < count; i++) {
+      log_ring_s *ring = active[i];
+      const log_record_s *record = peek(ring);
+      if (record != NULL && (oldest == NULL || record->time_ns < oldest->time_ns)) {
+        oldest = record;
+        oldest_ring = ring;
+      }
+    }
+    if (oldest == NULL) {
+      break;
+    }
+    consume(oldest);
+    SDL_AddAtomicInt(&oldest_ring->read, 1);
+  }
+
+  // Hand the rings of exited threads to new threads. Nothing writes to a released ring, so it
+  // stays empty once drained.
+  for (int slot = 0; slot < LOG_MAX_THREADS; slot++) {
+    if (SDL_GetAtomicInt(&slot_states[slot]) == SLOT_RELEASED &&
+        peek(SDL_GetAtomicPointer(&rings[slot])) == NULL) {
+      SDL_SetAtomicInt(&slot_states[slot], SLOT_FREE);
+    }
+  }
+
+  const int dropped = SDL_SetAtomicInt(&dropped_records, 0);
+  if (dropped > 0) {
+    log_record_s record;
+    record.time_ns = SDL_GetTicksNS();
+    record.format = NULL;
+    record.category = SDL_LOG_CATEGORY_SYSTEM;
+    record.priority = SDL_LOG_PRIORITY_WARN;
+    record.length = (uint16_t)SDL_snprintf((char *)record.payload, sizeof(record.payload),
+                                           "%d log messages dropped", dropped);
+    consume(&record);
+  }
+}
+
+int log_ring_history_count(void) { return history_count; }
+
+void log_ring_history_format(const int index, char *buffer, const size_t size) {
+  format_record(&history[(history_start + index) % LOG_HISTORY_RECORDS], buffer, size);
+}
+
+unsigned int log_ring_generation(void) { return generation; }
+
+void log_ring_close(void) {
+  log_ring_pump();
+  if (prev_log_output_fn != NULL) {
+    SDL_SetLogOutputFunction(prev_log_output_fn, prev_log_output_userdata);
+    prev_log_output_fn = NULL;
+    prev_log_output_userdata = NULL;
+  }
+  capturing = 0;
+  if (file_thread != NULL) {
+    SDL_SetAtomicInt(&file_stop, 1);
+    SDL_WaitThread(file_thread, NULL);
+    file_thread = NULL;
+    SDL_CloseIO(log_file);
+    log_file = NULL;
+  }
+}
@@ -0,0 +1,46 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Asynchronous log pipeline. Log records are written as compact binary entries (timestamp,
+// category, priority, format and arguments) into lock-free per-thread rings. The main thread
+// collects them into a history and formats them only when they are consumed: by the log
+// overlay, the console for records posted with log_async(), or the optional log file writer.
+
+#ifndef LOG_RING_H_
+#define LOG_RING_H_
+
+#include "sdl_compat.h"
+#include <stddef.h>
+
+// Capture the SDL log output into the pipeline
+void log_ring_init(void);
+
+// Write the pipeline's last records to the log file and restore the SDL log output
+void log_ring_close(void);
+
+/**
+ * Start writing every log record to a file from a background thread.
+ *
+ * @param path File to append the log to.
+ * @return 1 on success, 0 on failure.
+ */
+int log_ring_open_file(const char *path);
+
+// Log without formatting on the calling thread, for the device reading threads and other hot
+// paths. Arguments are copied, strings up to the size of a record.
+void log_async(int category, SDL_LogPriority priority, SDL_PRINTF_FORMAT_STRING const char *format,
+               ...) SDL_PRINTF_VARARG_FUNC(3);
+
+// Collect new records from all threads. Main thread only, called once per main loop iteration.
+void log_ring_pump(void);
+
+// Number of records in the history, at most a few hundred
+int log_ring_history_count(void);
+
+// Format a history record, 0 being the oldest one
+void log_ring_history_format(int index, char *buffer, size_t size);
+
+// Incremented whenever records are added to the history
+unsigned int log_ring_generation(void);
+
+#endif // LOG_RING_H_
@@ -0,0 +1,199 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "metrics.h"
+#include "backends/slip.h"
+#include "command.h"
+#include "sdl_compat.h"
+
+typedef enum { METRIC_COUNTER, METRIC_GAUGE } metric_kind_t;
+
+typedef enum {
+  METRIC_PACKETS_RECT,
+  METRIC_PACKETS_TEXT,
+  METRIC_PACKETS_WAVEFORM,
+  METRIC_PACKETS_JOYPAD,
+  METRIC_PACKETS_SYSTEM,
+  METRIC_PACKETS_OTHER,
+  METRIC_BYTES_READ,
+  METRIC_SLIP_OVERFLOW,
+  METRIC_SLIP_ESCAPE,
+  METRIC_SLIP_INVALID,
+  METRIC_SLIP_OTHER,
+  METRIC_QUEUE_DROPS,
+  METRIC_QUEUE_DEPTH,
+  METRIC_QUEUE_HIGH_WATER,
+  METRIC_AUDIO_FILL,
+  METRIC_AUDIO_UNDERRUNS,
+  METRIC_RENDER_CALLS,
+  METRIC_FRAMES,
+  METRIC_PRESENT_US,
+  METRIC_COUNT
+} metric_id_t;
+
+typedef struct {
+  const char *name;
+  const char *labels; // label set without braces, NULL for none
+  const char *help;
+  metric_kind_t kind;
+  SDL_AtomicInt value;
+} metric_s;
+
+// Entries sharing a name must be adjacent, HELP and TYPE are written for the first one
+static metric_s registry[METRIC_COUNT] = {
+    [METRIC_PACKETS_RECT] = {"m8c_packets_total", "type=\"rect\"",
+                             "Processed display packets by command type", METRIC_COUNTER},
+    [METRIC_PACKETS_TEXT] = {"m8c_packets_total", "type=\"text\"", NULL, METRIC_COUNTER},
+    [METRIC_PACKETS_WAVEFORM] = {"m8c_packets_total", "type=\"waveform\"", NULL, METRIC_COUNTER},
+    [METRIC_PACKETS_JOYPAD] = {"m8c_packets_total", "type=\"joypad\"", NULL, METRIC_COUNTER},
+    [METRIC_PACKETS_SYSTEM] = {"m8c_packets_total", "type=\"system\"", NULL, METRIC_COUNTER},
+    [METRIC_PACKETS_OTHER] = {"m8c_packets_total", "type=\"other\"", NULL, METRIC_COUNTER},
+    [METRIC_BYTES_READ] = {"m8c_bytes_read_total", NULL, "Bytes received from the M8",
+                           METRIC_COUNTER},
+    [METRIC_SLIP_OVERFLOW] = {"m8c_slip_errors_total", "error=\"buffer_overflow\"",
+                              "SLIP decoding errors by type", METRIC_COUNTER},
+    [METRIC_SLIP_ESCAPE] = {"m8c_slip_errors_total", "error=\"unknown_escaped_byte\"", NULL,
+                            METRIC_COUNTER},
+    [METRIC_SLIP_INVALID] = {"m8c_slip_errors_total", "error=\"invalid_packet\"", NULL,
+                             METRIC_COUNTER},
+    [METRIC_SLIP_OTHER] = {"m8c_slip_errors_total", "error=\"other\"", NULL, METRIC_COUNTER},
+    [METRIC_QUEUE_DROPS] = {"m8c_queue_drops_total", NULL,
+                            "Messages dropped because the queue was full", METRIC_COUNTER},
+    [METRIC_QUEUE_DEPTH] = {"m8c_queue_depth", NULL, "Messages waiting in the queue",
+                            METRIC_GAUGE},
+    [METRIC_QUEUE_HIGH_WATER] = {"m8c_queue_high_water", NULL, "Largest queue depth seen",
+                                 METRIC_GAUGE},
+    [METRIC_AUDIO_FILL] = {"m8c_audio_buffer_bytes", NULL, "Bytes buffered for audio output",
+                           METRIC_GAUGE},
+    [METRIC_AUDIO_UNDERRUNS] = {"m8c_audio_underruns_total", NULL, "Audio output underruns",
+                                METRIC_COUNTER},
+    [METRIC_RENDER_CALLS] = {"m8c_render_calls_total", NULL,
+                             "render_screen calls, including skipped ones", METRIC_COUNTER},
+    [METRIC_FRAMES] = {"m8c_frames_presented_total", NULL, "Presented frames", METRIC_COUNTER},
+    [METRIC_PRESENT_US] = {"m8c_present_microseconds_total", NULL,
+                           "Time spent in SDL_RenderPresent", METRIC_COUNTER},
+};
+
+static uint32_t get(const metric_id_t id) { return (uint32_t)SDL_GetAtomicInt(&registry[id].value); }
+
+static void add(const metric_id_t id, const uint32_t amount) {
+  SDL_AddAtomicInt(&registry[id].value, (int)amount);
+}
+
+static void set(const metric_id_t id, const uint32_t value) {
+  SDL_SetAtomicInt(&registry[id].value, (int)value);
+}
+
+void metrics_count_packet(const uint8_t command) {
+  metric_id_t id;
+  switch (command) {
+  case draw_rectangle_command:
+    id = METRIC_PACKETS_RECT;
+    break;
+  case draw_character_command:
+    id = METRIC_PACKETS_TEXT;
+    break;
+  case draw_oscilloscope_waveform_command:
+    id = METRIC_PACKETS_WAVEFORM;
+    break;
+  case joypad_keypressedstate_command:
+    id = METRIC_PACKETS_JOYPAD;
+    break;
+  case system_info_command:
+    id = METRIC_PACKETS_SYSTEM;
+    break;
+  default:
+    id = METRIC_PACKETS_OTHER;
+    break;
+  }
+  add(id, 1);
+}
+
+void metrics_count_bytes_read(const uint32_t bytes) { add(METRIC_BYTES_READ, bytes); }
+
+void metrics_count_slip_error(const int error) {
+  switch (error) {
+  case SLIP_ERROR_BUFFER_OVERFLOW:
+    add(METRIC_SLIP_OVERFLOW, 1);
+    break;
+  case SLIP_ERROR_UNKNOWN_ESCAPED_BYTE:
+    add(METRIC_SLIP_ESCAPE, 1);
+    break;
+  case SLIP_ERROR_INVALID_PACKET:
+    add(METRIC_SLIP_INVALID, 1);
+    break;
+  default:
+    add(METRIC_SLIP_OTHER, 1);
+    break;
+  }
+}
+
+void metrics_count_queue_drop(void) { add(METRIC_QUEUE_DROPS, 1); }
+
+// Only the queue producer raises the depth, so the high-water mark needs no compare-and-swap
+void metrics_set_queue_depth(const uint32_t depth) {
+  set(METRIC_QUEUE_DEPTH, depth);
+  if (depth > get(METRIC_QUEUE_HIGH_WATER)) {
+    set(METRIC_QUEUE_HIGH_WATER, depth);
+  }
+}
+
+void metrics_set_audio_fill(const uint32_t bytes) { set(METRIC_AUDIO_FILL, bytes); }
+
+void metrics_count_audio_underrun(void) { add(METRIC_AUDIO_UNDERRUNS, 1); }
+
+void metrics_count_render_call(void) { add(METRIC_RENDER_CALLS, 1); }
+
+void metrics_record_present(const uint64_t duration_ns) {
+  add(METRIC_FRAMES, 1);
+  add(METRIC_PRESENT_US, (uint32_t)(duration_ns / 1000));
+}
+
+void metrics_snapshot(metrics_snapshot_s *snapshot) {
+  for (int i = 0; i < METRICS_PACKET_TYPES; i++) {
+    snapshot->packets[i] = get(METRIC_PACKETS_RECT + i);
+  }
+  snapshot->bytes_read = get(METRIC_BYTES_READ);
+  snapshot->slip_errors = get(METRIC_SLIP_OVERFLOW) + get(METRIC_SLIP_ESCAPE) +
+                          get(METRIC_SLIP_INVALID) + get(METRIC_SLIP_OTHER);
+  snapshot->queue_drops = get(METRIC_QUEUE_DROPS);
+  snapshot->queue_depth = get(METRIC_QUEUE_DEPTH);
+  snapshot->queue_high_water = get(METRIC_QUEUE_HIGH_WATER);
+  snapshot->audio_fill = get(METRIC_AUDIO_FILL);
+  snapshot->audio_underruns = get(METRIC_AUDIO_UNDERRUNS);
+  snapshot->render_calls = get(METRIC_RENDER_CALLS);
+  snapshot->frames = get(METRIC_FRAMES);
+  snapshot->present_us = get(METRIC_PRESENT_US);
+}
+
+size_t metrics_format_prometheus(char *buffer, const size_t size) {
+  size_t length = 0;
+  buffer[0] = '\0';
+
+  for (int i = 0; i < METRIC_COUNT && length < size; i++) {
+    const metric_s *metric = &registry[i];
+    int written;
+    if (metric->help != NULL) {
+      written = SDL_snprintf(buffer + length, size - length, "# HELP %s %s\n# TYPE %s %s\n",
+                             metric->name, metric->help, metric->name,
+                             metric->kind == METRIC_COUNTER ? "counter" : "gauge");
+      if (written < 0) {
+        break;
+      }
+      length = SDL_min(size - 1, length + (size_t)written);
+    }
+    // Counters wrap around at 2^32, which Prometheus treats as a counter reset
+    if (metric->labels != NULL) {
+      written = SDL_snprintf(buffer + length, size - length, "%s{%s} %u\n", metric->name,
+                             metric->labels, get((metric_id_t)i));
+    } else {
+      written =
+          SDL_snprintf(buffer + length, size - length, "%s %u\n", metric->name, get((metric_id_t)i));
+    }
+    if (written < 0) {
+      break;
+    }
+    length = SDL_min(size - 1, length + (size_t)written);
+  }
+  return length;
+}
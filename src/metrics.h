@@ -0,0 +1,71 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Registry of lock-free counters and gauges for the display, serial and audio paths. Writers may
+// run on any thread; readers take a snapshot and derive rates from the difference between two
+// snapshots, or export the whole registry in the Prometheus text format.
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  METRICS_PACKET_RECT,
+  METRICS_PACKET_TEXT,
+  METRICS_PACKET_WAVEFORM,
+  METRICS_PACKET_JOYPAD,
+  METRICS_PACKET_SYSTEM,
+  METRICS_PACKET_OTHER,
+  METRICS_PACKET_TYPES
+} metrics_packet_type_t;
+
+typedef struct {
+  uint32_t packets[METRICS_PACKET_TYPES]; // processed packets by command type
+  uint32_t bytes_read;      // bytes received from the M8
+  uint32_t slip_errors;     // all SLIP decoding errors
+  uint32_t queue_drops;     // messages dropped because the queue was full
+  uint32_t queue_depth;     // messages waiting in the queue
+  uint32_t queue_high_water; // largest queue depth seen
+  uint32_t audio_fill;      // bytes buffered for audio output
+  uint32_t audio_underruns;
+  uint32_t render_calls;    // render_screen calls, including skipped ones
+  uint32_t frames;          // presented frames
+  uint32_t present_us;      // total time spent presenting frames
+} metrics_snapshot_s;
+
+// Count a packet by its command byte
+void metrics_count_packet(uint8_t command);
+
+void metrics_count_bytes_read(uint32_t bytes);
+
+// Count a SLIP decoding error by its slip_error_t code
+void metrics_count_slip_error(int error);
+
+void metrics_count_queue_drop(void);
+
+void metrics_set_queue_depth(uint32_t depth);
+
+void metrics_set_audio_fill(uint32_t bytes);
+
+void metrics_count_audio_underrun(void);
+
+void metrics_count_render_call(void);
+
+// Count a presented frame and the time SDL_RenderPresent took
+void metrics_record_present(uint64_t duration_ns);
+
+// Read the current counter values. Counters are monotonic and wrap around.
+void metrics_snapshot(metrics_snapshot_s *snapshot);
+
+/**
+ * Format every registered metric in the Prometheus text exposition format.
+ *
+ * @param buffer Output buffer, always null terminated.
+ * @param size Size of the buffer in bytes.
+ * @return Length of the formatted text, truncated to fit the buffer.
+ */
+size_t metrics_format_prometheus(char *buffer, size_t size);
+
+#endif // METRICS_H_
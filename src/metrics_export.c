@@ -0,0 +1,206 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "metrics_export.h"
+#include "metrics.h"
+#include "sdl_compat.h"
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#define METRICS_SOCKET_SUPPORTED
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS, SO_NOSIGPIPE is set on the socket instead
+#endif
+#endif
+
+#define METRICS_BUFFER_SIZE 8192
+#define POLL_INTERVAL_MS 250
+#define SNAPSHOT_INTERVAL_MS 5000
+#define REQUEST_TIMEOUT_US 100000
+
+static SDL_Thread *export_thread = NULL;
+static SDL_AtomicInt export_stop;
+static char *snapshot_file = NULL;
+static char metrics_text[METRICS_BUFFER_SIZE];
+
+#ifdef METRICS_SOCKET_SUPPORTED
+static int listen_fd = -1;
+static char *socket_file = NULL;
+
+static void send_all(const int fd, const char *data, size_t length) {
+  while (length > 0) {
+    const ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return;
+    }
+    data += sent;
+    length -= (size_t)sent;
+  }
+}
+
+// Answers HTTP GET requests with a minimal HTTP/1.0 response so Prometheus and curl
+// --unix-socket can scrape directly; anything else (e.g. nc -U) gets the plain text
+static void serve_client(void) {
+  const int client = accept(listen_fd, NULL, NULL);
+  if (client < 0) {
+    return;
+  }
+#ifdef SO_NOSIGPIPE
+  const int on = 1;
+  setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  struct timeval timeout = {0, REQUEST_TIMEOUT_US};
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  char request[512];
+  const ssize_t received = recv(client, request, sizeof(request) - 1, 0);
+  const int http = received >= 4 && SDL_strncmp(request, "GET ", 4) == 0;
+
+  const size_t length = metrics_format_prometheus(metrics_text, sizeof(metrics_text));
+  if (http) {
+    char header[128];
+    const int header_length =
+        SDL_snprintf(header, sizeof(header),
+                     "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                     "Content-Length: %u\r\n\r\n",
+                     (unsigned int)length);
+    send_all(client, header, (size_t)header_length);
+  }
+  send_all(client, metrics_text, length);
+  close(client);
+}
+
+static int open_socket(const char *path) {
+  struct sockaddr_un address;
+  if (SDL_strlen(path) >= sizeof(address.sun_path)) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Metrics socket path too long: %s", path);
+    return 0;
+  }
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't create metrics socket");
+    return 0;
+  }
+  SDL_zero(address);
+  address.sun_family = AF_UNIX;
+  SDL_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+
+  unlink(path); // stale socket from a previous run
+  if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(listen_fd, 4) < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't listen on metrics socket %s", path);
+    close(listen_fd);
+    listen_fd = -1;
+    return 0;
+  }
+  socket_file = SDL_strdup(path);
+  SDL_Log("Serving metrics on %s", path);
+  return 1;
+}
+
+static void close_socket(void) {
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    listen_fd = -1;
+  }
+  if (socket_file != NULL) {
+    unlink(socket_file);
+    SDL_free(socket_file);
+    socket_file = NULL;
+  }
+}
+#endif // METRICS_SOCKET_SUPPORTED
+
+// Writes to a temporary file first so readers never see a partial snapshot
+static void write_snapshot(void) {
+  char temp_path[1024];
+  SDL_snprintf(temp_path, sizeof(temp_path), "%s.tmp", snapshot_file);
+
+  SDL_IOStream *io = SDL_IOFromFile(temp_path, "wb");
+  if (io == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't write metrics snapshot %s: %s", temp_path,
+                 SDL_GetError());
+    return;
+  }
+  const size_t length = metrics_format_prometheus(metrics_text, sizeof(metrics_text));
+  const int written = SDL_WriteIO(io, metrics_text, length) == length;
+  SDL_CloseIO(io);
+  if (written) {
+    remove(snapshot_file); // rename() does not replace existing files on Windows
+    rename(temp_path, snapshot_file);
+  }
+}
+
+static int SDLCALL export_loop(void *data) {
+  (void)data;
+  Uint64 next_snapshot = 0;
+
+  while (!SDL_GetAtomicInt(&export_stop)) {
+#ifdef METRICS_SOCKET_SUPPORTED
+    if (listen_fd >= 0) {
+      struct pollfd poll_fd = {listen_fd, POLLIN, 0};
+      if (poll(&poll_fd, 1, POLL_INTERVAL_MS) > 0) {
+        serve_client();
+      }
+    } else {
+      SDL_Delay(POLL_INTERVAL_MS);
+    }
+#else
+    SDL_Delay(POLL_INTERVAL_MS);
+#endif
+
+    if (snapshot_file != NULL && SDL_GetTicks() >= next_snapshot) {
+      next_snapshot = SDL_GetTicks() + SNAPSHOT_INTERVAL_MS;
+      write_snapshot();
+    }
+  }
+  return 0;
+}
+
+int metrics_export_start(const char *socket_path, const char *snapshot_path) {
+  if (socket_path != NULL) {
+#ifdef METRICS_SOCKET_SUPPORTED
+    if (!open_socket(socket_path)) {
+      return 0;
+    }
+#else
+    SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Metrics socket is not supported on this platform");
+#endif
+  }
+  if (snapshot_path != NULL) {
+    snapshot_file = SDL_strdup(snapshot_path);
+    SDL_Log("Writing metrics snapshots to %s", snapshot_path);
+  }
+
+  SDL_SetAtomicInt(&export_stop, 0);
+  export_thread = SDL_CreateThread(export_loop, "m8c-metrics", NULL);
+  if (export_thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't start metrics thread: %s", SDL_GetError());
+    metrics_export_stop();
+    return 0;
+  }
+  return 1;
+}
+
+void metrics_export_stop(void) {
+  if (export_thread != NULL) {
+    SDL_SetAtomicInt(&export_stop, 1);
+    SDL_WaitThread(export_thread, NULL);
+    export_thread = NULL;
+  }
+#ifdef METRICS_SOCKET_SUPPORTED
+  close_socket();
+#endif
+  if (snapshot_file != NULL) {
+    write_snapshot(); // final values
+    SDL_free(snapshot_file);
+    snapshot_file = NULL;
+  }
+}
@@ -0,0 +1,24 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Exports the metrics registry in the Prometheus text format for unattended installations:
+// served on a local Unix domain socket and/or written periodically to a snapshot file.
+
+#ifndef METRICS_EXPORT_H_
+#define METRICS_EXPORT_H_
+
+/**
+ * Start the export thread.
+ *
+ * @param socket_path Unix domain socket to serve the metrics on, NULL to disable. Not available
+ * on Windows.
+ * @param snapshot_path File to rewrite with the current metrics every few seconds, NULL to
+ * disable.
+ * @return 1 on success, 0 on failure.
+ */
+int metrics_export_start(const char *socket_path, const char *snapshot_path);
+
+// Stop the export thread and remove the socket
+void metrics_export_stop(void);
+
+#endif // METRICS_EXPORT_H_
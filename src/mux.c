@@ -0,0 +1,506 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "mux.h"
+#include "backends/m8.h"
+#include "backends/queue.h"
+#include "command.h"
+#include "sdl_compat.h"
+
+#ifndef _WIN32
+#define MUX_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS, SO_NOSIGPIPE is set on the socket instead
+#endif
+#endif
+
+#define MUX_MAGIC 0x4D38434D     // "M8CM"
+#define MUX_RING_SIZE (1 << 20)  // bytes, a power of two
+#define MUX_RECORD_MAX (2 + MAX_MESSAGE_SIZE) // length prefix and packet
+#define MUX_MAX_CLIENTS 8
+#define MUX_SYSTEM_INFO_SIZE 16
+#define MUX_SHM_NAME_SIZE 32 // shared memory names are limited to 31 characters on macOS
+#define HELLO_TIMEOUT_S 1
+
+typedef enum { MUX_OFF, MUX_DAEMON, MUX_CLIENT } mux_mode_t;
+
+// Viewer to daemon messages, three bytes each
+typedef enum {
+  MUX_INPUT_CONTROLLER = 1, // pressed button bitmask
+  MUX_INPUT_KEYJAZZ = 2,    // note, velocity
+  MUX_INPUT_RESET = 3,      // redraw the whole display
+} mux_input_t;
+
+// Shared memory layout. The ring holds packets as a little-endian 16-bit length followed by the
+// packet bytes; records wrap around the end of the ring. The daemon writes a record before it
+// advances write_position, so every byte before the position is complete.
+typedef struct {
+  uint32_t magic;
+  uint32_t ring_size;
+  SDL_AtomicInt write_position; // bytes written since the start, wraps at 2^32
+  SDL_AtomicInt system_info_length; // 0 until the M8 sent its system info
+  uint8_t system_info[MUX_SYSTEM_INFO_SIZE]; // the latest system info packet, for late viewers
+  uint8_t ring[MUX_RING_SIZE];
+} mux_shared_s;
+
+// First message on a new connection
+typedef struct {
+  uint32_t magic;
+  char shm_name[MUX_SHM_NAME_SIZE];
+} mux_hello_s;
+
+static mux_mode_t mode = MUX_OFF;
+static const char *socket_file = NULL;
+
+#ifdef MUX_SUPPORTED
+static mux_shared_s *shared = NULL;
+static char shm_name[MUX_SHM_NAME_SIZE];
+
+// Daemon
+static int listen_fd = -1;
+static int client_fds[MUX_MAX_CLIENTS];
+static unsigned char client_input[MUX_MAX_CLIENTS]; // buttons held on each viewer
+static uint8_t client_pending[MUX_MAX_CLIENTS][3]; // partially received message
+static int client_pending_length[MUX_MAX_CLIENTS];
+static unsigned char local_input = 0;
+static unsigned char sent_input = 0;
+
+// Viewer
+static int daemon_fd = -1;
+static uint32_t read_position = 0;
+static uint8_t packet[MAX_MESSAGE_SIZE];
+#endif
+
+void mux_configure_daemon(const char *socket_path) {
+#ifdef MUX_SUPPORTED
+  mode = MUX_DAEMON;
+  socket_file = socket_path;
+#else
+  (void)socket_path;
+  SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "The device multiplexer is not supported on this platform");
+#endif
+}
+
+void mux_configure_client(const char *socket_path) {
+#ifdef MUX_SUPPORTED
+  mode = MUX_CLIENT;
+  socket_file = socket_path;
+#else
+  (void)socket_path;
+  SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "The device multiplexer is not supported on this platform");
+#endif
+}
+
+int mux_is_client(void) { return mode == MUX_CLIENT; }
+
+#ifdef MUX_SUPPORTED
+
+static void set_socket_options(const int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  const int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+static int socket_address(struct sockaddr_un *address) {
+  if (SDL_strlen(socket_file) >= sizeof(address->sun_path)) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Multiplexer socket path too long: %s", socket_file);
+    return 0;
+  }
+  SDL_zerop(address);
+  address->sun_family = AF_UNIX;
+  SDL_strlcpy(address->sun_path, socket_file, sizeof(address->sun_path));
+  return 1;
+}
+
+static void ring_write(const uint32_t position, const uint8_t *data, const uint32_t length) {
+  const uint32_t offset = position & (MUX_RING_SIZE - 1);
+  const uint32_t first = SDL_min(length, MUX_RING_SIZE - offset);
+  SDL_memcpy(shared->ring + offset, data, first);
+  SDL_memcpy(shared->ring, data + first, length - first);
+}
+
+static void ring_read(const uint32_t position, uint8_t *data, const uint32_t length) {
+  const uint32_t offset = position & (MUX_RING_SIZE - 1);
+  const uint32_t first = SDL_min(length, MUX_RING_SIZE - offset);
+  SDL_memcpy(data, shared->ring + offset, first);
+  SDL_memcpy(data + first, shared->ring, length - first);
+}
+
+// Send the buttons held locally and on all viewers, if they changed
+static void send_merged_input(void) {
+  unsigned char merged = local_input;
+  for (int i = 0; i < MUX_MAX_CLIENTS; i++) {
+    if (client_fds[i] >= 0) {
+      merged |= client_input[i];
+    }
+  }
+  if (merged != sent_input) {
+    sent_input = merged;
+    m8_send_msg_controller(merged);
+  }
+}
+
+static int daemon_start(void) {
+  for (int i = 0; i < MUX_MAX_CLIENTS; i++) {
+    client_fds[i] = -1;
+  }
+
+  SDL_snprintf(shm_name, sizeof(shm_name), "/m8c-mux-%d", (int)getpid());
+  shm_unlink(shm_name); // stale segment of a crashed daemon with the same pid
+  const int shm_fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (shm_fd < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't create shared memory %s: %s", shm_name,
+                 strerror(errno));
+    return 0;
+  }
+  if (ftruncate(shm_fd, sizeof(mux_shared_s)) == 0) {
+    shared =
+        mmap(NULL, sizeof(mux_shared_s), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+  }
+  close(shm_fd);
+  if (shared == NULL || shared == MAP_FAILED) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't map shared memory: %s", strerror(errno));
+    shared = NULL;
+    shm_unlink(shm_name);
+    return 0;
+  }
+  shared->magic = MUX_MAGIC;
+  shared->ring_size = MUX_RING_SIZE;
+
+  struct sockaddr_un address;
+  if (!socket_address(&address)) {
+    return 0;
+  }
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't create multiplexer socket");
+    return 0;
+  }
+  unlink(socket_file); // stale socket from a previous run
+  if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(listen_fd, MUX_MAX_CLIENTS) < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't listen on multiplexer socket %s", socket_file);
+    close(listen_fd);
+    listen_fd = -1;
+    return 0;
+  }
+  set_socket_options(listen_fd);
+  SDL_Log("Sharing the M8 with viewers on %s", socket_file);
+  return 1;
+}
+
+// The viewer maps the ring read-only and SDL_GetAtomicInt may be a compare-and-swap, so the
+// daemon's counters are read with a plain load followed by an acquire barrier
+static int load_shared(const SDL_AtomicInt *value) {
+  const int loaded = *(const volatile int *)&value->value;
+  SDL_MemoryBarrierAcquire();
+  return loaded;
+}
+
+static int send_to_daemon(const uint8_t type, const uint8_t a, const uint8_t b) {
+  const uint8_t message[3] = {type, a, b};
+  return send(daemon_fd, message, sizeof(message), MSG_NOSIGNAL) == sizeof(message);
+}
+
+static int client_start(void) {
+  struct sockaddr_un address;
+  if (!socket_address(&address)) {
+    return 0;
+  }
+  daemon_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (daemon_fd < 0 || connect(daemon_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't connect to m8c daemon on %s: %s", socket_file,
+                 strerror(errno));
+    if (daemon_fd >= 0) {
+      close(daemon_fd);
+      daemon_fd = -1;
+    }
+    return 0;
+  }
+
+  struct timeval timeout = {HELLO_TIMEOUT_S, 0};
+  setsockopt(daemon_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  mux_hello_s hello;
+  if (recv(daemon_fd, &hello, sizeof(hello), MSG_WAITALL) != sizeof(hello) ||
+      hello.magic != MUX_MAGIC) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "No answer from m8c daemon on %s", socket_file);
+    return 0;
+  }
+  set_socket_options(daemon_fd);
+
+  hello.shm_name[MUX_SHM_NAME_SIZE - 1] = '\0';
+  SDL_strlcpy(shm_name, hello.shm_name, sizeof(shm_name));
+  const int shm_fd = shm_open(shm_name, O_RDONLY, 0);
+  if (shm_fd < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't open shared memory %s: %s", shm_name,
+                 strerror(errno));
+    return 0;
+  }
+  shared = mmap(NULL, sizeof(mux_shared_s), PROT_READ, MAP_SHARED, shm_fd, 0);
+  close(shm_fd);
+  if (shared == MAP_FAILED || shared->magic != MUX_MAGIC || shared->ring_size != MUX_RING_SIZE) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Shared memory %s is not an m8c packet ring", shm_name);
+    if (shared != MAP_FAILED) {
+      munmap(shared, sizeof(mux_shared_s));
+    }
+    shared = NULL;
+    return 0;
+  }
+
+  // Join at the current position: set up the model and font from the last system info, then
+  // have the M8 redraw everything
+  read_position = (uint32_t)load_shared(&shared->write_position);
+  const int system_info_length = load_shared(&shared->system_info_length);
+  if (system_info_length > 0) {
+    uint8_t system_info[MUX_SYSTEM_INFO_SIZE];
+    SDL_memcpy(system_info, shared->system_info, system_info_length);
+    process_command(system_info, system_info_length);
+  }
+  send_to_daemon(MUX_INPUT_RESET, 0, 0);
+  SDL_Log("Connected to m8c daemon on %s", socket_file);
+  return 1;
+}
+
+// Remove a viewer, releasing the buttons it held
+static void drop_client(const int index) {
+  close(client_fds[index]);
+  client_fds[index] = -1;
+  client_input[index] = 0;
+  client_pending_length[index] = 0;
+  SDL_Log("Viewer %d disconnected", index);
+}
+
+static void accept_clients(void) {
+  int fd;
+  while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+    int index = 0;
+    while (index < MUX_MAX_CLIENTS && client_fds[index] >= 0) {
+      index++;
+    }
+    mux_hello_s hello;
+    SDL_zero(hello);
+    hello.magic = MUX_MAGIC;
+    SDL_strlcpy(hello.shm_name, shm_name, sizeof(hello.shm_name));
+    if (index == MUX_MAX_CLIENTS ||
+        send(fd, &hello, sizeof(hello), MSG_NOSIGNAL) != sizeof(hello)) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Couldn't accept viewer, %d are connected",
+                  MUX_MAX_CLIENTS);
+      close(fd);
+      continue;
+    }
+    set_socket_options(fd);
+    client_fds[index] = fd;
+    client_input[index] = 0;
+    client_pending_length[index] = 0;
+    SDL_Log("Viewer %d connected", index);
+  }
+}
+
+static void apply_input(const int index, const uint8_t *message, const int device_connected) {
+  if (!device_connected) {
+    return;
+  }
+  switch (message[0]) {
+  case MUX_INPUT_CONTROLLER:
+    client_input[index] = message[1];
+    send_merged_input();
+    break;
+  case MUX_INPUT_KEYJAZZ:
+    m8_send_msg_keyjazz(message[1], message[2]);
+    break;
+  case MUX_INPUT_RESET:
+    m8_reset_display();
+    break;
+  default:
+    SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Unknown message type %d from viewer %d", message[0],
+                index);
+  }
+}
+
+static void read_client(const int index, const int device_connected) {
+  uint8_t buffer[96];
+  ssize_t received;
+  while ((received = recv(client_fds[index], buffer, sizeof(buffer), 0)) > 0) {
+    for (ssize_t i = 0; i < received; i++) {
+      client_pending[index][client_pending_length[index]++] = buffer[i];
+      if (client_pending_length[index] == 3) {
+        client_pending_length[index] = 0;
+        apply_input(index, client_pending[index], device_connected);
+      }
+    }
+  }
+  if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    drop_client(index);
+    if (device_connected) {
+      send_merged_input();
+    }
+  }
+}
+
+#endif // MUX_SUPPORTED
+
+int mux_start(void) {
+#ifdef MUX_SUPPORTED
+  int started = 1;
+  if (mode == MUX_DAEMON) {
+    started = daemon_start();
+  } else if (mode == MUX_CLIENT) {
+    started = client_start();
+  }
+  if (!started) {
+    mux_close();
+  }
+  return started;
+#else
+  return 1;
+#endif
+}
+
+void mux_publish(const uint8_t *data, const uint32_t length) {
+#ifdef MUX_SUPPORTED
+  if (mode != MUX_DAEMON || shared == NULL || length == 0 || length > MAX_MESSAGE_SIZE) {
+    return;
+  }
+  if (data[0] == system_info_command && length <= MUX_SYSTEM_INFO_SIZE) {
+    SDL_memcpy(shared->system_info, data, length);
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicInt(&shared->system_info_length, (int)length);
+  }
+  const uint32_t position = (uint32_t)SDL_GetAtomicInt(&shared->write_position);
+  const uint8_t header[2] = {(uint8_t)length, (uint8_t)(length >> 8)};
+  ring_write(position, header, sizeof(header));
+  ring_write(position + sizeof(header), data, length);
+  // Viewers must see the record before the position that covers it
+  SDL_MemoryBarrierRelease();
+  SDL_SetAtomicInt(&shared->write_position, (int)(position + sizeof(header) + length));
+#else
+  (void)data;
+  (void)length;
+#endif
+}
+
+void mux_daemon_poll(const int device_connected) {
+#ifdef MUX_SUPPORTED
+  if (mode != MUX_DAEMON || listen_fd < 0) {
+    return;
+  }
+  accept_clients();
+  for (int i = 0; i < MUX_MAX_CLIENTS; i++) {
+    if (client_fds[i] >= 0) {
+      read_client(i, device_connected);
+    }
+  }
+#else
+  (void)device_connected;
+#endif
+}
+
+int mux_client_process(void) {
+#ifdef MUX_SUPPORTED
+  uint8_t probe;
+  const ssize_t received = recv(daemon_fd, &probe, 1, 0);
+  if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    SDL_LogCritical(SDL_LOG_CATEGORY_SYSTEM, "The m8c daemon closed the connection");
+    return DEVICE_FATAL_ERROR;
+  }
+
+  const uint32_t write_position = (uint32_t)load_shared(&shared->write_position);
+  while (read_position != write_position) {
+    uint8_t header[2];
+    ring_read(read_position, header, sizeof(header));
+    const uint32_t length = header[0] | (uint32_t)header[1] << 8;
+    if (length <= MAX_MESSAGE_SIZE) {
+      ring_read(read_position + sizeof(header), packet, length);
+    }
+
+    // The record is only valid if the daemon didn't write over it while it was copied; the
+    // barrier keeps the copy above from being reordered after this second load
+    SDL_MemoryBarrierAcquire();
+    const uint32_t written = (uint32_t)load_shared(&shared->write_position) - read_position;
+    if (written > MUX_RING_SIZE - MUX_RECORD_MAX || length > MAX_MESSAGE_SIZE) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Viewer fell behind the m8c daemon, redrawing");
+      read_position = (uint32_t)load_shared(&shared->write_position);
+      send_to_daemon(MUX_INPUT_RESET, 0, 0);
+      break;
+    }
+    read_position += sizeof(header) + length;
+    process_command(packet, length);
+  }
+  return DEVICE_PROCESSING;
+#else
+  return DEVICE_FATAL_ERROR;
+#endif
+}
+
+int mux_send_msg_controller(const unsigned char input) {
+#ifdef MUX_SUPPORTED
+  if (mode == MUX_CLIENT) {
+    return send_to_daemon(MUX_INPUT_CONTROLLER, input, 0);
+  }
+  if (mode == MUX_DAEMON) {
+    local_input = input;
+    send_merged_input();
+    return 1;
+  }
+#endif
+  return m8_send_msg_controller(input);
+}
+
+int mux_send_msg_keyjazz(const unsigned char note, const unsigned char velocity) {
+#ifdef MUX_SUPPORTED
+  if (mode == MUX_CLIENT) {
+    return send_to_daemon(MUX_INPUT_KEYJAZZ, note, velocity);
+  }
+#endif
+  return m8_send_msg_keyjazz(note, velocity);
+}
+
+int mux_reset_display(void) {
+#ifdef MUX_SUPPORTED
+  if (mode == MUX_CLIENT) {
+    return send_to_daemon(MUX_INPUT_RESET, 0, 0);
+  }
+#endif
+  return m8_reset_display();
+}
+
+void mux_close(void) {
+#ifdef MUX_SUPPORTED
+  if (mode == MUX_DAEMON) {
+    for (int i = 0; i < MUX_MAX_CLIENTS; i++) {
+      if (client_fds[i] >= 0) {
+        close(client_fds[i]);
+        client_fds[i] = -1;
+      }
+    }
+    if (listen_fd >= 0) {
+      close(listen_fd);
+      listen_fd = -1;
+      unlink(socket_file);
+    }
+    if (shared != NULL) {
+      shm_unlink(shm_name);
+    }
+  }
+  if (daemon_fd >= 0) {
+    close(daemon_fd);
+    daemon_fd = -1;
+  }
+  if (shared != NULL) {
+    munmap(shared, sizeof(mux_shared_s));
+    shared = NULL;
+  }
+  mode = MUX_OFF;
+#endif
+}
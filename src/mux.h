@@ -0,0 +1,43 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Device multiplexer. One m8c instance, the daemon, owns the M8 through its backend and shares
+// the decoded command stream with viewer instances on the same machine. Every packet is
+// published once into a shared memory ring that viewers read on their own, so an additional
+// viewer costs the daemon nothing per packet. A Unix domain socket hands the ring out and carries
+// the viewers' input back to the daemon, where it is merged with the local input. Not available
+// on Windows.
+
+#ifndef MUX_H_
+#define MUX_H_
+
+#include <stdint.h>
+
+// Select the mode while parsing the command line
+void mux_configure_daemon(const char *socket_path);
+void mux_configure_client(const char *socket_path);
+
+// Start the configured mode, returns 1 on success or when the multiplexer is not used
+int mux_start(void);
+
+int mux_is_client(void);
+
+// Daemon: publish a packet received from the M8 to the viewers
+void mux_publish(const uint8_t *packet, uint32_t length);
+
+// Daemon: accept viewers and apply their input. Called from the main loop.
+void mux_daemon_poll(int device_connected);
+
+// Viewer: process the packets published since the last call. Returns DEVICE_PROCESSING, or
+// DEVICE_FATAL_ERROR when the daemon went away.
+int mux_client_process(void);
+
+// Send input to the M8: directly, merged with the viewers' input in the daemon, or through the
+// daemon in a viewer
+int mux_send_msg_controller(unsigned char input);
+int mux_send_msg_keyjazz(unsigned char note, unsigned char velocity);
+int mux_reset_display(void);
+
+void mux_close(void);
+
+#endif // MUX_H_
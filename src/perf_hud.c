@@ -0,0 +1,181 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "perf_hud.h"
+
+#include "SDL2_inprint.h"
+#include "fonts/fonts.h"
+#include "metrics.h"
+
+#define HUD_LINES 5
+#define HUD_LINE_MAX_CHARS 40
+#define HUD_UPDATE_INTERVAL_MS 250
+#define HUD_COLOR_OK 0xFFFFFF
+#define HUD_COLOR_ALERT 0xFF4040
+
+static SDL_Texture *hud_texture = NULL;
+static int hud_visible = 0;
+static int hud_needs_redraw = 0;
+static int hud_toggled = 0; // the screen needs one redraw to show or hide the HUD
+static Uint64 last_update_ms = 0;
+static metrics_snapshot_s last_snapshot;
+
+static char hud_lines[HUD_LINES][HUD_LINE_MAX_CHARS];
+static Uint32 hud_colors[HUD_LINES];
+
+// Format the rates between two snapshots, returns non-zero if any line changed
+static int format_lines(const metrics_snapshot_s *now, const metrics_snapshot_s *prev,
+                        const float seconds) {
+  char lines[HUD_LINES][HUD_LINE_MAX_CHARS];
+  Uint32 colors[HUD_LINES];
+  uint32_t rates[METRICS_PACKET_TYPES];
+
+  for (int i = 0; i < METRICS_PACKET_TYPES; i++) {
+    rates[i] = (uint32_t)((float)(now->packets[i] - prev->packets[i]) / seconds + 0.5f);
+  }
+  const uint32_t frames = now->frames - prev->frames;
+  const float present_ms =
+      frames > 0 ? (float)(now->present_us - prev->present_us) / (float)frames / 1000.0f : 0.0f;
+  const uint32_t new_errors = (now->slip_errors - prev->slip_errors) +
+                              (now->queue_drops - prev->queue_drops);
+
+  SDL_snprintf(lines[0], HUD_LINE_MAX_CHARS, "fps %5.1f present %5.2f ms",
+               (float)frames / seconds, present_ms);
+  colors[0] = HUD_COLOR_OK;
+  SDL_snprintf(lines[1], HUD_LINE_MAX_CHARS, "queue %u drop %u slip err %u", now->queue_depth,
+               now->queue_drops, now->slip_errors);
+  colors[1] = new_errors > 0 ? HUD_COLOR_ALERT : HUD_COLOR_OK;
+  SDL_snprintf(lines[2], HUD_LINE_MAX_CHARS, "pkt/s rect %u text %u", rates[METRICS_PACKET_RECT],
+               rates[METRICS_PACKET_TEXT]);
+  colors[2] = HUD_COLOR_OK;
+  SDL_snprintf(lines[3], HUD_LINE_MAX_CHARS, "wave %u joy %u sys %u other %u",
+               rates[METRICS_PACKET_WAVEFORM], rates[METRICS_PACKET_JOYPAD],
+               rates[METRICS_PACKET_SYSTEM], rates[METRICS_PACKET_OTHER]);
+  colors[3] = HUD_COLOR_OK;
+  SDL_snprintf(lines[4], HUD_LINE_MAX_CHARS, "audio %.1f KB underruns %u",
+               (float)now->audio_fill / 1024.0f, now->audio_underruns);
+  colors[4] = now->audio_underruns != prev->audio_underruns ? HUD_COLOR_ALERT : HUD_COLOR_OK;
+
+  int changed = 0;
+  for (int i = 0; i < HUD_LINES; i++) {
+    if (colors[i] != hud_colors[i] || SDL_strcmp(lines[i], hud_lines[i]) != 0) {
+      SDL_strlcpy(hud_lines[i], lines[i], HUD_LINE_MAX_CHARS);
+      hud_colors[i] = colors[i];
+      changed = 1;
+    }
+  }
+  return changed;
+}
+
+void perf_hud_toggle(void) {
+  hud_visible = !hud_visible;
+  hud_toggled = 1;
+  if (hud_visible) {
+    // Start a fresh interval so the first rates are not averaged over the hidden period
+    metrics_snapshot(&last_snapshot);
+    last_update_ms = SDL_GetTicks();
+    SDL_zero(hud_lines);
+    hud_needs_redraw = 1;
+  }
+}
+
+int perf_hud_is_visible(void) { return hud_visible; }
+
+int perf_hud_update(void) {
+  if (hud_toggled) {
+    hud_toggled = 0;
+    return 1;
+  }
+  if (!hud_visible) {
+    return 0;
+  }
+  const Uint64 now_ms = SDL_GetTicks();
+  if (now_ms - last_update_ms < HUD_UPDATE_INTERVAL_MS) {
+    return 0;
+  }
+
+  metrics_snapshot_s snapshot;
+  metrics_snapshot(&snapshot);
+  const float seconds = (float)(now_ms - last_update_ms) / 1000.0f;
+  if (format_lines(&snapshot, &last_snapshot, seconds)) {
+    hud_needs_redraw = 1;
+  }
+  last_snapshot = snapshot;
+  last_update_ms = now_ms;
+  return hud_needs_redraw;
+}
+
+void perf_hud_invalidate(void) {
+  if (hud_texture != NULL) {
+    SDL_DestroyTexture(hud_texture);
+    hud_texture = NULL;
+  }
+  hud_needs_redraw = 1;
+}
+
+void perf_hud_destroy(void) {
+  perf_hud_invalidate();
+  hud_visible = 0;
+}
+
+void perf_hud_render(SDL_Renderer *renderer, const int logical_texture_width,
+                     const SDL_ScaleMode scale_mode, const int font_mode_current) {
+  if (!hud_visible) {
+    return;
+  }
+
+  const struct inline_font *font_small = fonts_get(0);
+  if (font_small == NULL) {
+    return;
+  }
+  const int margin = 2;
+  const int line_height = font_small->glyph_y + 1;
+  const int hud_width =
+      SDL_min(logical_texture_width, HUD_LINE_MAX_CHARS * (font_small->glyph_x + 1) + margin * 2);
+  const int hud_height = HUD_LINES * line_height + margin * 2;
+
+  if (hud_texture == NULL) {
+    hud_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                    hud_width, hud_height);
+    if (hud_texture == NULL) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't create HUD texture: %s", SDL_GetError());
+      return;
+    }
+    SDL_SetTextureBlendMode(hud_texture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(hud_texture, scale_mode);
+    hud_needs_redraw = 1;
+  }
+
+  // Only update the HUD texture when its contents changed
+  if (hud_needs_redraw) {
+    hud_needs_redraw = 0;
+
+    SDL_Texture *prev_target = SDL_GetRenderTarget(renderer);
+    if (!SDL_SetRenderTarget(renderer, hud_texture)) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to set render target: %s", SDL_GetError());
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
+    SDL_RenderClear(renderer);
+
+    inline_font_initialize(font_small);
+    for (int i = 0; i < HUD_LINES; i++) {
+      inprint(renderer, hud_lines[i], margin, margin + i * line_height, hud_colors[i],
+              hud_colors[i]);
+    }
+    inline_font_initialize(fonts_get(font_mode_current));
+    SDL_SetRenderTarget(renderer, prev_target);
+  }
+
+  // Placed in logical pixels, scaled to the size of the current target
+  float scale = 1.0f;
+  SDL_Texture *target = SDL_GetRenderTarget(renderer);
+  if (target != NULL) {
+    float target_w, target_h;
+    SDL_GetTextureSize(target, &target_w, &target_h);
+    scale = target_w / (float)logical_texture_width;
+  }
+  const SDL_FRect dest = {0, 0, (float)hud_width * scale, (float)hud_height * scale};
+  if (!SDL_RenderTexture(renderer, hud_texture, NULL, &dest)) {
+    SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't render HUD texture: %s", SDL_GetError());
+  }
+}
@@ -0,0 +1,30 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#ifndef PERF_HUD_H_
+#define PERF_HUD_H_
+
+#include "sdl_compat.h"
+
+// Toggle HUD visibility
+void perf_hud_toggle(void);
+
+// Return non-zero if the HUD is currently visible
+int perf_hud_is_visible(void);
+
+// Sample the metrics at most a few times per second. Returns non-zero if the displayed values
+// changed and the screen needs to be redrawn.
+int perf_hud_update(void);
+
+// Invalidate the cached texture (e.g., after texture size change)
+void perf_hud_invalidate(void);
+
+// Destroy internal resources used by the HUD
+void perf_hud_destroy(void);
+
+// Composite the HUD to the current render target, redrawing its texture if the values changed.
+// font_mode_current is used to restore the caller's font after drawing.
+void perf_hud_render(SDL_Renderer *renderer, int logical_texture_width, SDL_ScaleMode scale_mode,
+                     int font_mode_current);
+
+#endif // PERF_HUD_H_
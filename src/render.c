@@ -8,17 +8,39 @@
 #include "SDL2_inprint.h"
 #include "command.h"
 #include "config.h"
+#include "framebuffer.h"
 #include "fx_cube.h"
+#include "alloc_stats.h"
+#include "audio_meter.h"
+#include "latency.h"
 #include "log_overlay.h"
+#include "metrics.h"
+#include "perf_hud.h"
 #include "settings.h"
+#include "shm_export.h"
+#include "terminal.h"
+#include "trace.h"
+#include "vnc_server.h"
 
+#include "fonts/font_glyphs.h"
 #include "fonts/fonts.h"
 
 #include <stdlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RENDER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RENDER_NEON
+#endif
+
+#define WAVEFORM_MAX_SAMPLES 480
+
 static SDL_Window *win;
 static SDL_Renderer *rend;
-static SDL_Texture *main_texture;
+static SDL_Texture *main_texture; // render target of the screensaver
+static SDL_Texture *frame_texture = NULL; // streaming copy of the M8 display framebuffer
 static SDL_Texture *hd_texture = NULL;
 static SDL_Color global_background_color = (SDL_Color){.r = 0x00, .g = 0x00, .b = 0x00, .a = 0x00};
 static SDL_RendererLogicalPresentation window_scaling_mode = SDL_LOGICAL_PRESENTATION_INTEGER_SCALE;
@@ -31,6 +53,14 @@ static unsigned int m8_hardware_model = 0;
 static int screen_offset_y = 0;
 static int text_offset_y = 0;
 static int waveform_max_height = 24;
+static unsigned int waveform_lines = 0; // join the oscilloscope points into a line strip
+
+// The oscilloscope on screen: its samples as received and clamped to the waveform height
+static uint8_t waveform_samples[WAVEFORM_MAX_SAMPLES];
+static uint8_t waveform_points[WAVEFORM_MAX_SAMPLES];
+static int waveform_size = 0;
+static int waveform_stale = 1; // the waveform area was drawn over since the waveform was drawn
+static uint32_t waveform_color = 0;
 
 // Log overlay moved to log_overlay.c
 
@@ -39,6 +69,8 @@ static int texture_height = 240;
 static int hd_texture_width, hd_texture_height = 0;
 
 static int screensaver_initialized = 0;
+static int headless = 0; // no window or renderer, the M8 display is only drawn to the framebuffer
+static int window_hidden = 0; // minimized or occluded, nothing is drawn on the GPU
 
 uint8_t fullscreen = 0;
 
@@ -63,6 +95,7 @@ void setup_hd_texture_scaling(void) {
   // SDL forces black borders in letterbox mode, so in HD mode the texture scaling is manual
   SDL_SetRenderLogicalPresentation(rend, 0, 0, SDL_LOGICAL_PRESENTATION_DISABLED);
   SDL_SetTextureScaleMode(main_texture, SDL_SCALEMODE_NEAREST);
+  SDL_SetTextureScaleMode(frame_texture, SDL_SCALEMODE_NEAREST);
 
   // Check the aspect ratio to avoid unnecessary antialiasing
   if (texture_aspect_ratio == window_aspect_ratio) {
@@ -125,8 +158,39 @@ static void create_hd_texture(void) {
   setup_hd_texture_scaling();
 }
 
+static uint32_t background_rgb(void) {
+  return global_background_color.r << 16 | global_background_color.g << 8 |
+         global_background_color.b;
+}
+
+// Mark the waveform stale if a rectangle covers part of it, so the next one is drawn even if its
+// samples are unchanged
+static void waveform_check_overdraw(const int x, const int y, const int w, const int h) {
+  if (x + w > texture_width - waveform_size && y <= waveform_max_height && y + h > 0) {
+    waveform_stale = 1;
+  }
+}
+
+// Create the M8 display framebuffer and the texture it is uploaded to at the current size
+static int create_frame_texture(void) {
+  if (frame_texture != NULL) {
+    SDL_DestroyTexture(frame_texture);
+  }
+  frame_texture = SDL_CreateTexture(rend, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                    texture_width, texture_height);
+  if (frame_texture == NULL) {
+    SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't create frame texture: %s", SDL_GetError());
+    return 0;
+  }
+  SDL_SetTextureScaleMode(frame_texture, texture_scaling_mode);
+  waveform_stale = 1;
+  return framebuffer_init(texture_width, texture_height, background_rgb());
+}
+
 static void change_font(const unsigned int index) {
-  inline_font_close();
+  if (headless) {
+    return; // the framebuffer draws from the glyph tables, the font atlas is not needed
+  }
   inline_font_set_renderer(rend);
   inline_font_initialize(fonts_get(index));
 }
@@ -150,6 +214,13 @@ static void check_and_adjust_window_and_texture_size(const int new_width, const
   texture_width = new_width;
   texture_height = new_height;
 
+  if (headless) {
+    waveform_stale = 1;
+    framebuffer_init(texture_width, texture_height, background_rgb());
+    terminal_resize(texture_width, texture_height);
+    return;
+  }
+
   // Query window size and resize if smaller than default
   SDL_GetWindowSize(win, &window_w, &window_h);
   if (window_w < texture_width * 2 || window_h < texture_height * 2) {
@@ -168,11 +239,13 @@ static void check_and_adjust_window_and_texture_size(const int new_width, const
 
   // Notify log overlay to drop its cached texture so it can be recreated with the new size
   log_overlay_invalidate();
+  perf_hud_invalidate();
 
   main_texture = SDL_CreateTexture(rend, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
                                    texture_width, texture_height);
   SDL_SetTextureScaleMode(main_texture, texture_scaling_mode);
   SDL_SetRenderTarget(rend, main_texture);
+  create_frame_texture();
 
   // Notify settings overlay about logical render size change so it can recreate its cache
   settings_on_texture_size_change(rend);
@@ -206,6 +279,7 @@ void renderer_set_font_mode(int mode) {
   screen_offset_y = new_font->screen_offset_y;
   text_offset_y = new_font->text_offset_y;
   waveform_max_height = new_font->waveform_max_height;
+  waveform_stale = 1;
 
   change_font(mode);
   SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "Font mode %i, Screen offset %i", mode, screen_offset_y);
@@ -213,19 +287,34 @@ void renderer_set_font_mode(int mode) {
 
 void renderer_close(void) {
   SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "Closing renderer");
+  if (headless) {
+    terminal_close();
+    framebuffer_close();
+    return;
+  }
   inline_font_close();
   if (main_texture != NULL) {
     SDL_DestroyTexture(main_texture);
   }
+  if (frame_texture != NULL) {
+    SDL_DestroyTexture(frame_texture);
+    frame_texture = NULL;
+  }
+  framebuffer_close();
   if (hd_texture != NULL) {
     SDL_DestroyTexture(hd_texture);
   }
   log_overlay_destroy();
+  audio_meter_destroy();
+  perf_hud_destroy();
   SDL_DestroyRenderer(rend);
   SDL_DestroyWindow(win);
 }
 
 int toggle_fullscreen(config_params_s *conf) {
+  if (headless) {
+    return 0;
+  }
 
   const unsigned long fullscreen_state = SDL_GetWindowFlags(win) & SDL_WINDOW_FULLSCREEN;
   SDL_SetWindowFullscreen(win, fullscreen_state ? false : true);
@@ -255,10 +344,15 @@ int draw_character(struct draw_character_command *command) {
      background. Due to the font bitmaps, a different pixel offset is needed for
      both*/
 
-  inprint(rend, (char *)&command->c, command->pos.x,
-          command->pos.y + text_offset_y + screen_offset_y, fgcolor, bgcolor);
-
-  dirty = 1;
+  const uint64_t trace_start = trace_begin();
+  const char text[2] = {(char)command->c, '\0'};
+  const struct inline_font *font = fonts_get(font_mode);
+  const int y = command->pos.y + text_offset_y + screen_offset_y;
+  framebuffer_print(font_glyphs_get(font_mode), text, command->pos.x, y, font->glyph_x,
+                    font->glyph_y, fgcolor, bgcolor);
+  terminal_print(text, command->pos.x, y, font->glyph_x, font->glyph_y, fgcolor, bgcolor);
+  waveform_check_overdraw(command->pos.x, y, font->glyph_x, font->glyph_y);
+  trace_end_batched("draw_character", trace_start, 50);
 
   return 1;
 }
@@ -290,84 +384,93 @@ void draw_rectangle(struct draw_rectangle_command *command) {
 #endif
   }
 
-  SDL_SetRenderDrawColor(rend, command->color.r, command->color.g, command->color.b, 0xFF);
-  SDL_RenderFillRect(rend, &render_rect);
+  const uint32_t color = command->color.r << 16 | command->color.g << 8 | command->color.b;
+  framebuffer_fill_rect(command->pos.x, command->pos.y + screen_offset_y, command->size.width,
+                        command->size.height, color);
+  terminal_fill_rect(command->pos.x, command->pos.y + screen_offset_y, command->size.width,
+                     command->size.height, color);
+  waveform_check_overdraw(command->pos.x, command->pos.y + screen_offset_y, command->size.width,
+                          command->size.height);
+}
 
-  dirty = 1;
+// Copy samples, limiting them to the waveform height to avoid random glitches
+static void clamp_samples(const uint8_t *src, uint8_t *dst, const int count, const uint8_t max) {
+  int i = 0;
+#if defined(RENDER_SSE2)
+  const __m128i limit = _mm_set1_epi8((char)max);
+  for (; i + 16 <= count; i += 16) {
+    const __m128i samples = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_min_epu8(samples, limit));
+  }
+#elif defined(RENDER_NEON)
+  const uint8x16_t limit = vdupq_n_u8(max);
+  for (; i + 16 <= count; i += 16) {
+    vst1q_u8(dst + i, vminq_u8(vld1q_u8(src + i), limit));
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = SDL_min(src[i], max);
+  }
 }
 
 void draw_waveform(struct draw_oscilloscope_waveform_command *command) {
+  const int size = SDL_min(command->waveform_size, WAVEFORM_MAX_SAMPLES);
+  const uint32_t color = command->color.r << 16 | command->color.g << 8 | command->color.b;
 
-  static uint8_t wfm_cleared = 0;
-  static int prev_waveform_size = 0;
-
-  // If the waveform is not being displayed, and it's already been cleared, skip rendering it
-  if (!(wfm_cleared && command->waveform_size == 0)) {
-
-    SDL_FRect wf_rect;
-    if (command->waveform_size > 0) {
-      wf_rect.x = (float)(texture_width - command->waveform_size);
-      wf_rect.y = 0;
-      wf_rect.w = command->waveform_size;
-      wf_rect.h = (float)(waveform_max_height + 1);
-    } else {
-      wf_rect.x = (float)(texture_width - prev_waveform_size);
-      wf_rect.y = 0;
-      wf_rect.w = (float)prev_waveform_size;
-      wf_rect.h = (float)(waveform_max_height + 1);
-    }
-    prev_waveform_size = command->waveform_size;
-
-    SDL_SetRenderDrawColor(rend, global_background_color.r, global_background_color.g,
-                           global_background_color.b, global_background_color.a);
-    SDL_RenderFillRect(rend, &wf_rect);
-
-    SDL_SetRenderDrawColor(rend, command->color.r, command->color.g, command->color.b, 255);
-
-    // Create an SDL_Point array of the waveform pixels for batch drawing
-    SDL_FPoint waveform_points[command->waveform_size];
-
-    for (int i = 0; i < command->waveform_size; i++) {
-      // Limit value to avoid random glitches
-      if (command->waveform[i] > waveform_max_height) {
-        command->waveform[i] = waveform_max_height;
-      }
-      waveform_points[i].x = (float)i + wf_rect.x;
-      waveform_points[i].y = command->waveform[i];
-    }
-
-    SDL_RenderPoints(rend, waveform_points, command->waveform_size);
+  // The M8 sends the oscilloscope every frame, most of the time with the same samples, e.g. an
+  // empty waveform while stopped
+  if (!waveform_stale && size == waveform_size && color == waveform_color &&
+      SDL_memcmp(command->waveform, waveform_samples, size) == 0) {
+    return;
+  }
 
-    // The packet we just drew was an empty waveform
-    if (command->waveform_size == 0) {
-      wfm_cleared = 1;
-    } else {
-      wfm_cleared = 0;
-    }
+  // Clear the area of the new waveform, or of the previous one when it is hidden
+  const int clear_width = size > 0 ? size : waveform_size;
+  framebuffer_fill_rect(texture_width - clear_width, 0, clear_width, waveform_max_height + 1,
+                        background_rgb());
+  terminal_fill_rect(texture_width - clear_width, 0, clear_width, waveform_max_height + 1,
+                     background_rgb());
+
+  SDL_memcpy(waveform_samples, command->waveform, size);
+  clamp_samples(waveform_samples, waveform_points, size, (uint8_t)waveform_max_height);
+  framebuffer_plot(texture_width - size, waveform_points, size, color, (int)waveform_lines);
+  terminal_plot(texture_width - size, waveform_points, size, color, (int)waveform_lines);
+  waveform_size = size;
+  waveform_color = color;
+  waveform_stale = 0;
+}
 
-    dirty = 1;
-  }
+void renderer_set_waveform_lines(const unsigned int enabled) {
+  waveform_lines = enabled;
+  waveform_stale = 1; // redraw with the next waveform
 }
 
 void display_keyjazz_overlay(const uint8_t show, const uint8_t base_octave,
                              const uint8_t velocity) {
 
-  const Uint16 overlay_offset_x = texture_width - (fonts_get(font_mode)->glyph_x * 7 + 1);
-  const Uint16 overlay_offset_y = texture_height - (fonts_get(font_mode)->glyph_y + 1);
-  const Uint32 bg_color =
-      global_background_color.r << 16 | global_background_color.g << 8 | global_background_color.b;
+  const struct inline_font *font = fonts_get(font_mode);
+  const struct font_glyphs *glyphs = font_glyphs_get(font_mode);
+  const Uint16 overlay_offset_x = texture_width - (font->glyph_x * 7 + 1);
+  const Uint16 overlay_offset_y = texture_height - (font->glyph_y + 1);
+  const Uint32 bg_color = background_rgb();
 
   if (show) {
     char overlay_text[7];
     SDL_snprintf(overlay_text, sizeof(overlay_text), "%02X %u", velocity, base_octave);
-    inprint(rend, overlay_text, overlay_offset_x, overlay_offset_y, 0xC8C8C8, bg_color);
-    inprint(rend, "*", overlay_offset_x + (fonts_get(font_mode)->glyph_x * 5 + 5), overlay_offset_y,
-            0xFF0000, bg_color);
+    framebuffer_print(glyphs, overlay_text, overlay_offset_x, overlay_offset_y, font->glyph_x,
+                      font->glyph_y, 0xC8C8C8, bg_color);
+    framebuffer_print(glyphs, "*", overlay_offset_x + (font->glyph_x * 5 + 5), overlay_offset_y,
+                      font->glyph_x, font->glyph_y, 0xFF0000, bg_color);
+    terminal_print(overlay_text, overlay_offset_x, overlay_offset_y, font->glyph_x, font->glyph_y,
+                   0xC8C8C8, bg_color);
+    terminal_print("*", overlay_offset_x + (font->glyph_x * 5 + 5), overlay_offset_y,
+                   font->glyph_x, font->glyph_y, 0xFF0000, bg_color);
   } else {
-    inprint(rend, "      ", overlay_offset_x, overlay_offset_y, 0xC8C8C8, bg_color);
+    framebuffer_print(glyphs, "      ", overlay_offset_x, overlay_offset_y, font->glyph_x,
+                      font->glyph_y, 0xC8C8C8, bg_color);
+    terminal_print("      ", overlay_offset_x, overlay_offset_y, font->glyph_x, font->glyph_y,
+                   0xC8C8C8, bg_color);
   }
-
-  dirty = 1;
 }
 
 static void log_fps_stats(void) {
@@ -377,15 +480,39 @@ static void log_fps_stats(void) {
     ticks_fps = SDL_GetTicks();
     SDL_LogDebug(SDL_LOG_CATEGORY_VIDEO, "%.1f fps\n", (float)fps / 5);
     fps = 0;
+    latency_log_summary();
+    alloc_stats_log_summary();
   }
 }
 
 // Initializes SDL and creates a renderer and required surfaces
+// Without a window the draw commands are only applied to the framebuffer, which is read through
+// screenshots
+static int initialize_headless(void) {
+  if (SDL_Init(SDL_INIT_EVENTS) == false) {
+    SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "SDL_Init: %s", SDL_GetError());
+    return 0;
+  }
+  headless = 1;
+  if (!framebuffer_init(texture_width, texture_height, background_rgb())) {
+    return 0;
+  }
+  renderer_set_font_mode(0);
+  SDL_Log("Running headless, no window is opened");
+  return 1;
+}
+
 int renderer_initialize(config_params_s *conf) {
 
   // SDL documentation recommends this
   atexit(SDL_Quit);
 
+  waveform_lines = conf->waveform_lines;
+  if (conf->headless) {
+    return initialize_headless() &&
+           (!conf->terminal || terminal_open(texture_width, texture_height));
+  }
+
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) == false) {
     SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "SDL_Init: %s", SDL_GetError());
     return 0;
@@ -424,6 +551,10 @@ int renderer_initialize(config_params_s *conf) {
 
   SDL_SetTextureScaleMode(main_texture, texture_scaling_mode);
 
+  if (!create_frame_texture()) {
+    return false;
+  }
+
   SDL_SetRenderTarget(rend, main_texture);
 
   SDL_SetRenderDrawColor(rend, global_background_color.r, global_background_color.g,
@@ -448,9 +579,49 @@ int renderer_initialize(config_params_s *conf) {
   return 1;
 }
 
+// Hand the frame's dirty rectangles to the shared memory export and the VNC viewers
+static void export_frame(void) {
+  shm_export_frame();
+  vnc_server_frame();
+}
+
 void render_screen(config_params_s *conf) {
-  if (!dirty && !settings_is_open()) {
-    // No draw commands and settings overlay not active, skip rendering
+  metrics_count_render_call();
+
+  if (headless) {
+    // Nothing to composite, a frame is complete once its changes are in the framebuffer
+    if (framebuffer_commit()) {
+      export_frame();
+      framebuffer_reset_dirty_rects();
+      latency_frame_presented();
+      log_fps_stats();
+    }
+    terminal_present();
+    return;
+  }
+
+  if (window_hidden) {
+    // Draw commands keep updating the framebuffer, it is uploaded in one piece when the window
+    // is visible again. The exports still get every frame.
+    if (framebuffer_commit()) {
+      export_frame();
+      framebuffer_reset_dirty_rects();
+    }
+    return;
+  }
+
+  if (perf_hud_update()) {
+    dirty = 1;
+  }
+
+  // Draw commands only need a new frame if they changed pixels, e.g. an identical waveform
+  // doesn't
+  if (framebuffer_commit()) {
+    dirty = 1;
+  }
+
+  if (!dirty && !settings_is_open() && !audio_meter_is_visible()) {
+    // No draw commands and no animated overlay active, skip rendering
     return;
   }
 
@@ -460,6 +631,13 @@ void render_screen(config_params_s *conf) {
   }
 
   dirty = 0;
+  const uint64_t trace_start = trace_begin();
+
+  // The screensaver draws on the main texture, the M8 display is drawn on the CPU and only
+  // its changed regions are uploaded
+  SDL_Texture *screen_texture = screensaver_initialized ? main_texture : frame_texture;
+  export_frame();
+  framebuffer_upload(frame_texture);
 
   if (!SDL_SetRenderTarget(rend, NULL)) {
     SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't set renderer target to window: %s",
@@ -479,13 +657,19 @@ void render_screen(config_params_s *conf) {
     SDL_SetRenderTarget(rend, NULL);
 
     // Direct rendering with integer scaling
-    if (!SDL_RenderTexture(rend, main_texture, NULL, NULL)) {
+    if (!SDL_RenderTexture(rend, screen_texture, NULL, NULL)) {
       SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't render texture: %s", SDL_GetError());
     }
 
     // Render log overlay (composites if visible)
     log_overlay_render(rend, texture_width, texture_height, texture_scaling_mode, font_mode);
 
+    // Audio meters are redrawn every frame while visible
+    audio_meter_render(rend, texture_width, texture_height);
+
+    // Performance HUD, its texture is only redrawn when the values change
+    perf_hud_render(rend, texture_width, texture_scaling_mode, font_mode);
+
     // Settings overlay composited last
     if (settings_is_open()) {
       settings_render_overlay(rend, conf, texture_width, texture_height);
@@ -521,7 +705,7 @@ void render_screen(config_params_s *conf) {
     }
 
     // Render the main texture to hd_texture. It has the same aspect ratio, so a NULL rect works.
-    if (!SDL_RenderTexture(rend, main_texture, NULL, NULL)) {
+    if (!SDL_RenderTexture(rend, screen_texture, NULL, NULL)) {
       SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't render main texture to HD texture: %s",
                       SDL_GetError());
     }
@@ -529,6 +713,12 @@ void render_screen(config_params_s *conf) {
     // Render log overlay (composites if visible)
     log_overlay_render(rend, texture_width, texture_height, texture_scaling_mode, font_mode);
 
+    // Audio meters are redrawn every frame while visible
+    audio_meter_render(rend, texture_width, texture_height);
+
+    // Performance HUD, its texture is only redrawn when the values change
+    perf_hud_render(rend, texture_width, texture_scaling_mode, font_mode);
+
     // Settings overlay composited last
     if (settings_is_open()) {
       settings_render_overlay(rend, conf, texture_width, texture_height);
@@ -566,9 +756,13 @@ void render_screen(config_params_s *conf) {
     }
   }
 
+  const uint64_t present_start = SDL_GetTicksNS();
   if (!SDL_RenderPresent(rend)) {
     SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't present renderer: %s", SDL_GetError());
   }
+  metrics_record_present(SDL_GetTicksNS() - present_start);
+  trace_end("SDL_RenderPresent", trace_start != 0 ? present_start : 0);
+  latency_frame_presented();
 
   if (!SDL_SetRenderTarget(rend, main_texture)) {
     SDL_LogCritical(SDL_LOG_CATEGORY_RENDER, "Couldn't set renderer target to texture: %s",
@@ -576,10 +770,11 @@ void render_screen(config_params_s *conf) {
   }
 
   log_fps_stats();
+  trace_end("render_screen", trace_start);
 }
 
 int screensaver_init(void) {
-  if (screensaver_initialized) {
+  if (screensaver_initialized || headless) {
     return 1;
   }
   SDL_SetRenderTarget(rend, main_texture);
@@ -594,9 +789,16 @@ int screensaver_init(void) {
   return 1;
 }
 
-void screensaver_draw(void) { dirty = fx_cube_update(); }
+void screensaver_draw(void) {
+  if (!headless && !window_hidden) {
+    dirty = fx_cube_update();
+  }
+}
 
 void screensaver_destroy(void) {
+  if (headless) {
+    return;
+  }
   fx_cube_destroy();
   renderer_set_font_mode(0);
   SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Screensaver destroyed");
@@ -604,6 +806,9 @@ void screensaver_destroy(void) {
 }
 
 void renderer_fix_texture_scaling_after_window_resize(config_params_s *conf) {
+  if (headless) {
+    return;
+  }
   SDL_SetRenderTarget(rend, NULL);
   if (conf->integer_scaling) {
     // SDL internal integer scaling works well for this purpose
@@ -616,13 +821,37 @@ void renderer_fix_texture_scaling_after_window_resize(config_params_s *conf) {
     setup_hd_texture_scaling();
   }
   SDL_SetTextureScaleMode(main_texture, texture_scaling_mode);
+  SDL_SetTextureScaleMode(frame_texture, texture_scaling_mode);
+}
+
+void renderer_set_window_visible(const int visible) {
+  if (visible == !window_hidden) {
+    return;
+  }
+  window_hidden = !visible;
+  if (visible) {
+    framebuffer_invalidate();
+    dirty = 1;
+  }
+  SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, visible ? "Window visible, rendering resumed"
+                                                : "Window hidden, rendering paused");
 }
 
 void show_error_message(const char *message) {
+  if (headless) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", message);
+    return;
+  }
   SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "m8c error", message, win);
 }
 
 void renderer_clear_screen(void) {
+  framebuffer_fill_rect(0, 0, texture_width, texture_height, background_rgb());
+  terminal_fill_rect(0, 0, texture_width, texture_height, background_rgb());
+  waveform_stale = 1;
+  if (headless) {
+    return;
+  }
   SDL_SetRenderDrawColor(rend, global_background_color.r, global_background_color.g,
                          global_background_color.b, global_background_color.a);
   SDL_SetRenderTarget(rend, main_texture);
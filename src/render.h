@@ -15,7 +15,12 @@ void renderer_set_font_mode(int mode);
 void renderer_fix_texture_scaling_after_window_resize(config_params_s *conf);
 void renderer_clear_screen(void);
 
+// Pause all GPU work while the window is minimized or occluded, and rebuild the screen from the
+// framebuffer when it is visible again
+void renderer_set_window_visible(int visible);
+
 void draw_waveform(struct draw_oscilloscope_waveform_command *command);
+void renderer_set_waveform_lines(unsigned int enabled);
 void draw_rectangle(struct draw_rectangle_command *command);
 int draw_character(struct draw_character_command *command);
 
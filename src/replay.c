@@ -0,0 +1,100 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "replay.h"
+#include "alloc_stats.h"
+#include "backends/queue.h"
+#include "backends/slip.h"
+#include "command.h"
+#include "render.h"
+#include "sdl_compat.h"
+
+#define REPLAY_READ_SIZE 1024 // bytes fed per frame, the size of one serial read
+
+extern message_queue_s queue; // defined by every backend
+
+static const char *capture_file = NULL;
+static uint8_t slip_buffer[REPLAY_READ_SIZE];
+static slip_handler_s slip;
+
+static int queue_message(uint8_t *data, const uint32_t size) {
+  push_message(&queue, data, size);
+  return 1;
+}
+
+void replay_configure(const char *capture_path) {
+  capture_file = capture_path;
+  // Allocations are only counted with the counting allocators in place
+  alloc_stats_install();
+}
+
+int replay_is_enabled(void) { return capture_file != NULL; }
+
+// Feed the capture one read at a time, processing and rendering after each read like the
+// main loop does. Returns the number of processed packets.
+static unsigned int replay_pass(const uint8_t *data, const size_t size, config_params_s *conf) {
+  unsigned int packets = 0;
+
+  for (size_t offset = 0; offset < size; offset += REPLAY_READ_SIZE) {
+    const size_t end = SDL_min(size, offset + REPLAY_READ_SIZE);
+    for (size_t i = offset; i < end; i++) {
+      slip_read_byte(&slip, data[i]);
+    }
+
+    const alloc_tag_t previous_tag = alloc_stats_push_tag(ALLOC_TAG_RENDER);
+    const unsigned char *command;
+    size_t length = 0;
+    while ((command = pop_message(&queue, &length)) != NULL) {
+      if (length > 0) {
+        process_command(command, length);
+        packets++;
+      }
+    }
+    render_screen(conf);
+    alloc_stats_pop_tag(previous_tag);
+  }
+  return packets;
+}
+
+int replay_run(config_params_s *conf) {
+  size_t size = 0;
+  uint8_t *data = SDL_LoadFile(capture_file, &size);
+  if (data == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't load capture %s: %s", capture_file,
+                 SDL_GetError());
+    return 0;
+  }
+
+  static const slip_descriptor_s slip_descriptor = {
+      .buf = slip_buffer,
+      .buf_size = sizeof(slip_buffer),
+      .recv_message = queue_message,
+  };
+  slip_init(&slip, &slip_descriptor);
+  init_queue(&queue);
+
+  replay_pass(data, size, conf);
+  alloc_stats_reset();
+  const unsigned int packets = replay_pass(data, size, conf);
+  // Only the allocations of this thread count, the pipeline being replayed runs on it
+  const uint64_t allocations = alloc_stats_thread_total();
+
+  SDL_Log("Replay: %u packets from %s, %llu allocations after warm-up", packets, capture_file,
+          (unsigned long long)allocations);
+  for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+    const uint64_t count = alloc_stats_thread_count((alloc_tag_t)i);
+    if (count > 0) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Replay: %llu allocations in %s",
+                   (unsigned long long)count, alloc_stats_tag_name((alloc_tag_t)i));
+    }
+  }
+
+  destroy_queue(&queue);
+  SDL_free(data);
+
+  if (packets == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Replay: no packets decoded from %s", capture_file);
+    return 0;
+  }
+  return allocations == 0;
+}
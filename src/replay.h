@@ -0,0 +1,26 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Replays a capture of the raw serial byte stream of the M8 through SLIP decoding, the message
+// queue, command processing and rendering. The capture is played twice: the first pass warms
+// up every buffer, the second one must not allocate at all.
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "config.h"
+
+// Select the capture to replay, called while parsing the command line
+void replay_configure(const char *capture_path);
+
+int replay_is_enabled(void);
+
+/**
+ * Run the replay self-check.
+ *
+ * @param conf Configuration used for rendering.
+ * @return 1 if the measured pass did not allocate, 0 on allocations or errors.
+ */
+int replay_run(config_params_s *conf);
+
+#endif // REPLAY_H_
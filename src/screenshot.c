@@ -0,0 +1,83 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "screenshot.h"
+#include "framebuffer.h"
+#include "sdl_compat.h"
+
+#include <signal.h>
+#include <stdio.h>
+
+static const char *screenshot_path = NULL;
+static volatile sig_atomic_t screenshot_requested = 0;
+
+#ifdef SIGUSR1
+static void handle_sigusr1(const int signal_number) {
+  (void)signal_number;
+  screenshot_requested = 1;
+}
+#endif
+
+void screenshot_configure(const char *path) {
+  screenshot_path = path;
+#ifdef SIGUSR1
+  signal(SIGUSR1, handle_sigusr1);
+  SDL_Log("Writing a screenshot to %s on SIGUSR1 and at exit", path);
+#else
+  SDL_Log("Writing a screenshot to %s at exit", path);
+#endif
+}
+
+int screenshot_save(const char *path) {
+  const uint32_t *pixels = framebuffer_argb();
+  if (pixels == NULL) {
+    return 0;
+  }
+  SDL_Surface *surface =
+      SDL_CreateSurfaceFrom(framebuffer_width(), framebuffer_height(), SDL_PIXELFORMAT_ARGB8888,
+                            (void *)pixels, framebuffer_width() * (int)sizeof(uint32_t));
+  if (surface == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't create screenshot surface: %s",
+                 SDL_GetError());
+    return 0;
+  }
+
+  // Write a temporary file and rename it, so that readers never see a partial image
+  char temp_path[1024];
+  SDL_snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+  const int saved = SDL_SaveBMP(surface, temp_path);
+  SDL_DestroySurface(surface);
+  if (!saved) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't write screenshot %s: %s", temp_path,
+                 SDL_GetError());
+    return 0;
+  }
+#ifdef _WIN32
+  remove(path); // rename doesn't replace an existing file on Windows
+#endif
+  if (rename(temp_path, path) != 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't rename screenshot to %s", path);
+    remove(temp_path);
+    return 0;
+  }
+  SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "Wrote screenshot %s", path);
+  return 1;
+}
+
+void screenshot_poll(void) {
+  if (screenshot_requested && screenshot_path != NULL) {
+    screenshot_requested = 0;
+    screenshot_save(screenshot_path);
+  }
+}
+
+void screenshot_close(void) {
+  if (screenshot_path == NULL) {
+    return;
+  }
+#ifdef SIGUSR1
+  signal(SIGUSR1, SIG_DFL);
+#endif
+  screenshot_save(screenshot_path);
+  screenshot_path = NULL;
+}
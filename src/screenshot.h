@@ -0,0 +1,23 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Screenshots of the M8 display at its native resolution, written as BMP files from the CPU
+// framebuffer. A configured screenshot is rewritten whenever m8c receives SIGUSR1 (not available
+// on Windows) and once more when it exits, which is how frames are read in headless mode.
+
+#ifndef SCREENSHOT_H_
+#define SCREENSHOT_H_
+
+// Set the file written on SIGUSR1 and at exit, and install the signal handler
+void screenshot_configure(const char *path);
+
+// Write the current frame to a file. Returns 1 on success.
+int screenshot_save(const char *path);
+
+// Write a screenshot requested by a signal. Called from the main loop.
+void screenshot_poll(void);
+
+// Write the final screenshot, before the framebuffer is released
+void screenshot_close(void);
+
+#endif // SCREENSHOT_H_
@@ -34,6 +34,25 @@ typedef SDL_cond SDL_Condition;
 #define SDL_SignalCondition(c) SDL_CondSignal(c)
 #define SDL_WaitCondition(c, m) SDL_CondWait(c, m)
 
+// Atomics (SDL3 renamed the type and accessors)
+typedef SDL_atomic_t SDL_AtomicInt;
+#define SDL_GetAtomicInt(a) SDL_AtomicGet(a)
+#define SDL_SetAtomicInt(a, v) SDL_AtomicSet(a, v)
+#define SDL_AddAtomicInt(a, v) SDL_AtomicAdd(a, v)
+#define SDL_CompareAndSwapAtomicInt(a, oldval, newval) SDL_AtomicCAS(a, oldval, newval)
+#define SDL_GetAtomicPointer(a) SDL_AtomicGetPtr(a)
+#define SDL_SetAtomicPointer(a, v) SDL_AtomicSetPtr(a, v)
+#define SDL_LockSpinlock(lock) SDL_AtomicLock(lock)
+#define SDL_UnlockSpinlock(lock) SDL_AtomicUnlock(lock)
+
+// Thread local storage. SDL3 creates the ID on first use, SDL2 needs it created up front.
+#define COMPAT_TLS_CREATE(id) (*(id) = SDL_TLSCreate())
+static inline bool SDL_SetTLS_Compat(SDL_TLSID *id, const void *value,
+                                     void(SDLCALL *destructor)(void *)) {
+  return SDL_TLSSet(*id, value, destructor) == 0;
+}
+#define SDL_SetTLS(id, value, destructor) SDL_SetTLS_Compat(id, value, destructor)
+
 // App result type for main loop compatibility
 typedef enum {
   SDL_APP_CONTINUE = 0,
@@ -61,6 +80,7 @@ typedef SDL_ScaleMode SDL_ScaleMode_t;
 #define SDL_EVENT_TERMINATING SDL_APP_TERMINATING
 #define SDL_EVENT_KEY_DOWN SDL_KEYDOWN
 #define SDL_EVENT_KEY_UP SDL_KEYUP
+#define SDL_SCANCODE_COUNT SDL_NUM_SCANCODES
 
 // Window events - SDL2 uses SDL_WINDOWEVENT with subtypes
 #define SDL_EVENT_WINDOW_RESIZED SDL_WINDOWEVENT
@@ -160,6 +180,10 @@ static inline int __sdl2_init_subsystem_wrapper(Uint32 flags) {
 #define SDL_IOFromFile(path, mode) SDL_RWFromFile(path, mode)
 #define SDL_IOFromConstMem(mem, size) SDL_RWFromConstMem(mem, size)
 #define SDL_CloseIO(io) SDL_RWclose(io)
+#define SDL_SeekIO(io, offset, whence) SDL_RWseek(io, offset, whence)
+#define SDL_IO_SEEK_SET RW_SEEK_SET
+// SDL2 RWops have no flush, stdio buffers are flushed on close
+#define SDL_FlushIO(io) ((void)(io), true)
 
 // SDL_WriteIO in SDL3 returns bytes written, SDL_RWwrite in SDL2 returns objects written
 static inline size_t SDL_WriteIO_Compat(SDL_IOStream *io, const void *ptr, size_t size) {
@@ -173,7 +197,19 @@ static inline size_t SDL_WriteIO_Compat(SDL_IOStream *io, const void *ptr, size_
 // Surface functions
 // ============================================================================
 
+#define SDL_CreateSurface(w, h, format) \
+  SDL_CreateRGBSurfaceWithFormat(0, w, h, SDL_BITSPERPIXEL(format), format)
 #define SDL_DestroySurface(s) SDL_FreeSurface(s)
+#define SDL_FillSurfaceRect(s, rect, color) SDL_FillRect(s, rect, color)
+#define SDL_CreateSurfaceFrom(w, h, format, pixels, pitch) \
+  SDL_CreateRGBSurfaceWithFormatFrom(pixels, w, h, SDL_BITSPERPIXEL(format), pitch, format)
+
+// SDL_SaveBMP: SDL2 returns 0 on success, SDL3 returns bool
+static inline int SDL_SaveBMP_Compat(SDL_Surface *surface, const char *file) {
+  return SDL_SaveBMP_RW(surface, SDL_RWFromFile(file, "wb"), 1) == 0;
+}
+#undef SDL_SaveBMP
+#define SDL_SaveBMP(s, file) SDL_SaveBMP_Compat(s, file)
 #define SDL_MapSurfaceRGB(s, r, g, b) SDL_MapRGB((s)->format, r, g, b)
 
 static inline int SDL_SetSurfaceColorKey_Compat(SDL_Surface *surface, int flag, Uint32 key) {
@@ -267,6 +303,17 @@ static inline int SDL_RenderLines_Compat(SDL_Renderer *renderer, const SDL_FPoin
 }
 #define SDL_RenderLines(r, p, c) SDL_RenderLines_Compat(r, p, c)
 
+// SDL_RenderGeometry: SDL2 returns 0 on success, SDL3 returns bool
+static inline int SDL_RenderGeometry_Compat(SDL_Renderer *renderer, SDL_Texture *texture,
+                                            const SDL_Vertex *vertices, int num_vertices,
+                                            const int *indices, int num_indices) {
+  return SDL_RenderGeometry(renderer, texture, vertices, num_vertices, indices, num_indices) >= 0;
+}
+#define SDL_RenderGeometry(r, t, v, nv, i, ni) SDL_RenderGeometry_Compat(r, t, v, nv, i, ni)
+
+// SDL2 vertex colors are SDL_Color, SDL3 uses SDL_FColor
+#define COMPAT_VERTEX_COLOR(r, g, b, a) ((SDL_Color){(r), (g), (b), (a)})
+
 // SDL_RenderFillRect with FRect support -> convert to Rect
 // SDL3 uses SDL_FRect, SDL2 uses SDL_Rect
 // SDL2 returns 0 on success, SDL3 returns bool - normalize to bool
@@ -308,6 +355,15 @@ static inline int SDL_SetRenderTarget_Compat(SDL_Renderer *renderer, SDL_Texture
 }
 #define SDL_SetRenderTarget(r, t) SDL_SetRenderTarget_Compat(r, t)
 
+// SDL_UpdateTexture: SDL2 returns 0 on success, SDL3 returns bool
+static inline int SDL_UpdateTexture_Compat(SDL_Texture *texture, const SDL_Rect *rect,
+                                           const void *pixels, int pitch) {
+  extern DECLSPEC int SDLCALL SDL_UpdateTexture(SDL_Texture *texture, const SDL_Rect *rect,
+                                                const void *pixels, int pitch);
+  return SDL_UpdateTexture(texture, rect, pixels, pitch) >= 0;
+}
+#define SDL_UpdateTexture(t, r, p, pitch) SDL_UpdateTexture_Compat(t, r, p, pitch)
+
 // SDL_SetRenderDrawColor: SDL2 returns 0 on success, SDL3 returns bool
 static inline int SDL_SetRenderDrawColor_Compat(SDL_Renderer *renderer, Uint8 r, Uint8 g, Uint8 b,
                                                  Uint8 a) {
@@ -433,6 +489,7 @@ static inline int SDL_HideCursor_Compat(void) { return SDL_ShowCursor(SDL_DISABL
 
 // SDL_SetLogPriorities -> SDL_LogSetAllPriority
 #define SDL_SetLogPriorities(priority) SDL_LogSetAllPriority(priority)
+#define SDL_GetLogPriority(category) SDL_LogGetPriority(category)
 
 // SDL3 uses SDL_GetLogOutputFunction/SDL_SetLogOutputFunction
 // SDL2 uses SDL_LogGetOutputFunction/SDL_LogSetOutputFunction
@@ -477,6 +534,16 @@ static inline char *SDL_strcasestr_Compat(const char *haystack, const char *need
 }
 #define SDL_strcasestr(h, n) SDL_strcasestr_Compat(h, n)
 
+// SDL_GetTicksNS doesn't exist in SDL2 - derive it from the performance counter
+#define SDL_NS_PER_SECOND 1000000000ULL
+static inline Uint64 SDL_GetTicksNS_Compat(void) {
+  const Uint64 counter = SDL_GetPerformanceCounter();
+  const Uint64 frequency = SDL_GetPerformanceFrequency();
+  return counter / frequency * SDL_NS_PER_SECOND +
+         counter % frequency * SDL_NS_PER_SECOND / frequency;
+}
+#define SDL_GetTicksNS() SDL_GetTicksNS_Compat()
+
 // SDL3 renamed SDL_SetThreadPriority to SDL_SetCurrentThreadPriority
 #define SDL_SetCurrentThreadPriority(p) SDL_SetThreadPriority(p)
 
@@ -497,6 +564,8 @@ static inline char *SDL_strcasestr_Compat(const char *haystack, const char *need
 #define COMPAT_KEY_SYM(event) ((event)->key.keysym.sym)
 #define COMPAT_KEY_MOD(event) ((event)->key.keysym.mod)
 #define COMPAT_KEY_REPEAT(event) ((event)->key.repeat)
+#define COMPAT_KEY_SET_DOWN(event, pressed)                                                        \
+  ((event)->key.state = (pressed) ? SDL_PRESSED : SDL_RELEASED)
 
 // Accessors for gamepad events
 #define COMPAT_GBUTTON_BUTTON(event) ((event)->cbutton.button)
@@ -519,6 +588,10 @@ static inline char *SDL_strcasestr_Compat(const char *haystack, const char *need
 #define COMPAT_KEY_SYM(event) ((event)->key.key)
 #define COMPAT_KEY_MOD(event) ((event)->key.mod)
 #define COMPAT_KEY_REPEAT(event) ((event)->key.repeat)
+#define COMPAT_KEY_SET_DOWN(event, pressed) ((event)->key.down = (pressed))
+
+// SDL3 creates thread local storage IDs on first use
+#define COMPAT_TLS_CREATE(id) ((void)(id))
 
 // Gamepad event accessors
 #define COMPAT_GBUTTON_BUTTON(event) ((event)->gbutton.button)
@@ -529,6 +602,10 @@ static inline char *SDL_strcasestr_Compat(const char *haystack, const char *need
 #define COMPAT_IS_WINDOW_RESIZE(event) ((event)->type == SDL_EVENT_WINDOW_RESIZED)
 #define COMPAT_IS_WINDOW_MOVED(event) ((event)->type == SDL_EVENT_WINDOW_MOVED)
 
+// Vertex colors from 8-bit components
+#define COMPAT_VERTEX_COLOR(r, g, b, a)                                                            \
+  ((SDL_FColor){(r) / 255.0f, (g) / 255.0f, (b) / 255.0f, (a) / 255.0f})
+
 // SDL3 renamed KMOD_* to SDL_KMOD_*
 #undef KMOD_GUI
 #undef KMOD_CTRL
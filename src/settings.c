@@ -85,6 +85,7 @@ static void build_menu(const config_params_s *conf, setting_item_s *items, int *
   case VIEW_ROOT:
     add_item(items, count, "Graphics       ", ITEM_HEADER, NULL, 0, 0, 0);
     add_item(items, count, "Integer scaling", ITEM_TOGGLE_BOOL, (void *)&conf->integer_scaling, 0,0, 0);
+    add_item(items, count, "Waveform lines ", ITEM_TOGGLE_BOOL, (void *)&conf->waveform_lines, 0,0, 0);
     // SDL apps are always full screen on iOS, hide the option
     if (TARGET_OS_IOS == 0) {
       add_item(items, count, "Fullscreen     ", ITEM_TOGGLE_BOOL, (void *)&conf->init_fullscreen, 0,0, 0);
@@ -128,6 +129,9 @@ static void build_menu(const config_params_s *conf, setting_item_s *items, int *
     add_item(items, count, "Toggle audio   ", ITEM_BIND_KEY, (void *)&conf->key_toggle_audio, 0, 0, 0);
     add_item(items, count, "Toggle settings", ITEM_BIND_KEY, (void *)&conf->key_toggle_settings, 0, 0, 0);
     add_item(items, count, "Toggle log     ", ITEM_BIND_KEY, (void *)&conf->key_toggle_log, 0, 0, 0);
+    add_item(items, count, "Toggle meters  ", ITEM_BIND_KEY, (void *)&conf->key_toggle_meters, 0, 0, 0);
+    add_item(items, count, "Toggle HUD     ", ITEM_BIND_KEY, (void *)&conf->key_toggle_hud, 0, 0, 0);
+    add_item(items, count, "Flush trace    ", ITEM_BIND_KEY, (void *)&conf->key_trace_flush, 0, 0, 0);
     add_item(items, count, "", ITEM_HEADER, NULL, 0, 0, 0);
     add_item(items, count, "Back", ITEM_CLOSE, NULL, 0, 0, 0);
     break;
@@ -278,6 +282,9 @@ static void settings_activate(struct app_context *ctx, const setting_item_s *ite
     if (it->target == &conf->integer_scaling) {
       renderer_fix_texture_scaling_after_window_resize(conf);
     }
+    if (it->target == &conf->waveform_lines) {
+      renderer_set_waveform_lines(conf->waveform_lines);
+    }
     if (it->target == &conf->audio_enabled && ctx->device_connected) {
       audio_toggle(ctx->conf.audio_device_name, ctx->conf.audio_buffer_size);
     }
@@ -526,7 +533,6 @@ void settings_render_overlay(SDL_Renderer *rend, const config_params_s *conf, in
   const struct inline_font *previous_font = inline_font_get_current();
   if (previous_font->glyph_x != fonts_get(0)->glyph_x) {
     // Switch to small font if not active already
-    inline_font_close();
     inline_font_initialize(fonts_get(0));
   }
 
@@ -534,7 +540,6 @@ void settings_render_overlay(SDL_Renderer *rend, const config_params_s *conf, in
     g_settings.texture = SDL_CreateTexture(rend, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
                                           texture_w, texture_h);
     if (g_settings.texture == NULL) {
-      inline_font_close();
       inline_font_initialize(previous_font);
       return;
     }
@@ -727,7 +732,6 @@ void settings_render_overlay(SDL_Renderer *rend, const config_params_s *conf, in
 composite:
   SDL_RenderTexture(rend, g_settings.texture, NULL, NULL);
   if (previous_font->glyph_x != fonts_get(0)->glyph_x) {
-    inline_font_close();
     inline_font_initialize(previous_font);
   }
 }
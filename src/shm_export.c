@@ -0,0 +1,166 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "shm_export.h"
+#include "framebuffer.h"
+#include "sdl_compat.h"
+
+#ifndef _WIN32
+#define SHM_EXPORT_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SHM_EXPORT_MAGIC 0x4D384652 // "M8FR"
+#define SHM_EXPORT_VERSION 1
+#define SHM_EXPORT_MAX_WIDTH 480
+#define SHM_EXPORT_MAX_HEIGHT 320
+
+typedef struct {
+  SDL_AtomicInt sequence; // odd while the buffer is written
+  uint32_t frame;
+  uint32_t width;
+  uint32_t height;
+  uint32_t rect_count;
+  int32_t rects[FRAMEBUFFER_MAX_DIRTY_RECTS][4]; // x, y, w, h
+  uint32_t pixels[SHM_EXPORT_MAX_WIDTH * SHM_EXPORT_MAX_HEIGHT];
+} shm_export_buffer_s;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t max_width;
+  uint32_t max_height;
+  SDL_AtomicInt front;
+  SDL_AtomicInt frame;
+  shm_export_buffer_s buffers[2];
+} shm_export_s;
+
+#ifdef SHM_EXPORT_SUPPORTED
+static const char *export_name = NULL;
+static shm_export_s *shared = NULL;
+static char shm_name[256];
+
+// A buffer that was written before holds the frame before the previous one, so it is brought up
+// to date with the changes of the previous frame and of this one
+static SDL_Rect previous_rects[FRAMEBUFFER_MAX_DIRTY_RECTS];
+static int previous_count = 0;
+static int buffer_valid[2] = {0, 0};
+#endif
+
+void shm_export_configure(const char *name) {
+#ifdef SHM_EXPORT_SUPPORTED
+  export_name = name;
+#else
+  (void)name;
+  SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Shared memory export is not supported on this platform");
+#endif
+}
+
+int shm_export_start(void) {
+#ifdef SHM_EXPORT_SUPPORTED
+  if (export_name == NULL) {
+    return 1;
+  }
+  // POSIX shared memory names start with a slash
+  SDL_snprintf(shm_name, sizeof(shm_name), "%s%s", export_name[0] == '/' ? "" : "/",
+               export_name);
+  shm_unlink(shm_name); // stale object from a previous run
+  const int fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't create shared memory %s: %s", shm_name,
+                 strerror(errno));
+    return 0;
+  }
+  if (ftruncate(fd, sizeof(shm_export_s)) == 0) {
+    shared = mmap(NULL, sizeof(shm_export_s), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (shared == NULL || shared == MAP_FAILED) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't map shared memory %s: %s", shm_name,
+                 strerror(errno));
+    shared = NULL;
+    shm_unlink(shm_name);
+    return 0;
+  }
+  shared->version = SHM_EXPORT_VERSION;
+  shared->max_width = SHM_EXPORT_MAX_WIDTH;
+  shared->max_height = SHM_EXPORT_MAX_HEIGHT;
+  shared->magic = SHM_EXPORT_MAGIC;
+  SDL_Log("Exporting frames to shared memory %s", shm_name);
+#endif
+  return 1;
+}
+
+#ifdef SHM_EXPORT_SUPPORTED
+static void copy_rects(shm_export_buffer_s *buffer, const uint32_t *argb, const SDL_Rect *rects,
+                       const int count) {
+  for (int i = 0; i < count; i++) {
+    const SDL_Rect *r = &rects[i];
+    for (int y = r->y; y < r->y + r->h; y++) {
+      SDL_memcpy(buffer->pixels + y * buffer->width + r->x, argb + y * buffer->width + r->x,
+                 sizeof(uint32_t) * r->w);
+    }
+  }
+}
+#endif
+
+void shm_export_frame(void) {
+#ifdef SHM_EXPORT_SUPPORTED
+  if (shared == NULL) {
+    return;
+  }
+  int count;
+  const SDL_Rect *rects = framebuffer_dirty_rects(&count);
+  const int width = framebuffer_width();
+  const int height = framebuffer_height();
+  if (count == 0 || width > SHM_EXPORT_MAX_WIDTH || height > SHM_EXPORT_MAX_HEIGHT) {
+    return;
+  }
+  const uint32_t *argb = framebuffer_argb();
+
+  const int back = 1 - SDL_GetAtomicInt(&shared->front);
+  shm_export_buffer_s *buffer = &shared->buffers[back];
+  SDL_AddAtomicInt(&buffer->sequence, 1);
+
+  if (!buffer_valid[back] || buffer->width != (uint32_t)width ||
+      buffer->height != (uint32_t)height) {
+    buffer->width = width;
+    buffer->height = height;
+    SDL_memcpy(buffer->pixels, argb, sizeof(uint32_t) * width * height);
+    buffer_valid[back] = 1;
+  } else {
+    copy_rects(buffer, argb, previous_rects, previous_count);
+    copy_rects(buffer, argb, rects, count);
+  }
+  buffer->frame = (uint32_t)SDL_GetAtomicInt(&shared->frame) + 1;
+  buffer->rect_count = count;
+  for (int i = 0; i < count; i++) {
+    buffer->rects[i][0] = rects[i].x;
+    buffer->rects[i][1] = rects[i].y;
+    buffer->rects[i][2] = rects[i].w;
+    buffer->rects[i][3] = rects[i].h;
+  }
+
+  SDL_AddAtomicInt(&buffer->sequence, 1);
+  SDL_SetAtomicInt(&shared->front, back);
+  SDL_AddAtomicInt(&shared->frame, 1);
+
+  SDL_memcpy(previous_rects, rects, sizeof(SDL_Rect) * count);
+  previous_count = count;
+#endif
+}
+
+void shm_export_stop(void) {
+#ifdef SHM_EXPORT_SUPPORTED
+  if (shared != NULL) {
+    munmap(shared, sizeof(shm_export_s));
+    shared = NULL;
+    shm_unlink(shm_name);
+  }
+#endif
+}
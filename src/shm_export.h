@@ -0,0 +1,34 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Exports the M8 display at its native resolution into POSIX shared memory, so that other
+// processes can capture frames without grabbing the window. Not available on Windows.
+//
+// Layout, all fields 32-bit in host byte order:
+//   header:  magic "M8FR" (0x4D384652), version, max width (480), max height (320),
+//            front buffer index, frame counter, followed by two buffers
+//   buffer:  sequence, frame number, width, height, dirty rectangle count,
+//            16 rectangles of x, y, w, h, then max width * max height ARGB8888 pixels with a
+//            stride of the current width
+// The buffers are written alternately. A buffer's sequence is odd while it is written: read
+// the front index and that buffer's sequence, copy the pixels, and start over if the sequence
+// was odd or changed in the meantime. The dirty rectangles are the regions that changed since
+// the previous frame.
+
+#ifndef SHM_EXPORT_H_
+#define SHM_EXPORT_H_
+
+// Select the shared memory object, e.g. "/m8c-frame", while parsing the command line
+void shm_export_configure(const char *name);
+
+// Create the configured shared memory object. Returns 1 on success or when nothing is exported.
+int shm_export_start(void);
+
+// Publish the framebuffer if it changed since the last frame. Called once per frame before the
+// framebuffer's dirty rectangles are reset.
+void shm_export_frame(void);
+
+// Remove the shared memory object
+void shm_export_stop(void);
+
+#endif // SHM_EXPORT_H_
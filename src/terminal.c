@@ -0,0 +1,519 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "terminal.h"
+#include "keysym.h"
+#include "sdl_compat.h"
+
+#ifndef _WIN32
+#define TERMINAL_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#ifdef TERMINAL_SUPPORTED
+
+#define TERMINAL_COLUMNS 40
+#define TERMINAL_ROWS 24
+#define CELL_COUNT (TERMINAL_COLUMNS * TERMINAL_ROWS)
+// Cursor position, both colours and a three byte character take at most 50 bytes per cell
+#define OUTPUT_SIZE (CELL_COUNT * 64 + 64)
+// Terminals don't report key releases, a key is released when it stops repeating
+#define KEY_HOLD_MS 100
+#define MAX_HELD_KEYS 8
+
+enum { MODIFIER_SHIFT = 1, MODIFIER_ALT = 2, MODIFIER_CTRL = 4 };
+
+typedef struct {
+  uint32_t top;    // upper half, and the background of a character
+  uint32_t bottom; // lower half
+  uint32_t fg;     // character colour
+  char c;          // printable character, 0 for two half blocks
+} terminal_cell_s;
+
+static int terminal_active = 0;
+static int cell_width = 8;
+static int cell_height = 10;
+static terminal_cell_s cells[CELL_COUNT];
+static terminal_cell_s shown[CELL_COUNT]; // what the terminal displays
+static int cells_changed = 0;
+static int redraw = 0; // repaint every cell
+static volatile sig_atomic_t window_resized = 0;
+static struct termios saved_termios;
+static int saved_stderr = -1;
+static char output[OUTPUT_SIZE];
+
+static struct {
+  uint32_t keysym;
+  Uint64 release_ticks;
+} held_keys[MAX_HELD_KEYS];
+static int held_count = 0;
+
+static void handle_sigwinch(const int signal_number) {
+  (void)signal_number;
+  window_resized = 1;
+}
+
+static int cell_equal(const terminal_cell_s *a, const terminal_cell_s *b) {
+  return a->top == b->top && a->bottom == b->bottom && a->fg == b->fg && a->c == b->c;
+}
+
+static void set_cell(const int index, const terminal_cell_s *cell) {
+  if (!cell_equal(&cells[index], cell)) {
+    cells[index] = *cell;
+    cells_changed = 1;
+  }
+}
+
+static void write_all(const char *data, size_t length) {
+  while (length > 0) {
+    const ssize_t written = write(STDOUT_FILENO, data, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    data += written;
+    length -= (size_t)written;
+  }
+}
+
+static void hold_key(const uint32_t keysym, const Uint64 release_ticks) {
+  for (int i = 0; i < held_count; i++) {
+    if (held_keys[i].keysym == keysym) {
+      held_keys[i].release_ticks = release_ticks;
+      return;
+    }
+  }
+  if (held_count == MAX_HELD_KEYS) {
+    return;
+  }
+  keysym_push_event(keysym, 1);
+  held_keys[held_count].keysym = keysym;
+  held_keys[held_count].release_ticks = release_ticks;
+  held_count++;
+}
+
+// Press a key, with the modifiers held down around it
+static void press_key(const uint32_t keysym, const int modifiers) {
+  const Uint64 release_ticks = SDL_GetTicks() + KEY_HOLD_MS;
+  if (modifiers & MODIFIER_SHIFT) {
+    hold_key(KEYSYM_SHIFT_L, release_ticks);
+  }
+  if (modifiers & MODIFIER_ALT) {
+    hold_key(KEYSYM_ALT_L, release_ticks);
+  }
+  if (modifiers & MODIFIER_CTRL) {
+    hold_key(KEYSYM_CONTROL_L, release_ticks);
+  }
+  hold_key(keysym, release_ticks);
+}
+
+// Release the keys that stopped repeating, the most recent first so modifiers go up last
+static void release_keys(const Uint64 now) {
+  for (int i = held_count - 1; i >= 0; i--) {
+    if (now < held_keys[i].release_ticks) {
+      continue;
+    }
+    keysym_push_event(held_keys[i].keysym, 0);
+    held_count--;
+    SDL_memmove(&held_keys[i], &held_keys[i + 1], sizeof(held_keys[0]) * (held_count - i));
+  }
+}
+
+// A single byte: printable ASCII, control keys and Ctrl with a letter
+static void press_byte(const uint8_t byte, const int modifiers) {
+  if (byte == 0x7F || byte == 0x08) {
+    press_key(KEYSYM_BACKSPACE, modifiers);
+  } else if (byte == '\r' || byte == '\n') {
+    press_key(KEYSYM_RETURN, modifiers);
+  } else if (byte == '\t') {
+    press_key(KEYSYM_TAB, modifiers);
+  } else if (byte >= 0x01 && byte <= 0x1A) {
+    press_key('a' + byte - 1, modifiers | MODIFIER_CTRL);
+  } else if (byte >= 0x20 && byte <= 0x7E) {
+    press_key(byte, modifiers);
+  }
+}
+
+// Handle an escape sequence starting at input[0], returns its length or 0 if it is incomplete
+static int press_escape_sequence(const uint8_t *input, const int length) {
+  if (length < 2) {
+    press_key(KEYSYM_ESCAPE, 0);
+    return 1;
+  }
+  if (input[1] != '[' && input[1] != 'O') {
+    // Alt with a key
+    press_byte(input[1], MODIFIER_ALT);
+    return 2;
+  }
+
+  // Parameters up to the final byte, e.g. ESC [ 1 ; 2 A for Shift+Up
+  int params[2] = {0, 0};
+  int param_count = 0;
+  int i = 2;
+  for (; i < length && (input[i] < 0x40 || input[i] > 0x7E); i++) {
+    if (SDL_isdigit(input[i]) && param_count < 2) {
+      params[param_count] = params[param_count] * 10 + (input[i] - '0');
+    } else if (input[i] == ';') {
+      param_count++;
+    }
+  }
+  if (i >= length) {
+    return 0;
+  }
+
+  uint32_t keysym = 0;
+  switch (input[i]) {
+  case 'A':
+    keysym = KEYSYM_UP;
+    break;
+  case 'B':
+    keysym = KEYSYM_DOWN;
+    break;
+  case 'C':
+    keysym = KEYSYM_RIGHT;
+    break;
+  case 'D':
+    keysym = KEYSYM_LEFT;
+    break;
+  case 'H':
+    keysym = KEYSYM_HOME;
+    break;
+  case 'F':
+    keysym = KEYSYM_END;
+    break;
+  case '~':
+    keysym = params[0] == 2   ? KEYSYM_INSERT
+             : params[0] == 3 ? KEYSYM_DELETE
+             : params[0] == 5 ? KEYSYM_PAGE_UP
+             : params[0] == 6 ? KEYSYM_PAGE_DOWN
+                              : 0;
+    break;
+  default:
+    break;
+  }
+  if (keysym != 0) {
+    // The modifier parameter is 1 plus the bits of Shift, Alt and Ctrl
+    press_key(keysym, params[1] > 1 ? params[1] - 1 : 0);
+  }
+  return i + 1;
+}
+
+#endif // TERMINAL_SUPPORTED
+
+int terminal_open(const int width, const int height) {
+#ifdef TERMINAL_SUPPORTED
+  if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "The terminal renderer needs a terminal");
+    return 0;
+  }
+  if (tcgetattr(STDIN_FILENO, &saved_termios) != 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't read the terminal settings");
+    return 0;
+  }
+  // Read keys without echo or line buffering, Ctrl+C still quits
+  struct termios raw = saved_termios;
+  raw.c_lflag &= ~(ECHO | ICANON | IEXTEN);
+  raw.c_iflag &= ~(IXON | ICRNL | INPCK | ISTRIP | BRKINT);
+  raw.c_cc[VMIN] = 0;
+  raw.c_cc[VTIME] = 0;
+  tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+  SDL_Log("Rendering to the terminal");
+  // Log output on the same terminal would scribble over the display
+  if (isatty(STDERR_FILENO)) {
+    const int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+      saved_stderr = dup(STDERR_FILENO);
+      dup2(null_fd, STDERR_FILENO);
+      close(null_fd);
+    }
+  }
+
+  signal(SIGWINCH, handle_sigwinch);
+  terminal_active = 1;
+  atexit(terminal_close); // restore the terminal on any exit path
+  static const char enter[] = "\x1b[?1049h\x1b[?25l"; // alternate screen, hide the cursor
+  write_all(enter, sizeof(enter) - 1);
+  terminal_resize(width, height);
+  return 1;
+#else
+  (void)width;
+  (void)height;
+  SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "The terminal renderer is not supported on this platform");
+  return 0;
+#endif
+}
+
+void terminal_close(void) {
+#ifdef TERMINAL_SUPPORTED
+  if (!terminal_active) {
+    return;
+  }
+  terminal_active = 0;
+  static const char leave[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+  write_all(leave, sizeof(leave) - 1);
+  tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+  signal(SIGWINCH, SIG_DFL);
+  if (saved_stderr >= 0) {
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+    saved_stderr = -1;
+  }
+#endif
+}
+
+void terminal_resize(const int width, const int height) {
+#ifdef TERMINAL_SUPPORTED
+  cell_width = SDL_max(width / TERMINAL_COLUMNS, 1);
+  cell_height = SDL_max(height / TERMINAL_ROWS, 2);
+  SDL_zeroa(cells);
+  cells_changed = 1;
+  redraw = 1;
+#else
+  (void)width;
+  (void)height;
+#endif
+}
+
+void terminal_fill_rect(const int x, const int y, const int w, const int h, const uint32_t rgb) {
+#ifdef TERMINAL_SUPPORTED
+  if (!terminal_active || w <= 0 || h <= 0) {
+    return;
+  }
+  // A half is covered if the rectangle contains its center
+  const int col_first = SDL_max(x / cell_width, 0);
+  const int col_last = SDL_min((x + w - 1) / cell_width, TERMINAL_COLUMNS - 1);
+  const int row_first = SDL_max(y / cell_height, 0);
+  const int row_last = SDL_min((y + h - 1) / cell_height, TERMINAL_ROWS - 1);
+  for (int row = row_first; row <= row_last; row++) {
+    const int top_y = row * cell_height + cell_height / 4;
+    const int bottom_y = row * cell_height + cell_height * 3 / 4;
+    const int top = top_y >= y && top_y < y + h;
+    const int bottom = bottom_y >= y && bottom_y < y + h;
+    if (!top && !bottom) {
+      continue;
+    }
+    for (int col = col_first; col <= col_last; col++) {
+      const int center_x = col * cell_width + cell_width / 2;
+      if (center_x < x || center_x >= x + w) {
+        continue;
+      }
+      const int index = row * TERMINAL_COLUMNS + col;
+      terminal_cell_s cell = cells[index];
+      cell.top = top ? rgb : cell.top;
+      cell.bottom = bottom ? rgb : cell.bottom;
+      cell.fg = 0;
+      cell.c = 0;
+      set_cell(index, &cell);
+    }
+  }
+#else
+  (void)x;
+  (void)y;
+  (void)w;
+  (void)h;
+  (void)rgb;
+#endif
+}
+
+void terminal_print(const char *text, const int x, const int y, const int cell_width_px,
+                    const int cell_height_px, const uint32_t fg_rgb, const uint32_t bg_rgb) {
+#ifdef TERMINAL_SUPPORTED
+  if (!terminal_active) {
+    return;
+  }
+  // The text starts in the cell under the center of its first character, the following
+  // characters take the next cells as the glyphs are narrower than the cells
+  const int center_x = x + cell_width_px / 2;
+  const int center_y = y + cell_height_px / 2;
+  const int row = center_y / cell_height;
+  if (center_x < 0 || center_y < 0 || row >= TERMINAL_ROWS) {
+    return;
+  }
+  for (int i = 0; text[i] != '\0'; i++) {
+    const int col = center_x / cell_width + i;
+    if (col >= TERMINAL_COLUMNS) {
+      break;
+    }
+    const int printable = text[i] > ' ' && text[i] <= '~';
+    if (!printable && fg_rgb == bg_rgb) {
+      continue; // nothing drawn without a background
+    }
+    const int index = row * TERMINAL_COLUMNS + col;
+    terminal_cell_s cell = cells[index];
+    if (fg_rgb != bg_rgb) {
+      cell.top = bg_rgb;
+    }
+    cell.bottom = cell.top; // a character has a single background
+    cell.fg = printable ? fg_rgb : 0;
+    cell.c = printable ? text[i] : 0;
+    set_cell(index, &cell);
+  }
+#else
+  (void)text;
+  (void)x;
+  (void)y;
+  (void)cell_width_px;
+  (void)cell_height_px;
+  (void)fg_rgb;
+  (void)bg_rgb;
+#endif
+}
+
+void terminal_plot(const int x, const uint8_t *samples, const int count, const uint32_t rgb,
+                   const int lines) {
+#ifdef TERMINAL_SUPPORTED
+  if (!terminal_active) {
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    const int col = (x + i) / cell_width;
+    if (x + i < 0 || col >= TERMINAL_COLUMNS) {
+      continue;
+    }
+    int y0 = samples[i];
+    int y1 = samples[i];
+    if (lines && i > 0) {
+      y0 = SDL_min(y0, samples[i - 1]);
+      y1 = SDL_max(y1, samples[i - 1]);
+    }
+    for (int y = y0; y <= y1; y++) {
+      const int row = y / cell_height;
+      if (row >= TERMINAL_ROWS) {
+        break;
+      }
+      const int index = row * TERMINAL_COLUMNS + col;
+      terminal_cell_s cell = cells[index];
+      if (y - row * cell_height < cell_height / 2) {
+        cell.top = rgb;
+      } else {
+        cell.bottom = rgb;
+      }
+      cell.fg = 0;
+      cell.c = 0;
+      set_cell(index, &cell);
+    }
+  }
+#else
+  (void)x;
+  (void)samples;
+  (void)count;
+  (void)rgb;
+  (void)lines;
+#endif
+}
+
+void terminal_present(void) {
+#ifdef TERMINAL_SUPPORTED
+  if (!terminal_active) {
+    return;
+  }
+  if (window_resized) {
+    window_resized = 0;
+    redraw = 1;
+  }
+  if (!cells_changed && !redraw) {
+    return;
+  }
+
+  char *p = output;
+  const char *end = output + sizeof(output);
+  if (redraw) {
+    p += SDL_snprintf(p, end - p, "\x1b[0m\x1b[2J");
+  }
+  int colours_known = 0;
+  uint32_t current_fg = 0;
+  uint32_t current_bg = 0;
+  int cursor = -1; // cell the cursor is on
+  for (int i = 0; i < CELL_COUNT; i++) {
+    const terminal_cell_s *cell = &cells[i];
+    if (!redraw && cell_equal(cell, &shown[i])) {
+      continue;
+    }
+    const int row = i / TERMINAL_COLUMNS;
+    const int col = i % TERMINAL_COLUMNS;
+    if (i != cursor) {
+      p += SDL_snprintf(p, end - p, "\x1b[%d;%dH", row + 1, col + 1);
+    }
+
+    // A character, a blank cell, or the upper half block in the top colour over the bottom one
+    const char *glyph;
+    uint32_t fg = current_fg;
+    uint32_t bg;
+    char character[2] = {cell->c, '\0'};
+    if (cell->c != 0) {
+      glyph = character;
+      fg = cell->fg;
+      bg = cell->top;
+    } else if (cell->top == cell->bottom) {
+      glyph = " ";
+      bg = cell->top;
+    } else {
+      glyph = "\xe2\x96\x80";
+      fg = cell->top;
+      bg = cell->bottom;
+    }
+    if (!colours_known || bg != current_bg) {
+      p += SDL_snprintf(p, end - p, "\x1b[48;2;%u;%u;%um", bg >> 16, (bg >> 8) & 0xFF, bg & 0xFF);
+      current_bg = bg;
+    }
+    if (!colours_known || fg != current_fg) {
+      p += SDL_snprintf(p, end - p, "\x1b[38;2;%u;%u;%um", fg >> 16, (fg >> 8) & 0xFF, fg & 0xFF);
+      current_fg = fg;
+    }
+    colours_known = 1;
+    p += SDL_snprintf(p, end - p, "%s", glyph);
+    shown[i] = *cell;
+    // The cursor stays on the last column after writing to it
+    cursor = col == TERMINAL_COLUMNS - 1 ? -1 : i + 1;
+  }
+  write_all(output, p - output);
+  cells_changed = 0;
+  redraw = 0;
+#endif
+}
+
+void terminal_poll(void) {
+#ifdef TERMINAL_SUPPORTED
+  if (!terminal_active) {
+    return;
+  }
+  release_keys(SDL_GetTicks());
+
+  static uint8_t input[64];
+  static int input_length = 0;
+  const ssize_t received =
+      read(STDIN_FILENO, input + input_length, sizeof(input) - input_length);
+  if (received <= 0) {
+    return;
+  }
+  input_length += (int)received;
+
+  int position = 0;
+  while (position < input_length) {
+    if (input[position] == 0x1b) {
+      const int used = press_escape_sequence(input + position, input_length - position);
+      if (used == 0) {
+        break;
+      }
+      position += used;
+    } else {
+      press_byte(input[position], 0);
+      position++;
+    }
+  }
+  // Keep an incomplete escape sequence for the next read, unless it fills the buffer
+  input_length -= position;
+  if (input_length == (int)sizeof(input)) {
+    input_length = 0;
+  }
+  SDL_memmove(input, input + position, input_length);
+#endif
+}
@@ -0,0 +1,38 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Terminal renderer for headless use, e.g. over SSH. The M8 display is mapped onto a grid of 40x24
+// terminal cells drawn with ANSI truecolor escape sequences: characters stay characters, while
+// rectangles and the oscilloscope are approximated with half blocks that show two colours per
+// cell. The draw commands update the cells, and once per frame only the cells that changed are
+// written with a single write(). Keys pressed in the terminal are sent as key events. Not
+// available on Windows.
+
+#ifndef TERMINAL_H_
+#define TERMINAL_H_
+
+#include <stdint.h>
+
+// Take over the terminal for a display of the given size. Returns 1 on success.
+int terminal_open(int width, int height);
+
+// Restore the terminal
+void terminal_close(void);
+
+// Map a new display size onto the grid and clear it
+void terminal_resize(int width, int height);
+
+// The drawing functions take display coordinates like their framebuffer counterparts and do
+// nothing while the terminal renderer is not open
+void terminal_fill_rect(int x, int y, int w, int h, uint32_t rgb);
+void terminal_print(const char *text, int x, int y, int cell_width, int cell_height,
+                    uint32_t fg_rgb, uint32_t bg_rgb);
+void terminal_plot(int x, const uint8_t *samples, int count, uint32_t rgb, int lines);
+
+// Write the cells that changed since the last call
+void terminal_present(void);
+
+// Read the keys pressed in the terminal. Called from the main loop.
+void terminal_poll(void);
+
+#endif // TERMINAL_H_
@@ -0,0 +1,228 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "trace.h"
+#include "sdl_compat.h"
+
+#define TRACE_MAX_THREADS 16
+#define TRACE_BUFFER_EVENTS 16384 // per thread, events are dropped when the flush falls behind
+#define TRACE_LINE_LENGTH 256
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct {
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+} trace_event_s;
+
+// Single producer (the owning thread), single consumer (trace_flush) ring of completed spans
+typedef struct {
+  trace_event_s events[TRACE_BUFFER_EVENTS];
+  SDL_AtomicInt written;
+  SDL_AtomicInt read;
+  SDL_AtomicInt dropped;
+  const char *name;
+  int tid;
+  int name_written;
+} trace_buffer_s;
+
+// A slot's buffer is kept when its thread exits and reused by the next thread once it is
+// flushed. Nothing is read from a slot while it is being claimed.
+typedef enum { SLOT_FREE, SLOT_CLAIMING, SLOT_OWNED, SLOT_RELEASED } slot_state_t;
+
+static SDL_AtomicInt trace_enabled;
+static SDL_IOStream *trace_file = NULL;
+static uint64_t trace_origin_ns = 0;
+static int trace_events_written = 0;
+static void *buffers[TRACE_MAX_THREADS]; // trace_buffer_s, published with SDL_SetAtomicPointer
+static SDL_AtomicInt slot_states[TRACE_MAX_THREADS];
+static SDL_AtomicInt next_tid;
+static SDL_TLSID slot_tls;
+
+static TRACE_THREAD_LOCAL trace_buffer_s *thread_buffer = NULL;
+static TRACE_THREAD_LOCAL const char *thread_name = NULL;
+static TRACE_THREAD_LOCAL trace_event_s pending; // batch still being extended
+
+// Thread local storage destructor, the flush frees the slot once its events are written
+static void SDLCALL release_slot(void *state) { SDL_SetAtomicInt(state, SLOT_RELEASED); }
+
+static trace_buffer_s *get_thread_buffer(void) {
+  if (thread_buffer != NULL) {
+    return thread_buffer;
+  }
+  for (int slot = 0; slot < TRACE_MAX_THREADS; slot++) {
+    if (!SDL_CompareAndSwapAtomicInt(&slot_states[slot], SLOT_FREE, SLOT_CLAIMING)) {
+      continue;
+    }
+    trace_buffer_s *buffer = SDL_GetAtomicPointer(&buffers[slot]);
+    if (buffer == NULL) {
+      buffer = SDL_calloc(1, sizeof(trace_buffer_s));
+      if (buffer == NULL) {
+        SDL_SetAtomicInt(&slot_states[slot], SLOT_FREE);
+        return NULL;
+      }
+      SDL_SetAtomicPointer(&buffers[slot], buffer);
+    }
+    // Every thread gets its own track in the trace, also when it reuses a buffer
+    buffer->name = thread_name;
+    buffer->tid = SDL_AddAtomicInt(&next_tid, 1) + 1;
+    buffer->name_written = 0;
+    SDL_SetTLS(&slot_tls, &slot_states[slot], release_slot);
+    SDL_SetAtomicInt(&slot_states[slot], SLOT_OWNED);
+    thread_buffer = buffer;
+    return buffer;
+  }
+  return NULL;
+}
+
+static void push_event(const trace_event_s *event) {
+  trace_buffer_s *buffer = get_thread_buffer();
+  if (buffer == NULL) {
+    return;
+  }
+  const uint32_t written = (uint32_t)SDL_GetAtomicInt(&buffer->written);
+  if (written - (uint32_t)SDL_GetAtomicInt(&buffer->read) >= TRACE_BUFFER_EVENTS) {
+    SDL_AddAtomicInt(&buffer->dropped, 1);
+    return;
+  }
+  buffer->events[written % TRACE_BUFFER_EVENTS] = *event;
+  SDL_SetAtomicInt(&buffer->written, (int)(written + 1));
+}
+
+static void publish_pending(void) {
+  if (pending.name != NULL) {
+    push_event(&pending);
+    pending.name = NULL;
+  }
+}
+
+int trace_open(const char *path) {
+  trace_file = SDL_IOFromFile(path, "wb");
+  if (trace_file == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't open trace file %s: %s", path,
+                 SDL_GetError());
+    return 0;
+  }
+  static const char header[] = "[\n";
+  SDL_WriteIO(trace_file, header, sizeof(header) - 1);
+  trace_origin_ns = SDL_GetTicksNS();
+  COMPAT_TLS_CREATE(&slot_tls);
+  SDL_SetAtomicInt(&trace_enabled, 1);
+  SDL_Log("Recording trace to %s", path);
+  return 1;
+}
+
+int trace_is_enabled(void) { return SDL_GetAtomicInt(&trace_enabled); }
+
+void trace_thread_name(const char *name) {
+  thread_name = name;
+  if (thread_buffer != NULL) {
+    thread_buffer->name = name;
+  }
+}
+
+uint64_t trace_begin(void) { return SDL_GetAtomicInt(&trace_enabled) ? SDL_GetTicksNS() : 0; }
+
+void trace_end(const char *name, const uint64_t start_ns) {
+  if (start_ns == 0 || !SDL_GetAtomicInt(&trace_enabled)) {
+    return;
+  }
+  publish_pending();
+  const trace_event_s event = {name, start_ns, SDL_GetTicksNS()};
+  push_event(&event);
+}
+
+void trace_end_batched(const char *name, const uint64_t start_ns, const uint32_t gap_us) {
+  if (start_ns == 0 || !SDL_GetAtomicInt(&trace_enabled)) {
+    return;
+  }
+  const uint64_t now = SDL_GetTicksNS();
+  if (pending.name == name && start_ns - pending.end_ns < (uint64_t)gap_us * 1000) {
+    pending.end_ns = now;
+    return;
+  }
+  publish_pending();
+  pending.name = name;
+  pending.start_ns = start_ns;
+  pending.end_ns = now;
+}
+
+static void write_line(const char *line) {
+  static const char separator[] = ",\n";
+  if (trace_events_written++ > 0) {
+    SDL_WriteIO(trace_file, separator, sizeof(separator) - 1);
+  }
+  SDL_WriteIO(trace_file, line, SDL_strlen(line));
+}
+
+void trace_flush(void) {
+  if (trace_file == NULL) {
+    return;
+  }
+  // Batches of the flushing thread can be closed here, other threads publish theirs with
+  // their next span
+  publish_pending();
+
+  char line[TRACE_LINE_LENGTH];
+  for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+    const int state = SDL_GetAtomicInt(&slot_states[i]);
+    if (state != SLOT_OWNED && state != SLOT_RELEASED) {
+      continue;
+    }
+    trace_buffer_s *buffer = SDL_GetAtomicPointer(&buffers[i]);
+    if (!buffer->name_written) {
+      char fallback[16];
+      SDL_snprintf(fallback, sizeof(fallback), "thread %d", buffer->tid);
+      SDL_snprintf(line, sizeof(line),
+                   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                   "\"args\":{\"name\":\"%s\"}}",
+                   buffer->tid, buffer->name != NULL ? buffer->name : fallback);
+      write_line(line);
+      buffer->name_written = 1;
+    }
+
+    const uint32_t written = (uint32_t)SDL_GetAtomicInt(&buffer->written);
+    for (uint32_t r = (uint32_t)SDL_GetAtomicInt(&buffer->read); r != written; r++) {
+      const trace_event_s *event = &buffer->events[r % TRACE_BUFFER_EVENTS];
+      SDL_snprintf(line, sizeof(line),
+                   "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                   event->name, buffer->tid,
+                   (double)(event->start_ns - trace_origin_ns) / 1000.0,
+                   (double)(event->end_ns - event->start_ns) / 1000.0);
+      write_line(line);
+    }
+    SDL_SetAtomicInt(&buffer->read, (int)written);
+
+    const int dropped = SDL_SetAtomicInt(&buffer->dropped, 0);
+    if (dropped > 0) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Trace buffer of thread %d full, %d events dropped",
+                  buffer->tid, dropped);
+    }
+
+    // The thread has exited and everything it recorded is written, hand the buffer on
+    if (state == SLOT_RELEASED) {
+      SDL_SetAtomicInt(&slot_states[i], SLOT_FREE);
+    }
+  }
+  SDL_FlushIO(trace_file);
+  SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Trace flushed, %d events", trace_events_written);
+}
+
+void trace_close(void) {
+  if (trace_file == NULL) {
+    return;
+  }
+  // Threads that are still running, like the SDL audio callback, stop recording here. Their
+  // buffers stay allocated until exit as a span may still be completing on them.
+  SDL_SetAtomicInt(&trace_enabled, 0);
+  trace_flush();
+  static const char footer[] = "\n]\n";
+  SDL_WriteIO(trace_file, footer, sizeof(footer) - 1);
+  SDL_CloseIO(trace_file);
+  trace_file = NULL;
+}
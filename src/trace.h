@@ -0,0 +1,38 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Chrome trace-event recording (chrome://tracing, ui.perfetto.dev). Spans are recorded into
+// per-thread lock-free buffers and written to the trace file on flush. All calls are no-ops
+// unless a trace file was opened with --trace.
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+// Start recording to the given file. Returns 1 on success.
+int trace_open(const char *path);
+
+// Return non-zero while recording
+int trace_is_enabled(void);
+
+// Name the calling thread in the trace. Call before the thread records its first span.
+void trace_thread_name(const char *name);
+
+// Start a span, returns the timestamp to pass to trace_end. Returns 0 when not recording.
+uint64_t trace_begin(void);
+
+// End a span. name must be a string literal or otherwise outlive the recording.
+void trace_end(const char *name, uint64_t start_ns);
+
+// End a span, extending the previous span of the same name on this thread if it ended less
+// than gap_us microseconds ago. Used to record bursts of small calls as one batch.
+void trace_end_batched(const char *name, uint64_t start_ns, uint32_t gap_us);
+
+// Write the recorded events to the trace file. Called from the main thread.
+void trace_flush(void);
+
+// Flush the remaining events and close the trace file
+void trace_close(void);
+
+#endif // TRACE_H_
@@ -0,0 +1,798 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+#include "vnc_server.h"
+#include "framebuffer.h"
+#include "keysym.h"
+#include "sdl_compat.h"
+
+#ifndef _WIN32
+#define VNC_SERVER_SUPPORTED
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS, SO_NOSIGPIPE is set on the socket instead
+#endif
+#endif
+
+#ifdef VNC_SERVER_SUPPORTED
+
+#define VNC_MAX_CLIENTS 4
+#define VNC_INPUT_SIZE 1024
+#define VNC_MAX_PENDING_RECTS 16
+#define TILE_SIZE 16
+
+// Client to server messages
+enum {
+  RFB_SET_PIXEL_FORMAT = 0,
+  RFB_SET_ENCODINGS = 2,
+  RFB_UPDATE_REQUEST = 3,
+  RFB_KEY_EVENT = 4,
+  RFB_POINTER_EVENT = 5,
+  RFB_CLIENT_CUT_TEXT = 6
+};
+
+enum { ENCODING_RAW = 0, ENCODING_HEXTILE = 5, ENCODING_DESKTOP_SIZE = -223 };
+
+// Hextile subencoding bits
+enum {
+  HEXTILE_RAW = 1,
+  HEXTILE_BACKGROUND = 2,
+  HEXTILE_FOREGROUND = 4,
+  HEXTILE_ANY_SUBRECTS = 8,
+  HEXTILE_SUBRECTS_COLOURED = 16
+};
+
+typedef enum { STATE_VERSION, STATE_SECURITY, STATE_INIT, STATE_NORMAL } vnc_state_t;
+
+// True colour pixel format requested by the viewer
+typedef struct {
+  uint8_t bytes_per_pixel;
+  uint8_t big_endian;
+  uint16_t red_max;
+  uint16_t green_max;
+  uint16_t blue_max;
+  uint8_t red_shift;
+  uint8_t green_shift;
+  uint8_t blue_shift;
+} vnc_pixel_format_s;
+
+typedef struct {
+  int fd;
+  vnc_state_t state;
+  int minor_version;
+  vnc_pixel_format_s format;
+  int hextile;
+  int desktop_size;
+  int width; // framebuffer size known to the viewer
+  int height;
+  int update_requested;
+  SDL_Rect pending[VNC_MAX_PENDING_RECTS];
+  int pending_count;
+  uint8_t input[VNC_INPUT_SIZE];
+  size_t input_length;
+  uint32_t skip_bytes;     // rest of a clipboard message
+  uint16_t encodings_left; // entries of a SetEncodings message still to read
+  uint8_t *output;
+  size_t output_length;
+  size_t output_sent;
+  size_t output_capacity;
+} vnc_client_s;
+
+static const vnc_pixel_format_s default_format = {4, 0, 255, 255, 255, 16, 8, 0};
+
+static int listen_fd = -1;
+static char *socket_file = NULL;
+static vnc_client_s clients[VNC_MAX_CLIENTS];
+
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+static uint32_t get_u32(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint8_t *put_u16(uint8_t *p, const uint16_t value) {
+  p[0] = value >> 8;
+  p[1] = value & 0xFF;
+  return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, const uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = (value >> 16) & 0xFF;
+  p[2] = (value >> 8) & 0xFF;
+  p[3] = value & 0xFF;
+  return p + 4;
+}
+
+static uint32_t convert_pixel(const uint32_t argb, const vnc_pixel_format_s *format) {
+  const uint32_t r = (argb >> 16) & 0xFF;
+  const uint32_t g = (argb >> 8) & 0xFF;
+  const uint32_t b = argb & 0xFF;
+  return (r * format->red_max + 127) / 255 << format->red_shift |
+         (g * format->green_max + 127) / 255 << format->green_shift |
+         (b * format->blue_max + 127) / 255 << format->blue_shift;
+}
+
+static uint8_t *put_pixel(uint8_t *p, const uint32_t pixel, const vnc_pixel_format_s *format) {
+  const int bytes = format->bytes_per_pixel;
+  for (int i = 0; i < bytes; i++) {
+    const int shift = format->big_endian ? (bytes - 1 - i) * 8 : i * 8;
+    p[i] = (pixel >> shift) & 0xFF;
+  }
+  return p + bytes;
+}
+
+// Make room for length more bytes of output and return where they go
+static uint8_t *reserve_output(vnc_client_s *client, const size_t length) {
+  if (client->output_length + length > client->output_capacity) {
+    size_t capacity = client->output_capacity > 0 ? client->output_capacity : 4096;
+    while (capacity < client->output_length + length) {
+      capacity *= 2;
+    }
+    uint8_t *output = SDL_realloc(client->output, capacity);
+    if (output == NULL) {
+      return NULL;
+    }
+    client->output = output;
+    client->output_capacity = capacity;
+  }
+  return client->output + client->output_length;
+}
+
+static int queue_output(vnc_client_s *client, const void *data, const size_t length) {
+  uint8_t *p = reserve_output(client, length);
+  if (p == NULL) {
+    return 0;
+  }
+  SDL_memcpy(p, data, length);
+  client->output_length += length;
+  return 1;
+}
+
+// Send as much of the output as the socket takes without blocking. Returns 0 on errors.
+static int flush_output(vnc_client_s *client) {
+  while (client->output_sent < client->output_length) {
+    const ssize_t sent = send(client->fd, client->output + client->output_sent,
+                              client->output_length - client->output_sent, MSG_NOSIGNAL);
+    if (sent < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    client->output_sent += (size_t)sent;
+  }
+  client->output_length = 0;
+  client->output_sent = 0;
+  return 1;
+}
+
+static void close_client(vnc_client_s *client) {
+  close(client->fd);
+  SDL_free(client->output);
+  SDL_zerop(client);
+  client->fd = -1;
+  SDL_Log("VNC viewer disconnected");
+}
+
+static void mark_all_pending(vnc_client_s *client) {
+  client->pending[0] = (SDL_Rect){0, 0, framebuffer_width(), framebuffer_height()};
+  client->pending_count = 1;
+}
+
+// Add a changed region, merging it with a pending one it overlaps or touches
+static void add_pending(vnc_client_s *client, const SDL_Rect *rect) {
+  for (int i = 0; i < client->pending_count; i++) {
+    SDL_Rect *r = &client->pending[i];
+    if (rect->x <= r->x + r->w && r->x <= rect->x + rect->w && rect->y <= r->y + r->h &&
+        r->y <= rect->y + rect->h) {
+      const int x1 = SDL_max(r->x + r->w, rect->x + rect->w);
+      const int y1 = SDL_max(r->y + r->h, rect->y + rect->h);
+      r->x = SDL_min(r->x, rect->x);
+      r->y = SDL_min(r->y, rect->y);
+      r->w = x1 - r->x;
+      r->h = y1 - r->y;
+      return;
+    }
+  }
+  if (client->pending_count < VNC_MAX_PENDING_RECTS) {
+    client->pending[client->pending_count++] = *rect;
+    return;
+  }
+  SDL_Rect *last = &client->pending[VNC_MAX_PENDING_RECTS - 1];
+  const int x1 = SDL_max(last->x + last->w, rect->x + rect->w);
+  const int y1 = SDL_max(last->y + last->h, rect->y + rect->h);
+  last->x = SDL_min(last->x, rect->x);
+  last->y = SDL_min(last->y, rect->y);
+  last->w = x1 - last->x;
+  last->h = y1 - last->y;
+}
+
+// Encode a tile as background plus subrectangles of one or more colours. Returns the encoded
+// length, or 0 if the raw pixels are not larger.
+static size_t encode_tile(uint8_t *out, const uint32_t *tile, const int w, const int h,
+                          const vnc_pixel_format_s *format, uint32_t *background,
+                          int *background_valid) {
+  const size_t raw_length = (size_t)w * h * format->bytes_per_pixel;
+
+  // The more frequent of the first two colours becomes the background
+  const uint32_t first = tile[0];
+  uint32_t second = first;
+  int first_count = 0;
+  int second_count = 0;
+  int colours = 1;
+  for (int i = 0; i < w * h; i++) {
+    if (tile[i] == first) {
+      first_count++;
+    } else if (colours == 1 || tile[i] == second) {
+      second = tile[i];
+      second_count++;
+      colours = SDL_max(colours, 2);
+    } else {
+      colours = 3;
+    }
+  }
+  const uint32_t bg = first_count >= second_count ? first : second;
+  const uint32_t fg = bg == first ? second : first;
+
+  uint8_t flags = 0;
+  uint8_t *p = out + 1;
+  if (!*background_valid || *background != bg) {
+    flags |= HEXTILE_BACKGROUND;
+    p = put_pixel(p, bg, format);
+  }
+  if (colours == 1) {
+    out[0] = flags;
+    *background = bg;
+    *background_valid = 1;
+    return (size_t)(p - out);
+  }
+
+  flags |= HEXTILE_ANY_SUBRECTS;
+  if (colours == 2) {
+    flags |= HEXTILE_FOREGROUND;
+    p = put_pixel(p, fg, format);
+  } else {
+    flags |= HEXTILE_SUBRECTS_COLOURED;
+  }
+  uint8_t *count = p++;
+  *count = 0;
+  const size_t subrect_length = colours == 2 ? 2 : 2 + format->bytes_per_pixel;
+
+  // Cover the other pixels greedily with rectangles of one colour, growing right then down
+  uint8_t done[TILE_SIZE * TILE_SIZE] = {0};
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      const int i = y * w + x;
+      if (done[i] || tile[i] == bg) {
+        continue;
+      }
+      const uint32_t colour = tile[i];
+      int sw = 1;
+      while (x + sw < w && !done[i + sw] && tile[i + sw] == colour) {
+        sw++;
+      }
+      int sh = 1;
+      for (; y + sh < h; sh++) {
+        const int row = i + sh * w;
+        int k = 0;
+        while (k < sw && !done[row + k] && tile[row + k] == colour) {
+          k++;
+        }
+        if (k < sw) {
+          break;
+        }
+      }
+      for (int dy = 0; dy < sh; dy++) {
+        SDL_memset(done + i + dy * w, 1, sw);
+      }
+
+      if (*count == 255 || (size_t)(p - out) + subrect_length >= raw_length + 1) {
+        return 0;
+      }
+      if (colours > 2) {
+        p = put_pixel(p, colour, format);
+      }
+      *p++ = (uint8_t)(x << 4 | y);
+      *p++ = (uint8_t)((sw - 1) << 4 | (sh - 1));
+      (*count)++;
+    }
+  }
+  out[0] = flags;
+  *background = bg;
+  *background_valid = 1;
+  return (size_t)(p - out);
+}
+
+// Append a rectangle header and its pixels, worst case raw plus one byte per tile
+static void encode_rect(vnc_client_s *client, const SDL_Rect *r, const uint32_t *argb,
+                        const int stride) {
+  const vnc_pixel_format_s *format = &client->format;
+  uint8_t *p = client->output + client->output_length;
+  p = put_u16(p, r->x);
+  p = put_u16(p, r->y);
+  p = put_u16(p, r->w);
+  p = put_u16(p, r->h);
+  p = put_u32(p, client->hextile ? ENCODING_HEXTILE : ENCODING_RAW);
+
+  if (!client->hextile) {
+    for (int y = r->y; y < r->y + r->h; y++) {
+      for (int x = r->x; x < r->x + r->w; x++) {
+        p = put_pixel(p, convert_pixel(argb[y * stride + x], format), format);
+      }
+    }
+    client->output_length = (size_t)(p - client->output);
+    return;
+  }
+
+  uint32_t tile[TILE_SIZE * TILE_SIZE];
+  uint8_t encoded[1 + TILE_SIZE * TILE_SIZE * 4];
+  uint32_t background = 0;
+  int background_valid = 0;
+  for (int ty = r->y; ty < r->y + r->h; ty += TILE_SIZE) {
+    const int th = SDL_min(TILE_SIZE, r->y + r->h - ty);
+    for (int tx = r->x; tx < r->x + r->w; tx += TILE_SIZE) {
+      const int tw = SDL_min(TILE_SIZE, r->x + r->w - tx);
+      for (int y = 0; y < th; y++) {
+        for (int x = 0; x < tw; x++) {
+          tile[y * tw + x] = convert_pixel(argb[(ty + y) * stride + tx + x], format);
+        }
+      }
+      const size_t length =
+          encode_tile(encoded, tile, tw, th, format, &background, &background_valid);
+      if (length > 0) {
+        SDL_memcpy(p, encoded, length);
+        p += length;
+      } else {
+        // The background is not carried over a raw tile
+        *p++ = HEXTILE_RAW;
+        for (int i = 0; i < tw * th; i++) {
+          p = put_pixel(p, tile[i], format);
+        }
+        background_valid = 0;
+      }
+    }
+  }
+  client->output_length = (size_t)(p - client->output);
+}
+
+// Send the pending regions if the viewer asked for an update and took the previous one.
+// Returns 0 on errors.
+static int send_update(vnc_client_s *client) {
+  if (client->state != STATE_NORMAL || !client->update_requested ||
+      client->output_length > 0) {
+    return 1;
+  }
+  const int width = framebuffer_width();
+  const int height = framebuffer_height();
+  const int resized = client->width != width || client->height != height;
+
+  // Clip to the framebuffer, the pending regions may predate a resolution change
+  int count = 0;
+  size_t length = 4 + (resized ? 12 : 0);
+  for (int i = 0; i < client->pending_count; i++) {
+    SDL_Rect r = client->pending[i];
+    const int x1 = SDL_min(r.x + r.w, width);
+    const int y1 = SDL_min(r.y + r.h, height);
+    r.x = SDL_max(r.x, 0);
+    r.y = SDL_max(r.y, 0);
+    r.w = x1 - r.x;
+    r.h = y1 - r.y;
+    if (r.w > 0 && r.h > 0) {
+      client->pending[count++] = r;
+      const size_t tiles =
+          (size_t)((r.w + TILE_SIZE - 1) / TILE_SIZE) * ((r.h + TILE_SIZE - 1) / TILE_SIZE);
+      length += 12 + (size_t)r.w * r.h * client->format.bytes_per_pixel + tiles;
+    }
+  }
+  client->pending_count = count;
+  if (count == 0 && !resized) {
+    return 1;
+  }
+
+  uint8_t *p = reserve_output(client, length);
+  if (p == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't allocate a VNC update");
+    return 0;
+  }
+  const uint32_t *argb = framebuffer_argb();
+  p[0] = 0; // FramebufferUpdate
+  p[1] = 0;
+  p = put_u16(p + 2, count + resized);
+  if (resized) {
+    p = put_u16(p, 0);
+    p = put_u16(p, 0);
+    p = put_u16(p, width);
+    p = put_u16(p, height);
+    p = put_u32(p, (uint32_t)ENCODING_DESKTOP_SIZE);
+    client->width = width;
+    client->height = height;
+  }
+  client->output_length = (size_t)(p - client->output);
+  for (int i = 0; i < count; i++) {
+    encode_rect(client, &client->pending[i], argb, width);
+  }
+  client->pending_count = 0;
+  client->update_requested = 0;
+  return flush_output(client);
+}
+
+static int send_server_init(vnc_client_s *client) {
+  static const char name[] = "m8c";
+  uint8_t message[24 + sizeof(name) - 1];
+  const vnc_pixel_format_s *format = &default_format;
+
+  client->width = framebuffer_width();
+  client->height = framebuffer_height();
+  uint8_t *p = put_u16(message, client->width);
+  p = put_u16(p, client->height);
+  *p++ = format->bytes_per_pixel * 8;
+  *p++ = 24; // depth
+  *p++ = format->big_endian;
+  *p++ = 1; // true colour
+  p = put_u16(p, format->red_max);
+  p = put_u16(p, format->green_max);
+  p = put_u16(p, format->blue_max);
+  *p++ = format->red_shift;
+  *p++ = format->green_shift;
+  *p++ = format->blue_shift;
+  *p++ = 0; // padding
+  *p++ = 0;
+  *p++ = 0;
+  p = put_u32(p, sizeof(name) - 1);
+  SDL_memcpy(p, name, sizeof(name) - 1);
+  return queue_output(client, message, sizeof(message));
+}
+
+static int set_pixel_format(vnc_client_s *client, const uint8_t *message) {
+  const int bits_per_pixel = message[4];
+  const int true_colour = message[7];
+  if (!true_colour || (bits_per_pixel != 8 && bits_per_pixel != 16 && bits_per_pixel != 32)) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "VNC viewer requested an unsupported pixel format");
+    return 0;
+  }
+  // Every channel needs a non-zero maximum and has to fit in the pixel once shifted, otherwise
+  // convert_pixel() would shift past the pixel or produce no colour at all
+  for (int i = 0; i < 3; i++) {
+    const uint16_t max = get_u16(message + 8 + i * 2);
+    const uint8_t shift = message[14 + i];
+    if (max == 0 || shift >= bits_per_pixel || ((uint64_t)max << shift) >> bits_per_pixel != 0) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                   "VNC viewer requested an invalid pixel format (max %u, shift %u)", max, shift);
+      return 0;
+    }
+  }
+  client->format.bytes_per_pixel = bits_per_pixel / 8;
+  client->format.big_endian = message[6] != 0;
+  client->format.red_max = get_u16(message + 8);
+  client->format.green_max = get_u16(message + 10);
+  client->format.blue_max = get_u16(message + 12);
+  client->format.red_shift = message[14];
+  client->format.green_shift = message[15];
+  client->format.blue_shift = message[16];
+  return 1;
+}
+
+// Handle one message at the start of the input. Returns its length, 0 if it is not complete or
+// -1 if the viewer has to be disconnected.
+static int handle_message(vnc_client_s *client, const uint8_t *message, const size_t length) {
+  switch (client->state) {
+  case STATE_VERSION: {
+    if (length < 12) {
+      return 0;
+    }
+    if (SDL_memcmp(message, "RFB 003.", 8) != 0) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "VNC viewer sent an invalid protocol version");
+      return -1;
+    }
+    const int minor = (message[8] - '0') * 100 + (message[9] - '0') * 10 + (message[10] - '0');
+    client->minor_version = minor >= 8 ? 8 : minor == 7 ? 7 : 3;
+    if (client->minor_version == 3) {
+      // The server decides, no authentication
+      uint8_t security[4];
+      put_u32(security, 1);
+      client->state = STATE_INIT;
+      return queue_output(client, security, sizeof(security)) ? 12 : -1;
+    }
+    const uint8_t security_types[] = {1, 1}; // one type, none
+    client->state = STATE_SECURITY;
+    return queue_output(client, security_types, sizeof(security_types)) ? 12 : -1;
+  }
+  case STATE_SECURITY:
+    if (length < 1) {
+      return 0;
+    }
+    if (message[0] != 1) {
+      return -1;
+    }
+    client->state = STATE_INIT;
+    if (client->minor_version == 8) {
+      const uint8_t result[4] = {0, 0, 0, 0};
+      return queue_output(client, result, sizeof(result)) ? 1 : -1;
+    }
+    return 1;
+  case STATE_INIT:
+    if (length < 1) {
+      return 0;
+    }
+    // The shared flag is ignored, all viewers share the display
+    client->state = STATE_NORMAL;
+    mark_all_pending(client);
+    SDL_Log("VNC viewer connected");
+    return send_server_init(client) ? 1 : -1;
+  case STATE_NORMAL:
+    break;
+  }
+
+  switch (message[0]) {
+  case RFB_SET_PIXEL_FORMAT:
+    if (length < 20) {
+      return 0;
+    }
+    return set_pixel_format(client, message) ? 20 : -1;
+  case RFB_SET_ENCODINGS:
+    if (length < 4) {
+      return 0;
+    }
+    client->hextile = 0;
+    client->desktop_size = 0;
+    client->encodings_left = get_u16(message + 2);
+    return 4;
+  case RFB_UPDATE_REQUEST:
+    if (length < 10) {
+      return 0;
+    }
+    if (!message[1]) {
+      mark_all_pending(client);
+    }
+    client->update_requested = 1;
+    return 10;
+  case RFB_KEY_EVENT:
+    if (length < 8) {
+      return 0;
+    }
+    keysym_push_event(get_u32(message + 4), message[1]);
+    return 8;
+  case RFB_POINTER_EVENT:
+    return length < 6 ? 0 : 6;
+  case RFB_CLIENT_CUT_TEXT:
+    if (length < 8) {
+      return 0;
+    }
+    client->skip_bytes = get_u32(message + 4);
+    return 8;
+  default:
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "VNC viewer sent unknown message %d", message[0]);
+    return -1;
+  }
+}
+
+// Read and handle the viewer's messages. Returns 0 when it has to be disconnected.
+static int receive_messages(vnc_client_s *client) {
+  for (;;) {
+    const ssize_t received = recv(client->fd, client->input + client->input_length,
+                                  sizeof(client->input) - client->input_length, 0);
+    if (received == 0) {
+      return 0;
+    }
+    if (received < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    client->input_length += (size_t)received;
+
+    size_t position = 0;
+    while (position < client->input_length) {
+      const uint8_t *message = client->input + position;
+      const size_t available = client->input_length - position;
+      if (client->skip_bytes > 0) {
+        const size_t skipped = SDL_min(available, client->skip_bytes);
+        client->skip_bytes -= (uint32_t)skipped;
+        position += skipped;
+      } else if (client->encodings_left > 0) {
+        if (available < 4) {
+          break;
+        }
+        const int32_t encoding = (int32_t)get_u32(message);
+        if (encoding == ENCODING_HEXTILE) {
+          client->hextile = 1;
+        } else if (encoding == ENCODING_DESKTOP_SIZE) {
+          client->desktop_size = 1;
+        }
+        client->encodings_left--;
+        position += 4;
+      } else {
+        const int used = handle_message(client, message, available);
+        if (used < 0) {
+          return 0;
+        }
+        if (used == 0) {
+          break;
+        }
+        position += (size_t)used;
+      }
+    }
+    SDL_memmove(client->input, client->input + position, client->input_length - position);
+    client->input_length -= position;
+  }
+}
+
+static void set_nonblocking(const int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+static void accept_clients(void) {
+  int fd;
+  while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+    vnc_client_s *client = NULL;
+    for (int i = 0; i < VNC_MAX_CLIENTS; i++) {
+      if (clients[i].fd < 0) {
+        client = &clients[i];
+        break;
+      }
+    }
+    if (client == NULL) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "Too many VNC viewers, refusing connection");
+      close(fd);
+      continue;
+    }
+    set_nonblocking(fd);
+    const int on = 1;
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // fails harmlessly on Unix sockets
+    client->fd = fd;
+    client->state = STATE_VERSION;
+    client->format = default_format;
+    if (!queue_output(client, "RFB 003.008\n", 12) || !flush_output(client)) {
+      close_client(client);
+    }
+  }
+}
+
+static int listen_tcp(const int port) {
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    return 0;
+  }
+  const int on = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address;
+  SDL_zero(address);
+  address.sin_family = AF_INET;
+  address.sin_port = htons((uint16_t)port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) == 0;
+}
+
+static int listen_unix(const char *path) {
+  struct sockaddr_un address;
+  if (SDL_strlen(path) >= sizeof(address.sun_path)) {
+    return 0;
+  }
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    return 0;
+  }
+  SDL_zero(address);
+  address.sun_family = AF_UNIX;
+  SDL_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+  unlink(path); // stale socket from a previous run
+  if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+    return 0;
+  }
+  socket_file = SDL_strdup(path);
+  return 1;
+}
+
+#endif // VNC_SERVER_SUPPORTED
+
+int vnc_server_start(const char *address) {
+#ifdef VNC_SERVER_SUPPORTED
+  for (int i = 0; i < VNC_MAX_CLIENTS; i++) {
+    clients[i].fd = -1;
+  }
+
+  // An address made only of digits is a TCP port, anything else the path of a Unix socket
+  int tcp = *address != '\0';
+  int port = 0;
+  for (const char *c = address; *c != '\0' && tcp; c++) {
+    tcp = SDL_isdigit(*c);
+    port = SDL_min(port * 10 + (*c - '0'), 65536);
+  }
+  if (tcp && (port < 1 || port > 65535)) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Invalid VNC port %s", address);
+    return 0;
+  }
+
+  if (!(tcp ? listen_tcp(port) : listen_unix(address)) || listen(listen_fd, 4) != 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't listen for VNC viewers on %s", address);
+    vnc_server_stop();
+    return 0;
+  }
+  set_nonblocking(listen_fd);
+  SDL_Log("Serving VNC on %s%s", tcp ? "127.0.0.1:" : "", address);
+  return 1;
+#else
+  (void)address;
+  SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM, "The VNC server is not supported on this platform");
+  return 0;
+#endif
+}
+
+void vnc_server_frame(void) {
+#ifdef VNC_SERVER_SUPPORTED
+  if (listen_fd < 0) {
+    return;
+  }
+  int count;
+  const SDL_Rect *rects = framebuffer_dirty_rects(&count);
+  if (count == 0) {
+    return;
+  }
+  for (int i = 0; i < VNC_MAX_CLIENTS; i++) {
+    vnc_client_s *client = &clients[i];
+    if (client->fd < 0 || client->state != STATE_NORMAL) {
+      continue;
+    }
+    if (client->width != framebuffer_width() || client->height != framebuffer_height()) {
+      if (!client->desktop_size) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_SYSTEM,
+                    "VNC viewer can't follow the resolution change, disconnecting");
+        close_client(client);
+        continue;
+      }
+      mark_all_pending(client);
+    } else {
+      for (int r = 0; r < count; r++) {
+        add_pending(client, &rects[r]);
+      }
+    }
+    if (!send_update(client)) {
+      close_client(client);
+    }
+  }
+#endif
+}
+
+void vnc_server_poll(void) {
+#ifdef VNC_SERVER_SUPPORTED
+  if (listen_fd < 0) {
+    return;
+  }
+  accept_clients();
+  for (int i = 0; i < VNC_MAX_CLIENTS; i++) {
+    vnc_client_s *client = &clients[i];
+    if (client->fd < 0) {
+      continue;
+    }
+    if (!receive_messages(client) || !flush_output(client) || !send_update(client)) {
+      close_client(client);
+    }
+  }
+#endif
+}
+
+void vnc_server_stop(void) {
+#ifdef VNC_SERVER_SUPPORTED
+  if (listen_fd < 0) {
+    return;
+  }
+  for (int i = 0; i < VNC_MAX_CLIENTS; i++) {
+    if (clients[i].fd >= 0) {
+      close_client(&clients[i]);
+    }
+  }
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    listen_fd = -1;
+  }
+  if (socket_file != NULL) {
+    unlink(socket_file);
+    SDL_free(socket_file);
+    socket_file = NULL;
+  }
+#endif
+}
@@ -0,0 +1,25 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Minimal VNC (RFB 3.3 to 3.8) server for the M8 display at its native resolution. Listens on
+// localhost or a Unix domain socket without authentication. Viewers only get the regions the
+// framebuffer reports as changed, Hextile encoded, and their key events are pushed into the SDL
+// event queue so they behave exactly like local key presses. Not available on Windows.
+
+#ifndef VNC_SERVER_H_
+#define VNC_SERVER_H_
+
+// Listen on a TCP port of 127.0.0.1 when the address is a number, otherwise on a Unix domain
+// socket at that path. Returns 1 on success.
+int vnc_server_start(const char *address);
+
+// Queue the framebuffer's dirty rectangles for the viewers. Called once per frame before the
+// rectangles are reset.
+void vnc_server_frame(void);
+
+// Accept viewers, handle their messages and send pending updates. Called from the main loop.
+void vnc_server_poll(void);
+
+void vnc_server_stop(void);
+
+#endif // VNC_SERVER_H_
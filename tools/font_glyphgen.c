@@ -0,0 +1,150 @@
+// Copyright 2025 Jonne Kokkonen
+// Released under the MIT licence, https://opensource.org/licenses/MIT
+
+// Build-time generator for the packed glyph tables declared in src/fonts/font_glyphs.h. The
+// embedded font BMPs are decoded here once, so the application never parses them at runtime.
+//
+// Usage: font_glyphgen <output.c>
+
+#include "../src/fonts/fonts.c"
+#include "../src/fonts/font_glyphs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char *font_names[] = {"v1_small", "v1_large", "v2_small", "v2_large", "v2_huge"};
+
+static uint32_t read_u32(const unsigned char *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t read_u16(const unsigned char *p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+// Returns 1 if the pixel is a glyph pixel: anything but black, which the renderer has always
+// treated as transparent
+static int bmp_pixel(const unsigned char *bmp, const int x, const int y) {
+  const uint32_t data_offset = read_u32(bmp + 10);
+  const uint32_t header_size = read_u32(bmp + 14);
+  const int32_t width = (int32_t)read_u32(bmp + 18);
+  const int32_t height = (int32_t)read_u32(bmp + 22);
+  const int bpp = read_u16(bmp + 28);
+  const unsigned char *palette = bmp + 14 + header_size;
+
+  const size_t stride = (size_t)((width * bpp + 31) / 32) * 4;
+  // Rows are stored bottom-up unless the height is negative
+  const int row = height > 0 ? height - 1 - y : y;
+  const unsigned char *line = bmp + data_offset + stride * (size_t)row;
+
+  uint32_t index;
+  switch (bpp) {
+  case 1:
+    index = (line[x / 8] >> (7 - x % 8)) & 1;
+    break;
+  case 4:
+    index = (line[x / 2] >> (x % 2 ? 0 : 4)) & 0x0F;
+    break;
+  case 8:
+    index = line[x];
+    break;
+  case 24:
+  case 32: {
+    const unsigned char *p = line + (size_t)x * (bpp / 8);
+    return p[0] != 0 || p[1] != 0 || p[2] != 0;
+  }
+  default:
+    return 0;
+  }
+  const unsigned char *color = palette + index * 4; // BGRA
+  return color[0] != 0 || color[1] != 0 || color[2] != 0;
+}
+
+static int write_font(FILE *out, const struct inline_font *font, const char *name) {
+  const unsigned char *bmp = font->image_data;
+  if (font->image_size < 54 || bmp[0] != 'B' || bmp[1] != 'M' || read_u32(bmp + 30) != 0) {
+    fprintf(stderr, "font_glyphgen: font %s is not an uncompressed BMP\n", name);
+    return 0;
+  }
+  const int bpp = read_u16(bmp + 28);
+  if (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 24 && bpp != 32) {
+    fprintf(stderr, "font_glyphgen: font %s has an unsupported depth of %d bits\n", name, bpp);
+    return 0;
+  }
+  const int glyph_width = font->width / FONT_GLYPH_COUNT;
+  const int glyph_height = font->height;
+  const int row_bytes = (glyph_width + 7) / 8;
+  if (glyph_width != font->glyph_x) {
+    fprintf(stderr, "font_glyphgen: font %s is %d pixels wide, expected %d glyphs of %d\n", name,
+            font->width, FONT_GLYPH_COUNT, font->glyph_x);
+    return 0;
+  }
+
+  fprintf(out, "static const uint8_t font_%s_bits[] = {\n", name);
+  for (int glyph = 0; glyph < FONT_GLYPH_COUNT; glyph++) {
+    fprintf(out, "    // '%c'\n   ", FONT_GLYPH_FIRST + glyph);
+    for (int y = 0; y < glyph_height; y++) {
+      for (int byte = 0; byte < row_bytes; byte++) {
+        unsigned int bits = 0;
+        for (int bit = 0; bit < 8; bit++) {
+          const int x = byte * 8 + bit;
+          if (x < glyph_width && bmp_pixel(bmp, glyph * glyph_width + x, y)) {
+            bits |= 0x80u >> bit;
+          }
+        }
+        fprintf(out, " 0x%02X,", bits);
+      }
+    }
+    fprintf(out, "\n");
+  }
+  fprintf(out, "};\n\n");
+  fprintf(out, "static const struct font_glyphs font_%s_glyphs = {%d, %d, %d, font_%s_bits};\n\n",
+          name, glyph_width, glyph_height, row_bytes, name);
+  return 1;
+}
+
+int main(const int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <output.c>\n", argv[0]);
+    return 1;
+  }
+
+  size_t count;
+  const struct inline_font *const *fonts = fonts_all(&count);
+  if (count != sizeof(font_names) / sizeof(font_names[0])) {
+    fprintf(stderr, "font_glyphgen: expected %zu fonts, found %zu\n",
+            sizeof(font_names) / sizeof(font_names[0]), count);
+    return 1;
+  }
+
+  FILE *out = fopen(argv[1], "w");
+  if (out == NULL) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  fprintf(out, "// Generated by tools/font_glyphgen.c from src/fonts/font*.h, do not edit.\n\n");
+  fprintf(out, "#include \"font_glyphs.h\"\n\n");
+  for (size_t i = 0; i < count; i++) {
+    if (!write_font(out, fonts[i], font_names[i])) {
+      fclose(out);
+      remove(argv[1]);
+      return 1;
+    }
+  }
+
+  fprintf(out, "static const struct font_glyphs *const glyph_tables[] = {\n");
+  for (size_t i = 0; i < count; i++) {
+    fprintf(out, "    &font_%s_glyphs,\n", font_names[i]);
+  }
+  fprintf(out, "};\n\n");
+  fprintf(out, "const struct font_glyphs *font_glyphs_get(const size_t index) {\n");
+  fprintf(out, "  return index < sizeof(glyph_tables) / sizeof(glyph_tables[0]) ? "
+               "glyph_tables[index] : NULL;\n");
+  fprintf(out, "}\n");
+
+  if (fclose(out) != 0) {
+    perror(argv[1]);
+    remove(argv[1]);
+    return 1;
+  }
+  return 0;
+}